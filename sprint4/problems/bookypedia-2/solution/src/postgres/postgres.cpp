@@ -8,6 +8,37 @@ namespace postgres {
 	using namespace std::literals;
 	using pqxx::operator"" _zv;
 
+	namespace
+	{
+		//Names of the statements Database prepares on its connection
+		constexpr pqxx::zview SAVE_AUTHOR = "save_author"_zv;
+		constexpr pqxx::zview LOAD_AUTHORS = "load_authors"_zv;
+		constexpr pqxx::zview LOAD_AUTHOR = "load_author"_zv;
+		constexpr pqxx::zview LOAD_AUTHOR_BY_NAME = "load_author_by_name"_zv;
+		constexpr pqxx::zview EDIT_AUTHOR = "edit_author"_zv;
+		constexpr pqxx::zview DELETE_AUTHOR = "delete_author"_zv;
+
+		constexpr pqxx::zview SAVE_BOOK = "save_book"_zv;
+		constexpr pqxx::zview LOAD_BOOKS = "load_books"_zv;
+		constexpr pqxx::zview LOAD_BOOKS_BY_AUTHOR = "load_books_by_author"_zv;
+		constexpr pqxx::zview LOAD_BOOKS_BY_TITLE = "load_books_by_title"_zv;
+		constexpr pqxx::zview LOAD_BOOK = "load_book"_zv;
+		constexpr pqxx::zview EDIT_BOOK = "edit_book"_zv;
+		constexpr pqxx::zview DELETE_BOOK = "delete_book"_zv;
+
+		constexpr pqxx::zview LOAD_TAGS = "load_tags"_zv;
+		constexpr pqxx::zview SAVE_TAG = "save_tag"_zv;
+		constexpr pqxx::zview DELETE_TAGS = "delete_tags"_zv;
+
+		domain::BookRepresentation ReadBook(const pqxx::row& row)
+		{
+			domain::BookId book_id = domain::BookId::FromString(row[0].as<std::string>());
+			domain::AuthorId author_id = domain::AuthorId::FromString(row[1].as<std::string>());
+
+			return { row[2].as<std::string>(), book_id, author_id, row[3].as<int>() };
+		}
+	}
+
 	void AuthorRepositoryImpl::Save(const domain::Author& author)
 	{
 		// Пока каждое обращение к репозиторию выполняется внутри отдельной транзакции
@@ -15,7 +46,7 @@ namespace postgres {
 		// запросов выполнить в рамках одной транзакции.
 		// Вы также может самостоятельно почитать информацию про этот паттерн и применить его здесь.
 		pqxx::work work{ connection_ };
-		work.exec_params(R"(INSERT INTO authors (id, name) VALUES ($1, $2) ON CONFLICT (id) DO UPDATE SET name=$2;)"_zv, author.GetId().ToString(), author.GetName());
+		work.exec_prepared(SAVE_AUTHOR, author.GetId().ToString(), author.GetName());
 		work.commit();
 	}
 
@@ -25,13 +56,11 @@ namespace postgres {
 
 		pqxx::read_transaction read_t(connection_);
 
-		auto query_text = "SELECT id, name FROM authors ORDER BY name"_zv;
-
 		//Выполняем запрос и итерируемся по строкам ответа
-		for (auto [id, name] : read_t.query<std::string, std::string>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_AUTHORS))
 		{
-			domain::AuthorId author_id = domain::AuthorId::FromString(id);
-			domain::Author author{ author_id, name };
+			domain::AuthorId author_id = domain::AuthorId::FromString(row[0].as<std::string>());
+			domain::Author author{ author_id, row[1].as<std::string>() };
 
 			result.push_back(author);
 		}
@@ -44,18 +73,13 @@ namespace postgres {
 	{
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, name FROM authors WHERE id=";
-		query_text = query_text + id;
-		query_text = query_text + "';";
-
 		//Выполняем запрос и итерируемся по строкам ответа
-		for (auto [id, name] : read_t.query<std::string, std::string>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_AUTHOR, id))
 		{
-			domain::AuthorId author_id = domain::AuthorId::FromString(id);
-			domain::Author author{ author_id, name };
+			domain::AuthorId author_id = domain::AuthorId::FromString(row[0].as<std::string>());
+			domain::Author author{ author_id, row[1].as<std::string>() };
 
 			return author;
-			break;
 		}
 
 		read_t.commit();
@@ -66,8 +90,7 @@ namespace postgres {
 	void BookRepositoryImpl::Save(const domain::Book& book)
 	{
 		pqxx::work work{ connection_ };
-		work.exec_params(R"(INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4) ON CONFLICT (id) DO UPDATE SET author_id=$2, title=$3, publication_year=$4;)"_zv,
-			book.GetId().ToString(), book.GetAuthorId().ToString(), book.GetName(), book.GetReleaseYear());
+		work.exec_prepared(SAVE_BOOK, book.GetId().ToString(), book.GetAuthorId().ToString(), book.GetName(), book.GetReleaseYear());
 		work.commit();
 	}
 
@@ -97,14 +120,13 @@ namespace postgres {
 		std::vector<domain::BookRepresentation> result;
 
 		pqxx::read_transaction read_t(connection_);
-		auto query_text = "SELECT books.id, books.title, authors.name AS author_name, authors.id AS author_id, books.publication_year FROM books JOIN authors ON books.author_id = authors.id ORDER BY books.title ASC,authors.name ASC, books.publication_year ASC;"_zv;
 
-		for (auto [id, title, author_name, author_id, publication_year] : read_t.query<std::string, std::string, std::string, std::string, int>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_BOOKS))
 		{
-			domain::BookId book_id = domain::BookId::FromString(id);
-			domain::AuthorId author_id_tmp = domain::AuthorId::FromString(author_id);
+			domain::BookId book_id = domain::BookId::FromString(row[0].as<std::string>());
+			domain::AuthorId author_id_tmp = domain::AuthorId::FromString(row[3].as<std::string>());
 
-			domain::BookRepresentation book{ title, book_id, author_name, author_id_tmp, publication_year };
+			domain::BookRepresentation book{ row[1].as<std::string>(), book_id, row[2].as<std::string>(), author_id_tmp, row[4].as<int>() };
 
 			result.push_back(book);
 		}
@@ -120,18 +142,9 @@ namespace postgres {
 
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, author_id, title, publication_year FROM books WHERE author_id='";
-		query_text = query_text + author_id;
-		query_text = query_text + "' ORDER BY publication_year, title;";
-
-		for (auto [id, author_id, title, publication_year] : read_t.query<std::string, std::string, std::string, int>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_BOOKS_BY_AUTHOR, author_id))
 		{
-			domain::BookId book_id = domain::BookId::FromString(id);
-			domain::AuthorId author_id_tmp = domain::AuthorId::FromString(author_id);
-
-			domain::BookRepresentation book{ title, book_id, author_id_tmp, publication_year };
-
-			result.push_back(book);
+			result.push_back(ReadBook(row));
 		}
 		read_t.commit();
 
@@ -142,13 +155,9 @@ namespace postgres {
 	{
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, name FROM authors WHERE id='";
-		query_text = query_text + id;
-		query_text = query_text + "';";
-
-		for (auto [id, name] : read_t.query<std::string, std::string>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_AUTHOR, id))
 		{
-			return name;
+			return row[1].as<std::string>();
 		}
 
 		read_t.commit();
@@ -160,13 +169,9 @@ namespace postgres {
 	{
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, name FROM authors WHERE name='";
-		query_text = query_text + name;
-		query_text = query_text + "';";
-
-		for (auto [id, name] : read_t.query<std::string, std::string>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_AUTHOR_BY_NAME, name))
 		{
-			return id;
+			return row[0].as<std::string>();
 		}
 
 		read_t.commit();
@@ -180,18 +185,9 @@ namespace postgres {
 
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, author_id, title, publication_year FROM books WHERE title='";
-		query_text = query_text + book_name;
-		query_text = query_text + "' ORDER BY publication_year, title;";
-
-		for (auto [id, author_id, title, publication_year] : read_t.query<std::string, std::string, std::string, int>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_BOOKS_BY_TITLE, book_name))
 		{
-			domain::BookId book_id = domain::BookId::FromString(id);
-			domain::AuthorId author_id_tmp = domain::AuthorId::FromString(author_id);
-
-			domain::BookRepresentation book{ title, book_id, author_id_tmp, publication_year };
-
-			result.push_back(book);
+			result.push_back(ReadBook(row));
 		}
 		read_t.commit();
 
@@ -202,18 +198,9 @@ namespace postgres {
 	{
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT id, author_id, title, publication_year FROM books WHERE id='";
-		query_text = query_text + book_id;
-		query_text = query_text + "';";
-
-		for (auto [id, author_id, title, publication_year] : read_t.query<std::string, std::string, std::string, int>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_BOOK, book_id))
 		{
-			domain::BookId book_id = domain::BookId::FromString(id);
-			domain::AuthorId author_id_tmp = domain::AuthorId::FromString(author_id);
-			//
-			domain::BookRepresentation book{ title, book_id, author_id_tmp, publication_year };
-
-			return book;
+			return ReadBook(row);
 		}
 		read_t.commit();
 
@@ -226,15 +213,9 @@ namespace postgres {
 
 		pqxx::read_transaction read_t(connection_);
 
-		std::string query_text = "SELECT book_id, tag FROM book_tags WHERE book_id='";
-		query_text = query_text + book_id;
-		query_text = query_text + "' ORDER BY tag";
-
-		for (auto [book_id, tag] : read_t.query<std::string, std::string>(query_text))
+		for (const auto& row : read_t.exec_prepared(LOAD_TAGS, book_id))
 		{
-			//domain::BookId book_id = domain::BookId::FromString(book_id);
-
-			result.push_back(tag);
+			result.push_back(row[0].as<std::string>());
 		}
 		read_t.commit();
 
@@ -247,11 +228,9 @@ namespace postgres {
 
 		for (const std::string& tag : tags)
 		{
-			work.exec_params(R"(INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);)"_zv, book_id, tag);
+			work.exec_prepared(SAVE_TAG, book_id, tag);
 		}
 		
-		//work.exec_params(R"(INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);)"_zv, book_id, "tag");
-		
 		work.commit();
 	}
 
@@ -261,10 +240,7 @@ namespace postgres {
 	{
 		pqxx::work work{ connection_ };
 
-		std::string query_text = "UPDATE authors SET name = '";
-		query_text = query_text + new_name + "' WHERE id = '" + author_id + "';";
-
-		work.exec(query_text);
+		work.exec_prepared(EDIT_AUTHOR, author_id, new_name);
 
 		work.commit();
 	}
@@ -273,20 +249,12 @@ namespace postgres {
 	{
 		pqxx::work work{ connection_ };
 
-		std::string query_text = "UPDATE books SET title = '";
-		query_text = query_text + new_data.title + "', publication_year = " + std::to_string(new_data.year) + " WHERE id = '" + book_id + "';";
-
-		work.exec(query_text);
-
-		query_text = "DELETE FROM book_tags WHERE book_id = '";
-		query_text = query_text + book_id;
-		query_text = query_text + "';";
-
-		work.exec(query_text);
+		work.exec_prepared(EDIT_BOOK, book_id, new_data.title, new_data.year);
+		work.exec_prepared(DELETE_TAGS, book_id);
 
 		for (const std::string& tag : tags)
 		{
-			work.exec_params(R"(INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);)"_zv, book_id, tag);
+			work.exec_prepared(SAVE_TAG, book_id, tag);
 		}
 
 		work.commit();
@@ -298,11 +266,7 @@ namespace postgres {
 	{
 		pqxx::work work{ connection_ };
 
-		std::string query_text = "DELETE FROM authors WHERE id = '";
-		query_text = query_text + author_id;
-		query_text = query_text + "';";
-
-		work.exec(query_text);
+		work.exec_prepared(DELETE_AUTHOR, author_id);
 
 		work.commit();
 	}
@@ -311,17 +275,8 @@ namespace postgres {
 	{
 		pqxx::work work{ connection_ };
 
-		std::string query_text = "DELETE FROM book_tags WHERE book_id = '";
-		query_text = query_text + book_id;
-		query_text = query_text + "';";
-
-		work.exec(query_text);
-
-		query_text = "DELETE FROM books WHERE id = '";
-		query_text = query_text + book_id;
-		query_text = query_text + "';";
-
-		work.exec(query_text);
+		work.exec_prepared(DELETE_TAGS, book_id);
+		work.exec_prepared(DELETE_BOOK, book_id);
 
 		work.commit();
 	}
@@ -340,6 +295,27 @@ namespace postgres {
 
 		// коммитим изменения
 		work.commit();
+
+		//Every query below is parsed and planned once, not on each call. PREPARE checks the tables,
+		//so it has to come after they are created
+		connection_.prepare(SAVE_AUTHOR, R"(INSERT INTO authors (id, name) VALUES ($1, $2) ON CONFLICT (id) DO UPDATE SET name=$2;)"_zv);
+		connection_.prepare(LOAD_AUTHORS, R"(SELECT id, name FROM authors ORDER BY name;)"_zv);
+		connection_.prepare(LOAD_AUTHOR, R"(SELECT id, name FROM authors WHERE id = $1;)"_zv);
+		connection_.prepare(LOAD_AUTHOR_BY_NAME, R"(SELECT id, name FROM authors WHERE name = $1;)"_zv);
+		connection_.prepare(EDIT_AUTHOR, R"(UPDATE authors SET name = $2 WHERE id = $1;)"_zv);
+		connection_.prepare(DELETE_AUTHOR, R"(DELETE FROM authors WHERE id = $1;)"_zv);
+
+		connection_.prepare(SAVE_BOOK, R"(INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4) ON CONFLICT (id) DO UPDATE SET author_id=$2, title=$3, publication_year=$4;)"_zv);
+		connection_.prepare(LOAD_BOOKS, R"(SELECT books.id, books.title, authors.name AS author_name, authors.id AS author_id, books.publication_year FROM books JOIN authors ON books.author_id = authors.id ORDER BY books.title ASC,authors.name ASC, books.publication_year ASC;)"_zv);
+		connection_.prepare(LOAD_BOOKS_BY_AUTHOR, R"(SELECT id, author_id, title, publication_year FROM books WHERE author_id = $1 ORDER BY publication_year, title;)"_zv);
+		connection_.prepare(LOAD_BOOKS_BY_TITLE, R"(SELECT id, author_id, title, publication_year FROM books WHERE title = $1 ORDER BY publication_year, title;)"_zv);
+		connection_.prepare(LOAD_BOOK, R"(SELECT id, author_id, title, publication_year FROM books WHERE id = $1;)"_zv);
+		connection_.prepare(EDIT_BOOK, R"(UPDATE books SET title = $2, publication_year = $3 WHERE id = $1;)"_zv);
+		connection_.prepare(DELETE_BOOK, R"(DELETE FROM books WHERE id = $1;)"_zv);
+
+		connection_.prepare(LOAD_TAGS, R"(SELECT tag FROM book_tags WHERE book_id = $1 ORDER BY tag;)"_zv);
+		connection_.prepare(SAVE_TAG, R"(INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);)"_zv);
+		connection_.prepare(DELETE_TAGS, R"(DELETE FROM book_tags WHERE book_id = $1;)"_zv);
 	}
 
 	/*
@@ -1,7 +1,17 @@
 ﻿#pragma once
+#include <cassert>
 #include <mutex>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
 #include <pqxx/connection>
 #include <pqxx/transaction>
 #include <pqxx/zview.hxx>
@@ -9,17 +19,65 @@
 
 namespace db
 {
-    class ConnectionPool
+    // Statement the server parses and plans once per connection
+    struct PreparedStatement
     {
-        using PoolType = ConnectionPool;
-        using ConnectionPtr = std::shared_ptr<pqxx::connection>;
+        std::string name;
+        std::string sql;
+
+        // Failed on a working connection, so it would fail on any. Stays in place, connections count past it
+        bool rejected = false;
+    };
+
+    // Opens connections on demand up to max_size while all of them are busy, and closes those idle for
+    // longer than the idle timeout down to min_size. Every connection comes out prepared for every
+    // registered statement: one opened or registered for later prepares what it lacks on checkout.
+    // A statement the server refuses on a working connection is dropped from the registry, so it
+    // can't fail every checkout after it. A connection that is no longer open is dropped when it comes back, a fresh one replaces it
+    template <typename Connection>
+    class BasicConnectionPool
+    {
+        using PoolType = BasicConnectionPool;
+        using ConnectionPtr = std::shared_ptr<Connection>;
+        using Clock = std::chrono::steady_clock;
+
+        struct Slot
+        {
+            ConnectionPtr conn;
+            std::uint64_t id = 0;
+
+            // Statements are prepared in the order of the registry, so a count is enough
+            std::size_t prepared = 0;
+            Clock::time_point idle_since;
+
+            // What the session's statement_timeout was last set to, zero until it is
+            std::chrono::milliseconds session_timeout{ 0 };
+        };
 
     public:
+        static constexpr std::chrono::milliseconds DEFAULT_IDLE_TIMEOUT{ 60'000 };
+
+        struct Stats
+        {
+            std::size_t size = 0;
+            std::size_t idle = 0;
+            std::uint64_t opened = 0;
+
+            // Came back broken
+            std::uint64_t dropped = 0;
+
+            // Closed after idling above min_size
+            std::uint64_t trimmed = 0;
+
+            // Statements dropped from the registry
+            std::uint64_t rejected = 0;
+        };
+
         class ConnectionWrapper
         {
         public:
-            ConnectionWrapper(std::shared_ptr<pqxx::connection>&& conn, PoolType& pool) noexcept
-                : conn_{ std::move(conn) }
+            ConnectionWrapper(Slot&& slot, PoolType& pool) noexcept
+                : slot_{ std::move(slot) }
                 , pool_{ &pool } {}
 
             ConnectionWrapper(const ConnectionWrapper&) = delete;
@@ -28,71 +86,268 @@ namespace db
             ConnectionWrapper(ConnectionWrapper&&) = default;
             ConnectionWrapper& operator=(ConnectionWrapper&&) = default;
 
-            pqxx::connection& operator*() const& noexcept
+            Connection& operator*() const& noexcept
             {
-                return *conn_;
+                return *slot_.conn;
             }
-            pqxx::connection& operator*() const&& = delete;
+            Connection& operator*() const&& = delete;
 
-            pqxx::connection* operator->() const& noexcept
+            Connection* operator->() const& noexcept
             {
-                return conn_.get();
+                return slot_.conn.get();
+            }
+
+            // Unique for the life of the pool, a replaced connection gets a new one
+            std::uint64_t GetId() const noexcept
+            {
+                return slot_.id;
+            }
+
+            // The pool only keeps it for whoever sets the timeout, and forgets it with the connection
+            std::chrono::milliseconds GetSessionTimeout() const noexcept
+            {
+                return slot_.session_timeout;
+            }
+
+            void SetSessionTimeout(std::chrono::milliseconds timeout) noexcept
+            {
+                slot_.session_timeout = timeout;
             }
 
             ~ConnectionWrapper()
             {
-                if (conn_)
+                if (slot_.conn)
                 {
-                    pool_->ReturnConnection(std::move(conn_));
+                    pool_->ReturnConnection(std::move(slot_));
                 }
             }
 
         private:
-            std::shared_ptr<pqxx::connection> conn_;
+            Slot slot_;
             PoolType* pool_;
         };
 
-        // ConnectionFactory is a functional object returning std::shared_ptr<pqxx::connection>
+        // ConnectionFactory is a functional object returning std::shared_ptr<Connection>
         template <typename ConnectionFactory>
-        ConnectionPool(size_t capacity, ConnectionFactory&& connection_factory)
+        BasicConnectionPool(size_t min_size, size_t max_size, ConnectionFactory&& connection_factory)
+            : factory_{ std::forward<ConnectionFactory>(connection_factory) }
+            , min_size_{ min_size }
+            , max_size_{ std::max(min_size, max_size) }
         {
-            pool_.reserve(capacity);
-            for (size_t i = 0; i < capacity; ++i)
+            for (size_t i = 0; i < min_size_; ++i)
             {
-                pool_.emplace_back(connection_factory());
+                idle_.push_back(Open());
+                idle_.back().idle_since = Clock::now();
             }
+
+            size_ = min_size_;
+        }
+
+        // Fixed size
+        template <typename ConnectionFactory>
+        BasicConnectionPool(size_t capacity, ConnectionFactory&& connection_factory)
+            : BasicConnectionPool(capacity, capacity, std::forward<ConnectionFactory>(connection_factory)) {}
+
+        // Every connection prepares the statement before it is handed out next. Names must be unique.
+        // If it fails on a working connection it is dropped and counted in Stats::rejected
+        void Prepare(std::string name, std::string sql)
+        {
+            std::lock_guard lock{ mutex_ };
+            statements_.push_back({ std::move(name), std::move(sql) });
+        }
+
+        void SetIdleTimeout(std::chrono::milliseconds timeout)
+        {
+            std::lock_guard lock{ mutex_ };
+            idle_timeout_ = timeout;
         }
 
         ConnectionWrapper GetConnection()
         {
-            std::unique_lock lock{ mutex_ };
-            // Блокируем текущий поток и ждём, пока cond_var_ не получит уведомление и не освободится
-            // хотя бы одно соединение
-            cond_var_.wait(lock, [this]
+            Slot slot;
+            std::vector<Slot> expired;
+
+            {
+                std::unique_lock lock{ mutex_ };
+                // Блокируем текущий поток и ждём, пока освободится хотя бы одно соединение
+                // или пока пул может открыть ещё одно
+                cond_var_.wait(lock, [this]
+                    {
+                        return !idle_.empty() || size_ < max_size_;
+                    });
+
+                if (!idle_.empty())
+                {
+                    // The most recently used one, so the rest can age out
+                    slot = std::move(idle_.back());
+                    idle_.pop_back();
+                }
+                else
+                {
+                    ++size_;
+                }
+
+                Trim(expired);
+            }
+
+            try
+            {
+                // An idle connection may have been closed by the server meanwhile
+                if (!slot.conn || !slot.conn->is_open())
                 {
-                    return used_connections_ < pool_.size();
-                });
-            // После выхода из цикла ожидания мьютекс остаётся захваченным
+                    slot = Open();
+                }
+
+                PrepareMissing(slot);
+            }
+            catch (...)
+            {
+                {
+                    std::lock_guard lock{ mutex_ };
+                    --size_;
+                }
+
+                cond_var_.notify_one();
+                throw;
+            }
 
-            return { std::move(pool_[used_connections_++]), *this };
+            return { std::move(slot), *this };
+        }
+
+        Stats GetStats() const
+        {
+            std::lock_guard lock{ mutex_ };
+            return { size_, idle_.size(), opened_, dropped_, trimmed_, rejected_ };
         }
 
     private:
-        void ReturnConnection(ConnectionPtr&& conn)
+        Slot Open()
+        {
+            Slot slot;
+
+            slot.conn = factory_();
+            slot.id = next_id_++;
+
+            std::lock_guard lock{ mutex_ };
+            ++opened_;
+
+            return slot;
+        }
+
+        void PrepareMissing(Slot& slot)
+        {
+            std::vector<PreparedStatement> missing;
+
+            {
+                std::lock_guard lock{ mutex_ };
+
+                if (slot.prepared == statements_.size())
+                {
+                    return;
+                }
+
+                missing.assign(statements_.begin() + slot.prepared, statements_.end());
+            }
+
+            for (const PreparedStatement& statement : missing)
+            {
+                if (!statement.rejected)
+                {
+                    try
+                    {
+                        slot.conn->prepare(statement.name, statement.sql);
+                    }
+                    catch (...)
+                    {
+                        // A broken connection gets replaced, the statement may well be fine
+                        if (!slot.conn->is_open())
+                        {
+                            throw;
+                        }
+
+                        Reject(slot.prepared);
+                    }
+                }
+
+                ++slot.prepared;
+            }
+        }
+
+        void Reject(std::size_t index)
+        {
+            std::lock_guard lock{ mutex_ };
+
+            if (!statements_[index].rejected)
+            {
+                statements_[index].rejected = true;
+                ++rejected_;
+            }
+        }
+
+        // Closes connections idle for too long, the oldest are at the front
+        void Trim(std::vector<Slot>& expired)
+        {
+            const Clock::time_point now = Clock::now();
+
+            while (size_ > min_size_ && !idle_.empty() && now - idle_.front().idle_since > idle_timeout_)
+            {
+                expired.push_back(std::move(idle_.front()));
+                idle_.pop_front();
+
+                --size_;
+                ++trimmed_;
+            }
+        }
+
+        void ReturnConnection(Slot&& slot)
         {
+            // Closing a connection talks to the server, so it happens after the lock is released
+            std::vector<Slot> expired;
+            const bool broken = !slot.conn->is_open();
+
             // Возвращаем соединение обратно в пул
             {
                 std::lock_guard lock{ mutex_ };
-                assert(used_connections_ != 0);
-                pool_[--used_connections_] = std::move(conn);
+                assert(size_ != 0);
+
+                if (broken)
+                {
+                    expired.push_back(std::move(slot));
+
+                    --size_;
+                    ++dropped_;
+                }
+                else
+                {
+                    slot.idle_since = Clock::now();
+                    idle_.push_back(std::move(slot));
+                }
+
+                Trim(expired);
             }
             // Уведомляем один из ожидающих потоков об изменении состояния пула
             cond_var_.notify_one();
         }
 
-        std::mutex mutex_;
+        std::function<ConnectionPtr()> factory_;
+        const size_t min_size_;
+        const size_t max_size_;
+
+        mutable std::mutex mutex_;
         std::condition_variable cond_var_;
-        std::vector<ConnectionPtr> pool_;
-        size_t used_connections_ = 0;
+        std::deque<Slot> idle_;
+        std::vector<PreparedStatement> statements_;
+        std::chrono::milliseconds idle_timeout_ = DEFAULT_IDLE_TIMEOUT;
+
+        // Open connections and those being opened, idle or not
+        size_t size_ = 0;
+
+        std::atomic<std::uint64_t> next_id_ = 1;
+        std::uint64_t opened_ = 0;
+        std::uint64_t dropped_ = 0;
+        std::uint64_t trimmed_ = 0;
+        std::uint64_t rejected_ = 0;
     };
+
+    using ConnectionPool = BasicConnectionPool<pqxx::connection>;
 }
\ No newline at end of file
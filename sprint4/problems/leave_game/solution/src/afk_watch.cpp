@@ -0,0 +1,110 @@
+#include "afk_watch.h"
+#include "model.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace model
+{
+	void AfkWatch::Advance(const Map& map, PlayerList& players, std::span<const util::SlotKey> joined, int ms)
+	{
+		players_ = &players;
+
+		for (util::SlotKey key : joined)
+		{
+			Track(map, key);
+		}
+
+		//Actions since the last tick and stops made during it, they all happened at its end
+		for (const DogStore::VelocityChange& change : map.GetDogs().TakeVelocityChanges())
+		{
+			if (FindPlayer(change.slot) != nullptr)
+			{
+				Age(change.slot, change.was_moving);
+			}
+
+			Schedule(map, change.slot);
+		}
+
+		expired_.clear();
+		wheel_.Advance(wheel_.GetNow() + std::max(ms, 0), [this](DogStore::Slot slot) { expired_.push_back(slot); });
+
+		for (DogStore::Slot slot : expired_)
+		{
+			timers_[slot] = {};
+
+			if (FindPlayer(slot) != nullptr)
+			{
+				Age(slot, false);
+			}
+		}
+	}
+
+	void AfkWatch::Track(const Map& map, util::SlotKey key)
+	{
+		const Player* player = players_->Find(key);
+
+		if (player == nullptr)
+		{
+			return;
+		}
+
+		DogStore::Slot slot = player->GetDog()->GetSlot();
+
+		if (slot >= keys_.size())
+		{
+			size_t size = std::max(slot + 1, map.GetDogs().Size());
+
+			keys_.resize(size);
+			timers_.resize(size);
+			aged_at_.resize(size, 0);
+		}
+
+		keys_[slot] = key;
+		aged_at_[slot] = wheel_.GetNow();
+
+		Schedule(map, slot);
+	}
+
+	Player* AfkWatch::FindPlayer(DogStore::Slot slot) const
+	{
+		return slot < keys_.size() ? players_->Find(keys_[slot]) : nullptr;
+	}
+
+	void AfkWatch::Schedule(const Map& map, DogStore::Slot slot)
+	{
+		if (slot >= timers_.size())
+		{
+			return;
+		}
+
+		wheel_.Cancel(timers_[slot]);
+		timers_[slot] = {};
+
+		const Player* player = FindPlayer(slot);
+
+		if (player == nullptr || player->IsRetired())
+		{
+			return;
+		}
+
+		const DogStore& dogs = map.GetDogs();
+
+		if (dogs.GetVelX(slot) == 0 && dogs.GetVelY(slot) == 0)
+		{
+			//Rounded up, so reaching the deadline always brings the idle time up to the threshold
+			Wheel::Tick left = static_cast<Wheel::Tick>(std::ceil(std::max(map.GetAFK() - player->GetIdleTime(), 0.0)));
+
+			timers_[slot] = wheel_.Schedule(aged_at_[slot] + left, slot);
+		}
+	}
+
+	void AfkWatch::Age(DogStore::Slot slot, bool moving)
+	{
+		int ms = static_cast<int>(wheel_.GetNow() - aged_at_[slot]);
+
+		aged_at_[slot] = wheel_.GetNow();
+
+		FindPlayer(slot)->AddTime(ms, moving);
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "kinetic_engine.h"
+#include "model_core.h"
+#include "timing_wheel.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace model
+{
+	//Retires the players of a ticked map who stand still for too long. A dog that stops gets its deadline
+	//in a timing wheel and moving again cancels it, so a tick only touches the players who were steered
+	//or ran out of time instead of counting the idle time of everybody.
+	//Belongs to the map's strand like the map itself
+	class AfkWatch
+	{
+	public:
+		using Wheel = util::TimingWheel<DogStore::Slot>;
+
+		//Runs the watch to the end of the coming tick and retires the players whose time is up in it.
+		//Joined are the keys of the players added to the list since the last call. Has to run before
+		//the dogs are moved, the stops they make on the way are picked up by the next call
+		void Advance(const Map& map, PlayerList& players, std::span<const util::SlotKey> joined, int ms);
+
+		//Standing dogs waiting for their deadline
+		size_t GetPendingCount() const
+		{
+			return wheel_.Size();
+		}
+
+	private:
+		void Track(const Map& map, util::SlotKey key);
+
+		//Player of a tracked dog, nullptr once released
+		Player* FindPlayer(DogStore::Slot slot) const;
+
+		//Drops the deadline of the dog and sets a new one if it stands
+		void Schedule(const Map& map, DogStore::Slot slot);
+
+		//Brings the age of the player up to now. The dog either moved or stood still since the last time
+		void Age(DogStore::Slot slot, bool moving);
+
+		//Ticks are milliseconds since the first Advance
+		Wheel wheel_;
+
+		//List of the map being advanced
+		PlayerList* players_ = nullptr;
+
+		//By dog slot. A slot freed and taken by another dog gets the key of the new player
+		std::vector<util::SlotKey> keys_;
+		std::vector<Wheel::Timer> timers_;
+		std::vector<Wheel::Tick> aged_at_;
+
+		//Scratch space for the slots running out of time
+		std::vector<DogStore::Slot> expired_;
+	};
+}
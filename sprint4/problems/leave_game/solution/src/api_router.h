@@ -0,0 +1,355 @@
+#pragma once
+
+#define BOOST_BEAST_USE_STD_STRING_VIEW
+
+#include <boost/beast/http/verb.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace http_handler
+{
+	namespace http = boost::beast::http;
+
+	enum class Endpoint : std::uint8_t
+	{
+		MAPS,
+		MAP,
+		TICK,
+		JOIN,
+		RECORDS,
+		RECORD_RANK,
+		PLAYERS,
+		STATE,
+		ACTION
+	};
+
+	namespace method
+	{
+		constexpr std::uint8_t GET = 1;
+		constexpr std::uint8_t HEAD = 2;
+		constexpr std::uint8_t POST = 4;
+	}
+
+	constexpr std::uint8_t MethodBit(http::verb verb)
+	{
+		switch (verb)
+		{
+		case http::verb::get:
+			return method::GET;
+
+		case http::verb::head:
+			return method::HEAD;
+
+		case http::verb::post:
+			return method::POST;
+
+		default:
+			return 0;
+		}
+	}
+
+	//Value of the Allow header for a set of methods
+	constexpr std::string_view AllowedMethods(std::uint8_t methods)
+	{
+		constexpr std::array<std::string_view, 8> ALLOW
+		{
+			"", "GET", "HEAD", "GET, HEAD", "POST", "GET, POST", "HEAD, POST", "GET, HEAD, POST"
+		};
+
+		return ALLOW[methods & 7];
+	}
+
+	//Body of 405 for a route. POST-only routes name the method they expect
+	constexpr std::string_view MethodNotAllowedBody(std::uint8_t methods)
+	{
+		return methods == method::POST
+			? R"({"code":"invalidMethod","message":"Only POST method is expected"})"
+			: R"({"code":"invalidMethod","message":"Invalid method"})";
+	}
+
+	struct Route
+	{
+		//Segments separated by '/', "{name}" captures a single segment
+		std::string_view pattern;
+		Endpoint endpoint;
+		std::uint8_t methods;
+	};
+
+	struct RouteMatch
+	{
+		//nullptr if no route has this path
+		const Route* route = nullptr;
+		bool method_allowed = false;
+
+		//Captured {name} segment, if the route has one
+		std::string_view param;
+		std::string_view query;
+	};
+
+	//Segment trie built at compile time. Matching walks the target once and never allocates.
+	//A single trailing slash is ignored, so "/api/v1/maps/" is the same as "/api/v1/maps"
+	template <std::size_t N, std::size_t MAX_NODES = 32>
+	class Router
+	{
+	public:
+		constexpr explicit Router(const std::array<Route, N>& routes)
+			: routes_(routes)
+		{
+			for (std::size_t i = 0; i < N; ++i)
+			{
+				Insert(static_cast<std::int16_t>(i));
+			}
+		}
+
+		constexpr RouteMatch Match(std::string_view target, http::verb verb) const
+		{
+			RouteMatch result;
+
+			if (size_t question = target.find('?'); question != std::string_view::npos)
+			{
+				result.query = target.substr(question + 1);
+				target = target.substr(0, question);
+			}
+
+			if (!target.starts_with('/'))
+			{
+				return result;
+			}
+
+			target.remove_prefix(1);
+
+			if (target.ends_with('/'))
+			{
+				target.remove_suffix(1);
+			}
+
+			std::int16_t node = 0;
+
+			while (node >= 0)
+			{
+				if (target.empty())
+				{
+					break;
+				}
+
+				size_t slash = target.find('/');
+				std::string_view segment = target.substr(0, slash);
+				target = slash == std::string_view::npos ? std::string_view{} : target.substr(slash + 1);
+
+				if (segment.empty())
+				{
+					return result;
+				}
+
+				std::int16_t next = FindChild(node, segment, false);
+
+				if (next < 0)
+				{
+					next = FindChild(node, {}, true);
+					result.param = segment;
+				}
+
+				node = next;
+			}
+
+			if (node < 0 || nodes_[node].route < 0)
+			{
+				result.param = {};
+				return result;
+			}
+
+			result.route = &routes_[nodes_[node].route];
+			result.method_allowed = (result.route->methods & MethodBit(verb)) != 0;
+
+			return result;
+		}
+
+	private:
+		struct Node
+		{
+			std::string_view segment;
+			bool is_param = false;
+			std::int16_t first_child = -1;
+			std::int16_t next_sibling = -1;
+			std::int16_t route = -1;
+		};
+
+		constexpr std::int16_t FindChild(std::int16_t node, std::string_view segment, bool is_param) const
+		{
+			for (std::int16_t child = nodes_[node].first_child; child >= 0; child = nodes_[child].next_sibling)
+			{
+				if (nodes_[child].is_param == is_param && (is_param || nodes_[child].segment == segment))
+				{
+					return child;
+				}
+			}
+
+			return -1;
+		}
+
+		constexpr void Insert(std::int16_t route)
+		{
+			std::string_view pattern = routes_[route].pattern;
+
+			if (!pattern.starts_with('/'))
+			{
+				throw std::logic_error("Route pattern must start with '/'");
+			}
+
+			pattern.remove_prefix(1);
+
+			std::int16_t node = 0;
+
+			while (!pattern.empty())
+			{
+				size_t slash = pattern.find('/');
+				std::string_view segment = pattern.substr(0, slash);
+				pattern = slash == std::string_view::npos ? std::string_view{} : pattern.substr(slash + 1);
+
+				bool is_param = segment.starts_with('{') && segment.ends_with('}');
+				std::int16_t child = FindChild(node, segment, is_param);
+
+				if (child < 0)
+				{
+					if (size_ == MAX_NODES)
+					{
+						throw std::logic_error("Too many route segments");
+					}
+
+					child = static_cast<std::int16_t>(size_++);
+					nodes_[child] = { is_param ? std::string_view{} : segment, is_param, -1, nodes_[node].first_child, -1 };
+					nodes_[node].first_child = child;
+				}
+
+				node = child;
+			}
+
+			if (nodes_[node].route >= 0)
+			{
+				throw std::logic_error("Duplicate route");
+			}
+
+			nodes_[node].route = route;
+		}
+
+		std::array<Route, N> routes_;
+		std::array<Node, MAX_NODES> nodes_{};
+		std::size_t size_ = 1;
+	};
+
+	inline constexpr std::array API_ROUTES
+	{
+		Route{ "/api/v1/maps", Endpoint::MAPS, method::GET | method::HEAD },
+		Route{ "/api/v1/maps/{id}", Endpoint::MAP, method::GET | method::HEAD },
+		Route{ "/api/v1/game/tick", Endpoint::TICK, method::POST },
+		Route{ "/api/v1/game/join", Endpoint::JOIN, method::POST },
+		Route{ "/api/v1/game/records", Endpoint::RECORDS, method::GET | method::HEAD },
+		Route{ "/api/v1/game/records/rank", Endpoint::RECORD_RANK, method::GET | method::HEAD },
+		Route{ "/api/v1/game/players", Endpoint::PLAYERS, method::GET | method::HEAD },
+		Route{ "/api/v1/game/state", Endpoint::STATE, method::GET | method::HEAD },
+		Route{ "/api/v1/game/player/action", Endpoint::ACTION, method::POST }
+	};
+
+	inline constexpr Router API_ROUTER{ API_ROUTES };
+
+	//Looks up a query parameter. Values are returned as is, without percent-decoding
+	constexpr std::optional<std::string_view> FindQueryParam(std::string_view query, std::string_view name)
+	{
+		while (!query.empty())
+		{
+			size_t amp = query.find('&');
+			std::string_view pair = query.substr(0, amp);
+			query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+			size_t eq = pair.find('=');
+
+			if (pair.substr(0, eq) == name)
+			{
+				return eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	//Leaves value untouched if the parameter is missing. Returns false if it isn't a number
+	inline bool ReadQueryParam(std::string_view query, std::string_view name, int& value)
+	{
+		auto param = FindQueryParam(query, name);
+
+		if (!param)
+		{
+			return true;
+		}
+
+		auto [ptr, ec] = std::from_chars(param->data(), param->data() + param->size(), value);
+		return ec == std::errc{} && ptr == param->data() + param->size();
+	}
+
+	//Percent-decoded value, '+' is a space as in forms. Leaves value untouched if the parameter is missing.
+	//Returns false on a broken escape
+	inline bool ReadQueryParam(std::string_view query, std::string_view name, std::string& value)
+	{
+		auto param = FindQueryParam(query, name);
+
+		if (!param)
+		{
+			return true;
+		}
+
+		auto hex = [](char c)
+		{
+			if (c >= '0' && c <= '9')
+			{
+				return c - '0';
+			}
+
+			c = static_cast<char>(c | 0x20);
+			return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+		};
+
+		std::string decoded;
+		decoded.reserve(param->size());
+
+		for (size_t i = 0; i < param->size(); ++i)
+		{
+			char c = (*param)[i];
+
+			if (c == '+')
+			{
+				decoded.push_back(' ');
+			}
+			else if (c != '%')
+			{
+				decoded.push_back(c);
+			}
+			else
+			{
+				if (i + 2 >= param->size())
+				{
+					return false;
+				}
+
+				int high = hex((*param)[i + 1]);
+				int low = hex((*param)[i + 2]);
+
+				if (high < 0 || low < 0)
+				{
+					return false;
+				}
+
+				decoded.push_back(static_cast<char>(high * 16 + low));
+				i += 2;
+			}
+		}
+
+		value = std::move(decoded);
+		return true;
+	}
+}
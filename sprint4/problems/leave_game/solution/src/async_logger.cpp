@@ -0,0 +1,405 @@
+#include "async_logger.h"
+
+#include <boost/date_time/c_local_time_adjustor.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/json.hpp>
+
+#include <charconv>
+#include <condition_variable>
+#include <stdexcept>
+
+namespace async_log
+{
+	namespace json = boost::json;
+	namespace pt = boost::posix_time;
+
+	namespace
+	{
+		constexpr std::array<std::string_view, static_cast<std::size_t>(Event::COUNT)> EVENT_NAMES
+		{
+			"request_received",
+			"response_sent",
+			"generated_item",
+			"collected_item",
+			"map_tick"
+		};
+
+		std::string FormatTimestamp(std::chrono::system_clock::time_point time)
+		{
+			auto us = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+			pt::ptime utc = pt::from_time_t(static_cast<std::time_t>(us / 1'000'000)) + pt::microseconds(us % 1'000'000);
+
+			//Boost.Log records used microsec_clock::local_time(), so keep the local time
+			return pt::to_iso_extended_string(boost::date_time::c_local_adjustor<pt::ptime>::utc_to_local(utc));
+		}
+
+		void AppendLine(std::string& out, const std::string& timestamp, json::object data, std::string_view message)
+		{
+			json::object final_obj;
+			final_obj.emplace("timestamp", timestamp);
+			final_obj.emplace("data", std::move(data));
+			final_obj.emplace("message", message);
+
+			out.append(json::serialize(final_obj));
+			out.push_back('\n');
+		}
+	}
+
+	//===Ring===
+
+	Ring::Ring()
+		: records_(std::make_unique<Record[]>(CAPACITY))
+	{
+		static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Ring capacity must be a power of two");
+	}
+
+	bool Ring::Push(const Record& record)
+	{
+		std::size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head - tail_.load(std::memory_order_acquire) == CAPACITY)
+		{
+			return false;
+		}
+
+		records_[head & (CAPACITY - 1)] = record;
+		head_.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	std::size_t Ring::Drain(std::vector<Record>& out)
+	{
+		std::size_t tail = tail_.load(std::memory_order_relaxed);
+		std::size_t head = head_.load(std::memory_order_acquire);
+
+		for (std::size_t i = tail; i != head; ++i)
+		{
+			out.push_back(records_[i & (CAPACITY - 1)]);
+		}
+
+		tail_.store(head, std::memory_order_release);
+
+		return head - tail;
+	}
+
+	bool Ring::Empty() const
+	{
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+	//===Logger===
+
+	Logger& Logger::Instance()
+	{
+		static Logger logger;
+		return logger;
+	}
+
+	Logger::Logger()
+	{
+		for (auto& every_nth : sampling_)
+		{
+			every_nth.store(1, std::memory_order_relaxed);
+		}
+
+		//One line per map per tick is too much by default, --log-sampling map_tick=N turns it on
+		sampling_[static_cast<std::size_t>(Event::MAP_TICK)].store(0, std::memory_order_relaxed);
+	}
+
+	Logger::~Logger()
+	{
+		Stop();
+	}
+
+	void Logger::Start(std::FILE* out)
+	{
+		if (running_.exchange(true))
+		{
+			return;
+		}
+
+		out_ = out;
+		worker_ = std::jthread([this](std::stop_token stop)
+			{
+				Run(stop);
+			});
+	}
+
+	void Logger::Stop()
+	{
+		if (!running_.exchange(false))
+		{
+			return;
+		}
+
+		worker_.request_stop();
+		worker_.join();
+	}
+
+	void Logger::SetSampling(Event event, unsigned every_nth)
+	{
+		sampling_[static_cast<std::size_t>(event)].store(every_nth, std::memory_order_relaxed);
+	}
+
+	void Logger::ConfigureSampling(std::string_view spec)
+	{
+		std::size_t eq = spec.find('=');
+
+		if (eq == std::string_view::npos)
+		{
+			throw std::invalid_argument("Log sampling must look like event=N");
+		}
+
+		std::string_view name = spec.substr(0, eq);
+		std::string_view number = spec.substr(eq + 1);
+
+		auto iter = std::find(EVENT_NAMES.begin(), EVENT_NAMES.end(), name);
+
+		if (iter == EVENT_NAMES.end())
+		{
+			throw std::invalid_argument("Unknown log event: " + std::string(name));
+		}
+
+		unsigned every_nth = 0;
+		auto [ptr, ec] = std::from_chars(number.data(), number.data() + number.size(), every_nth);
+
+		if (ec != std::errc{} || ptr != number.data() + number.size())
+		{
+			throw std::invalid_argument("Invalid log sampling rate: " + std::string(number));
+		}
+
+		SetSampling(static_cast<Event>(iter - EVENT_NAMES.begin()), every_nth);
+	}
+
+	std::uint64_t Logger::GetDroppedCount() const
+	{
+		std::lock_guard lock{ rings_mutex_ };
+
+		std::uint64_t result = retired_dropped_;
+
+		for (const auto& ring : rings_)
+		{
+			result += ring->dropped.load(std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	Ring& Logger::LocalRing()
+	{
+		struct RingOwner
+		{
+			std::shared_ptr<Ring> ring;
+
+			~RingOwner()
+			{
+				if (ring)
+				{
+					ring->abandoned.store(true, std::memory_order_release);
+				}
+			}
+		};
+
+		thread_local RingOwner owner;
+
+		if (!owner.ring)
+		{
+			owner.ring = std::make_shared<Ring>();
+
+			std::lock_guard lock{ rings_mutex_ };
+			rings_.push_back(owner.ring);
+		}
+
+		return *owner.ring;
+	}
+
+	void Logger::Run(std::stop_token stop)
+	{
+		std::mutex wait_mutex;
+		std::condition_variable_any wakeup;
+
+		while (!stop.stop_requested())
+		{
+			//Rings are filling up faster than we write, go again right away
+			if (Flush() >= Ring::CAPACITY / 2)
+			{
+				continue;
+			}
+
+			std::unique_lock lock{ wait_mutex };
+			wakeup.wait_for(lock, stop, FLUSH_INTERVAL, []
+				{
+					return false;
+				});
+		}
+
+		Flush();
+	}
+
+	std::size_t Logger::Flush()
+	{
+		batch_.clear();
+		std::uint64_t dropped = 0;
+
+		{
+			std::lock_guard lock{ rings_mutex_ };
+
+			for (const auto& ring : rings_)
+			{
+				ring->Drain(batch_);
+			}
+
+			//Abandoned rings get no more records, so once they're empty they can go
+			std::erase_if(rings_, [this](const std::shared_ptr<Ring>& ring)
+				{
+					if (!ring->abandoned.load(std::memory_order_acquire) || !ring->Empty())
+					{
+						return false;
+					}
+
+					retired_dropped_ += ring->dropped.load(std::memory_order_relaxed);
+					return true;
+				});
+
+			dropped = retired_dropped_;
+
+			for (const auto& ring : rings_)
+			{
+				dropped += ring->dropped.load(std::memory_order_relaxed);
+			}
+		}
+
+		if (batch_.empty() && dropped == reported_dropped_)
+		{
+			return 0;
+		}
+
+		//Every ring is in order on its own, merging them only needs a sort by time
+		std::stable_sort(batch_.begin(), batch_.end(), [](const Record& l, const Record& r)
+			{
+				return l.time < r.time;
+			});
+
+		buffer_.clear();
+
+		for (const Record& record : batch_)
+		{
+			FormatRecord(record, buffer_);
+		}
+
+		if (dropped != reported_dropped_)
+		{
+			json::object logger_data{ {"dropped", dropped - reported_dropped_}, {"total", dropped} };
+			AppendLine(buffer_, FormatTimestamp(std::chrono::system_clock::now()), std::move(logger_data), "log records dropped");
+
+			reported_dropped_ = dropped;
+		}
+
+		std::fwrite(buffer_.data(), 1, buffer_.size(), out_);
+		std::fflush(out_);
+
+		return batch_.size();
+	}
+
+	void Logger::FormatRecord(const Record& record, std::string& out) const
+	{
+		std::visit([&record, &out](const auto& payload)
+			{
+				using Payload = std::decay_t<decltype(payload)>;
+
+				json::object logger_data;
+				std::string_view message;
+
+				if constexpr (std::is_same_v<Payload, RequestReceived>)
+				{
+					logger_data.emplace("ip", payload.ip.View());
+					logger_data.emplace("URI", payload.uri.View());
+					logger_data.emplace("method", payload.method.View());
+					message = "request received";
+				}
+				else if constexpr (std::is_same_v<Payload, ResponseSent>)
+				{
+					logger_data.emplace("response_time", payload.response_time);
+					logger_data.emplace("code", payload.code);
+
+					if (payload.content_type.size == 0)
+					{
+						logger_data.emplace("content_type", "null");
+					}
+					else
+					{
+						logger_data.emplace("content_type", payload.content_type.View());
+					}
+
+					message = "response sent";
+				}
+				else if constexpr (std::is_same_v<Payload, GeneratedItem>)
+				{
+					logger_data.emplace("ID", payload.id);
+					logger_data.emplace("Type", payload.type);
+					logger_data.emplace("Value", payload.value);
+					logger_data.emplace("Position X", payload.x);
+					logger_data.emplace("Position Y", payload.y);
+					message = "generated item";
+				}
+				else if constexpr (std::is_same_v<Payload, CollectedItem>)
+				{
+					logger_data.emplace("Player ID", payload.player_id);
+					logger_data.emplace("Item ID", payload.item_id);
+					logger_data.emplace("Type", payload.type);
+					logger_data.emplace("Value", payload.value);
+					logger_data.emplace("Total Count", payload.total_count);
+					message = "collected item";
+				}
+				else if constexpr (std::is_same_v<Payload, MapTick>)
+				{
+					logger_data.emplace("map", payload.map_id.View());
+					logger_data.emplace("duration_us", payload.duration_us);
+					logger_data.emplace("players", payload.player_count);
+					logger_data.emplace("items", payload.item_count);
+					message = "map ticked";
+				}
+
+				AppendLine(out, FormatTimestamp(record.time), std::move(logger_data), message);
+			}, record.payload);
+	}
+
+	//===Producers===
+
+	void LogRequestReceived(std::string_view ip, std::string_view uri, std::string_view method)
+	{
+		RequestReceived payload;
+		payload.ip.Assign(ip);
+		payload.uri.Assign(uri);
+		payload.method.Assign(method);
+
+		Logger::Instance().Log(payload);
+	}
+
+	void LogResponseSent(std::int64_t response_time, int code, std::string_view content_type)
+	{
+		ResponseSent payload{ response_time, code };
+		payload.content_type.Assign(content_type);
+
+		Logger::Instance().Log(payload);
+	}
+
+	void LogGeneratedItem(int id, int type, std::int64_t value, double x, double y)
+	{
+		Logger::Instance().Log(GeneratedItem{ id, type, value, x, y });
+	}
+
+	void LogCollectedItem(std::size_t player_id, int item_id, int type, std::int64_t value, std::size_t total_count)
+	{
+		Logger::Instance().Log(CollectedItem{ player_id, item_id, type, value, total_count });
+	}
+
+	void LogMapTick(std::string_view map_id, std::int64_t duration_us, std::size_t player_count, std::size_t item_count)
+	{
+		MapTick payload{ {}, duration_us, player_count, item_count };
+		payload.map_id.Assign(map_id);
+
+		Logger::Instance().Log(payload);
+	}
+}
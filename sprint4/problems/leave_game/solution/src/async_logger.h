@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace async_log
+{
+	//Events that are logged on every request or every tick.
+	//Everything else (errors, start and exit) is rare and still goes through Boost.Log
+	enum class Event : std::uint8_t
+	{
+		REQUEST_RECEIVED,
+		RESPONSE_SENT,
+		GENERATED_ITEM,
+		COLLECTED_ITEM,
+		MAP_TICK,
+		COUNT
+	};
+
+	//Copies the string into the record, long strings are truncated
+	template <std::size_t N>
+	struct FixedString
+	{
+		std::array<char, N> data;
+		std::uint16_t size = 0;
+
+		void Assign(std::string_view str)
+		{
+			size = static_cast<std::uint16_t>(std::min(str.size(), N));
+			str.copy(data.data(), size);
+		}
+
+		std::string_view View() const
+		{
+			return { data.data(), size };
+		}
+	};
+
+	struct RequestReceived
+	{
+		static constexpr Event EVENT = Event::REQUEST_RECEIVED;
+
+		FixedString<48> ip;
+		FixedString<256> uri;
+		FixedString<16> method;
+	};
+
+	struct ResponseSent
+	{
+		static constexpr Event EVENT = Event::RESPONSE_SENT;
+
+		std::int64_t response_time;
+		int code;
+		FixedString<64> content_type;
+	};
+
+	struct GeneratedItem
+	{
+		static constexpr Event EVENT = Event::GENERATED_ITEM;
+
+		int id;
+		int type;
+		std::int64_t value;
+		double x;
+		double y;
+	};
+
+	struct CollectedItem
+	{
+		static constexpr Event EVENT = Event::COLLECTED_ITEM;
+
+		std::size_t player_id;
+		int item_id;
+		int type;
+		std::int64_t value;
+		std::size_t total_count;
+	};
+
+	struct MapTick
+	{
+		static constexpr Event EVENT = Event::MAP_TICK;
+
+		FixedString<64> map_id;
+		std::int64_t duration_us;
+		std::size_t player_count;
+		std::size_t item_count;
+	};
+
+	//Fixed layout, so producers never allocate
+	struct Record
+	{
+		std::chrono::system_clock::time_point time;
+		std::variant<RequestReceived, ResponseSent, GeneratedItem, CollectedItem, MapTick> payload;
+	};
+
+	//Single producer, single consumer ring. Each producing thread owns one
+	class Ring
+	{
+	public:
+		static constexpr std::size_t CAPACITY = 4096;
+
+		Ring();
+
+		//Producer side. Returns false if the ring is full
+		bool Push(const Record& record);
+
+		//Consumer side. Appends everything that is in the ring to out
+		std::size_t Drain(std::vector<Record>& out);
+
+		bool Empty() const;
+
+		//Only the owning thread writes these, so no read-modify-write is needed
+		std::array<std::uint64_t, static_cast<std::size_t>(Event::COUNT)> seen{};
+		std::atomic<std::uint64_t> dropped{ 0 };
+
+		//Set when the owning thread exits, the ring is removed once it is drained
+		std::atomic<bool> abandoned{ false };
+
+	private:
+		std::unique_ptr<Record[]> records_;
+
+		alignas(64) std::atomic<std::size_t> head_{ 0 };
+		alignas(64) std::atomic<std::size_t> tail_{ 0 };
+	};
+
+	//Producers only copy a record into their own ring. One background thread
+	//merges the rings, formats records the same way MyFormatter does and writes them in batches
+	class Logger
+	{
+	public:
+		static constexpr std::chrono::milliseconds FLUSH_INTERVAL{ 20 };
+
+		static Logger& Instance();
+
+		Logger(const Logger&) = delete;
+		Logger& operator=(const Logger&) = delete;
+
+		void Start(std::FILE* out = stdout);
+
+		//Writes out whatever is left and stops the background thread
+		void Stop();
+
+		//Keeps one of every_nth records of the event, 1 keeps all of them and 0 turns the event off
+		void SetSampling(Event event, unsigned every_nth);
+
+		//Parses "event=N", e.g. "response_sent=10". Throws std::invalid_argument on a bad spec
+		void ConfigureSampling(std::string_view spec);
+
+		//Records lost because a ring was full
+		std::uint64_t GetDroppedCount() const;
+
+		template <typename Payload>
+		void Log(const Payload& payload)
+		{
+			if (!running_.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			constexpr auto event = static_cast<std::size_t>(Payload::EVENT);
+			unsigned every_nth = sampling_[event].load(std::memory_order_relaxed);
+			Ring& ring = LocalRing();
+
+			if (every_nth == 0 || ring.seen[event]++ % every_nth != 0)
+			{
+				return;
+			}
+
+			if (!ring.Push(Record{ std::chrono::system_clock::now(), payload }))
+			{
+				ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			}
+		}
+
+	private:
+		Logger();
+		~Logger();
+
+		Ring& LocalRing();
+
+		void Run(std::stop_token stop);
+
+		//Drains every ring and writes the batch. Returns the number of records written
+		std::size_t Flush();
+
+		void FormatRecord(const Record& record, std::string& out) const;
+
+		std::atomic<bool> running_{ false };
+		std::array<std::atomic<unsigned>, static_cast<std::size_t>(Event::COUNT)> sampling_;
+
+		mutable std::mutex rings_mutex_;
+		std::vector<std::shared_ptr<Ring>> rings_;
+		//Dropped records of rings whose threads have exited
+		std::uint64_t retired_dropped_ = 0;
+
+		//Used by the background thread only
+		std::FILE* out_ = stdout;
+		std::vector<Record> batch_;
+		std::string buffer_;
+		std::uint64_t reported_dropped_ = 0;
+
+		std::jthread worker_;
+	};
+
+	void LogRequestReceived(std::string_view ip, std::string_view uri, std::string_view method);
+	void LogResponseSent(std::int64_t response_time, int code, std::string_view content_type);
+	void LogGeneratedItem(int id, int type, std::int64_t value, double x, double y);
+	void LogCollectedItem(std::size_t player_id, int item_id, int type, std::int64_t value, std::size_t total_count);
+	void LogMapTick(std::string_view map_id, std::int64_t duration_us, std::size_t player_count, std::size_t item_count);
+}
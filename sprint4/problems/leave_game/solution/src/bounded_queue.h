@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace util
+{
+	//Bounded multi-producer multi-consumer queue by Dmitry Vyukov. Every cell carries a sequence number
+	//telling whose turn it is, so pushing and popping take one compare-and-swap on a shared counter and
+	//never a lock. Capacity is rounded up to a power of two
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		explicit BoundedQueue(std::size_t capacity)
+			:capacity_(RoundUp(capacity)),
+			cells_(std::make_unique<Cell[]>(capacity_))
+		{
+			for (std::size_t i = 0; i < capacity_; ++i)
+			{
+				cells_[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+		//Returns false if the queue is full, the value is left untouched then
+		bool TryPush(T& value)
+		{
+			std::size_t pos = head_.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell& cell = cells_[pos & (capacity_ - 1)];
+				std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				auto lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+
+				if (lag == 0)
+				{
+					if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						cell.value = std::move(value);
+						cell.sequence.store(pos + 1, std::memory_order_release);
+
+						return true;
+					}
+				}
+				else if (lag < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = head_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		std::optional<T> TryPop()
+		{
+			std::size_t pos = tail_.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell& cell = cells_[pos & (capacity_ - 1)];
+				std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				auto lag = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+
+				if (lag == 0)
+				{
+					if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						std::optional<T> result{ std::move(cell.value) };
+						cell.sequence.store(pos + capacity_, std::memory_order_release);
+
+						return result;
+					}
+				}
+				else if (lag < 0)
+				{
+					return std::nullopt;
+				}
+				else
+				{
+					pos = tail_.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		std::size_t Capacity() const
+		{
+			return capacity_;
+		}
+
+		//Only a hint while other threads push and pop
+		std::size_t SizeApprox() const
+		{
+			std::size_t head = head_.load(std::memory_order_relaxed);
+			std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+			return head > tail ? head - tail : 0;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		static std::size_t RoundUp(std::size_t capacity)
+		{
+			std::size_t result = 2;
+
+			while (result < capacity)
+			{
+				result <<= 1;
+			}
+
+			return result;
+		}
+
+		std::size_t capacity_;
+		std::unique_ptr<Cell[]> cells_;
+
+		alignas(64) std::atomic<std::size_t> head_{ 0 };
+		alignas(64) std::atomic<std::size_t> tail_{ 0 };
+	};
+}
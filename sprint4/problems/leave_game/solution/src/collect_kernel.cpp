@@ -0,0 +1,212 @@
+#include "collision_detector.h"
+
+#include <cassert>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COLLECT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace collision_detector
+{
+	namespace
+	{
+		//Everything a lane needs from the gatherer, worked out once per call
+		struct Segment
+		{
+			double a_x, a_y;
+			double v_x, v_y;
+			double v_len2;
+			double width;
+
+			explicit Segment(const Gatherer& gatherer)
+				:a_x(gatherer.start_pos.x),
+				a_y(gatherer.start_pos.y),
+				v_x(gatherer.end_pos.x - gatherer.start_pos.x),
+				v_y(gatherer.end_pos.y - gatherer.start_pos.y),
+				v_len2(v_x * v_x + v_y * v_y),
+				width(gatherer.width)
+			{}
+		};
+
+		//The arithmetic of TryCollectPoint step by step, so every kernel lands on the same bits
+		void CollectScalar(const Segment& seg, const ItemColumns& items, size_t from, std::vector<CollectionHit>& hits)
+		{
+			for (size_t i = from; i < items.x.size(); ++i)
+			{
+				const double u_x = items.x[i] - seg.a_x;
+				const double u_y = items.y[i] - seg.a_y;
+				const double u_dot_v = u_x * seg.v_x + u_y * seg.v_y;
+				const double u_len2 = u_x * u_x + u_y * u_y;
+				const double proj_ratio = u_dot_v / seg.v_len2;
+				const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / seg.v_len2;
+				const double radius = seg.width + items.width[i];
+
+				if (proj_ratio >= 0 && proj_ratio <= 1 && sq_distance <= radius * radius)
+				{
+					hits.push_back({ i, sq_distance, proj_ratio });
+				}
+			}
+		}
+
+#ifdef COLLECT_KERNEL_X86
+
+		//Lanes are written out and the set bits of the mask picked from them, hits are rare
+		void PushLanes(unsigned mask, size_t base, const double* sq_distance, const double* proj_ratio, std::vector<CollectionHit>& hits)
+		{
+			while (mask != 0)
+			{
+				const unsigned lane = static_cast<unsigned>(__builtin_ctz(mask));
+
+				hits.push_back({ base + lane, sq_distance[lane], proj_ratio[lane] });
+				mask &= mask - 1;
+			}
+		}
+
+		__attribute__((target("sse2")))
+		void CollectSSE2(const Segment& seg, const ItemColumns& items, std::vector<CollectionHit>& hits)
+		{
+			const size_t count = items.x.size();
+
+			const __m128d a_x = _mm_set1_pd(seg.a_x);
+			const __m128d a_y = _mm_set1_pd(seg.a_y);
+			const __m128d v_x = _mm_set1_pd(seg.v_x);
+			const __m128d v_y = _mm_set1_pd(seg.v_y);
+			const __m128d v_len2 = _mm_set1_pd(seg.v_len2);
+			const __m128d width = _mm_set1_pd(seg.width);
+			const __m128d zero = _mm_setzero_pd();
+			const __m128d one = _mm_set1_pd(1);
+
+			alignas(16) double sq_lanes[2];
+			alignas(16) double proj_lanes[2];
+
+			size_t i = 0;
+
+			for (; i + 2 <= count; i += 2)
+			{
+				const __m128d u_x = _mm_sub_pd(_mm_loadu_pd(&items.x[i]), a_x);
+				const __m128d u_y = _mm_sub_pd(_mm_loadu_pd(&items.y[i]), a_y);
+				const __m128d u_dot_v = _mm_add_pd(_mm_mul_pd(u_x, v_x), _mm_mul_pd(u_y, v_y));
+				const __m128d u_len2 = _mm_add_pd(_mm_mul_pd(u_x, u_x), _mm_mul_pd(u_y, u_y));
+				const __m128d proj_ratio = _mm_div_pd(u_dot_v, v_len2);
+				const __m128d sq_distance = _mm_sub_pd(u_len2, _mm_div_pd(_mm_mul_pd(u_dot_v, u_dot_v), v_len2));
+				const __m128d radius = _mm_add_pd(width, _mm_loadu_pd(&items.width[i]));
+
+				const __m128d collected = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(proj_ratio, zero), _mm_cmple_pd(proj_ratio, one)),
+					_mm_cmple_pd(sq_distance, _mm_mul_pd(radius, radius)));
+
+				if (const unsigned mask = static_cast<unsigned>(_mm_movemask_pd(collected)); mask != 0)
+				{
+					_mm_store_pd(sq_lanes, sq_distance);
+					_mm_store_pd(proj_lanes, proj_ratio);
+
+					PushLanes(mask, i, sq_lanes, proj_lanes, hits);
+				}
+			}
+
+			CollectScalar(seg, items, i, hits);
+		}
+
+		//Plain AVX2 with no FMA, a fused multiply-add would round differently from the scalar code
+		__attribute__((target("avx2")))
+		void CollectAVX2(const Segment& seg, const ItemColumns& items, std::vector<CollectionHit>& hits)
+		{
+			const size_t count = items.x.size();
+
+			const __m256d a_x = _mm256_set1_pd(seg.a_x);
+			const __m256d a_y = _mm256_set1_pd(seg.a_y);
+			const __m256d v_x = _mm256_set1_pd(seg.v_x);
+			const __m256d v_y = _mm256_set1_pd(seg.v_y);
+			const __m256d v_len2 = _mm256_set1_pd(seg.v_len2);
+			const __m256d width = _mm256_set1_pd(seg.width);
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d one = _mm256_set1_pd(1);
+
+			alignas(32) double sq_lanes[4];
+			alignas(32) double proj_lanes[4];
+
+			size_t i = 0;
+
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(&items.x[i]), a_x);
+				const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(&items.y[i]), a_y);
+				const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, v_x), _mm256_mul_pd(u_y, v_y));
+				const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+				const __m256d proj_ratio = _mm256_div_pd(u_dot_v, v_len2);
+				const __m256d sq_distance = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+				const __m256d radius = _mm256_add_pd(width, _mm256_loadu_pd(&items.width[i]));
+
+				//Ordered compares: a NaN lane is never collected, like in the scalar code
+				const __m256d collected = _mm256_and_pd(
+					_mm256_and_pd(_mm256_cmp_pd(proj_ratio, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj_ratio, one, _CMP_LE_OQ)),
+					_mm256_cmp_pd(sq_distance, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+
+				if (const unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(collected)); mask != 0)
+				{
+					_mm256_store_pd(sq_lanes, sq_distance);
+					_mm256_store_pd(proj_lanes, proj_ratio);
+
+					PushLanes(mask, i, sq_lanes, proj_lanes, hits);
+				}
+			}
+
+			CollectScalar(seg, items, i, hits);
+		}
+
+#endif
+	}
+
+	CollectKernel BestCollectKernel()
+	{
+		static const CollectKernel best = []
+		{
+#ifdef COLLECT_KERNEL_X86
+			__builtin_cpu_init();
+
+			if (__builtin_cpu_supports("avx2"))
+			{
+				return CollectKernel::AVX2;
+			}
+
+			if (__builtin_cpu_supports("sse2"))
+			{
+				return CollectKernel::SSE2;
+			}
+#endif
+			return CollectKernel::SCALAR;
+		}();
+
+		return best;
+	}
+
+	void TryCollectPoints(const Gatherer& gatherer, const ItemColumns& items, std::vector<CollectionHit>& hits)
+	{
+		TryCollectPoints(BestCollectKernel(), gatherer, items, hits);
+	}
+
+	void TryCollectPoints(CollectKernel kernel, const Gatherer& gatherer, const ItemColumns& items, std::vector<CollectionHit>& hits)
+	{
+		assert(gatherer.start_pos.x != gatherer.end_pos.x || gatherer.start_pos.y != gatherer.end_pos.y);
+		assert(items.y.size() == items.x.size() && items.width.size() == items.x.size());
+
+		const Segment seg{ gatherer };
+
+		switch (kernel)
+		{
+#ifdef COLLECT_KERNEL_X86
+		case CollectKernel::AVX2:
+			CollectAVX2(seg, items, hits);
+			return;
+
+		case CollectKernel::SSE2:
+			CollectSSE2(seg, items, hits);
+			return;
+#endif
+		default:
+			CollectScalar(seg, items, 0, hits);
+			return;
+		}
+	}
+
+}  // namespace collision_detector
@@ -36,6 +36,21 @@ namespace collision_detector
             return p1.x == p2.x && p1.y == p2.y;
         };
 
+        //Items go into columns once, then every gatherer runs over them in one batch
+        std::vector<double> xs, ys, widths;
+
+        for (size_t i = 0; i < provider.ItemsCount(); ++i)
+        {
+            Item item = provider.GetItem(i);
+
+            xs.push_back(item.position.x);
+            ys.push_back(item.position.y);
+            widths.push_back(item.width);
+        }
+
+        const ItemColumns columns{ xs, ys, widths };
+        std::vector<CollectionHit> hits;
+
         for (size_t g = 0; g < provider.GatherersCount(); ++g) 
         {
             Gatherer gatherer = provider.GetGatherer(g);
@@ -45,20 +60,18 @@ namespace collision_detector
                 continue;
             }
 
-            for (size_t i = 0; i < provider.ItemsCount(); ++i) 
+            hits.clear();
+            TryCollectPoints(gatherer, columns, hits);
+
+            for (const CollectionHit& hit : hits)
             {
-                Item item = provider.GetItem(i);
-                auto collect_result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
-
-                if (collect_result.IsCollected(gatherer.width + item.width)) 
-                {
-                    GatheringEvent evt{ .item_id = i, .gatherer_id = g, .sq_distance = collect_result.sq_distance, .time = collect_result.proj_ratio };
-                    detected_events.push_back(evt);
-                }
+                GatheringEvent evt{ .item_id = hit.item_id, .gatherer_id = g, .sq_distance = hit.sq_distance, .time = hit.proj_ratio };
+                detected_events.push_back(evt);
             }
         }
 
-        std::sort(detected_events.begin(), detected_events.end(), [](const GatheringEvent& e_l, const GatheringEvent& e_r) 
+        //Stable, so events at the same time keep the gatherer and item order
+        std::stable_sort(detected_events.begin(), detected_events.end(), [](const GatheringEvent& e_l, const GatheringEvent& e_r) 
         {
             return e_l.time < e_r.time;
         });
@@ -66,5 +79,214 @@ namespace collision_detector
         return detected_events;
     }
 
+	namespace
+	{
+		//Scratch space reused by every gatherer of one FindGatherEvents call
+		struct NarrowphaseBuffers
+		{
+			std::vector<size_t> candidates;
+			std::vector<double> xs, ys, widths;
+			std::vector<CollectionHit> hits;
+		};
+
+		void CollectIndexed(const ItemIndex& targets, const Gatherer& gatherer, size_t gatherer_id, bool is_office,
+			NarrowphaseBuffers& buffers, std::vector<GatheringEvent>& detected_events)
+		{
+			buffers.candidates.clear();
+			targets.CollectCandidates(gatherer.start_pos, gatherer.end_pos, gatherer.width, buffers.candidates);
+
+			if (buffers.candidates.empty())
+			{
+				return;
+			}
+
+			//In id order, like the full scan
+			std::sort(buffers.candidates.begin(), buffers.candidates.end());
+
+			buffers.xs.clear();
+			buffers.ys.clear();
+			buffers.widths.clear();
+
+			for (size_t i : buffers.candidates)
+			{
+				const Item& item = targets.GetItem(i);
+
+				buffers.xs.push_back(item.position.x);
+				buffers.ys.push_back(item.position.y);
+				buffers.widths.push_back(item.width);
+			}
+
+			buffers.hits.clear();
+			TryCollectPoints(gatherer, { buffers.xs, buffers.ys, buffers.widths }, buffers.hits);
+
+			for (const CollectionHit& hit : buffers.hits)
+			{
+				detected_events.push_back({ .item_id = buffers.candidates[hit.item_id], .gatherer_id = gatherer_id,
+					.sq_distance = hit.sq_distance, .time = hit.proj_ratio, .is_office = is_office });
+			}
+		}
+
+		std::vector<GatheringEvent> FindIndexedEvents(const ItemIndex& items, const ItemIndex* offices, const std::vector<Gatherer>& gatherers)
+		{
+			std::vector<GatheringEvent> detected_events;
+			NarrowphaseBuffers buffers;
+
+			for (size_t g = 0; g < gatherers.size(); ++g)
+			{
+				const Gatherer& gatherer = gatherers[g];
+
+				if (gatherer.start_pos.x == gatherer.end_pos.x && gatherer.start_pos.y == gatherer.end_pos.y)
+				{
+					continue;
+				}
+
+				CollectIndexed(items, gatherer, g, false, buffers, detected_events);
+
+				if (offices != nullptr)
+				{
+					CollectIndexed(*offices, gatherer, g, true, buffers, detected_events);
+				}
+			}
+
+			std::stable_sort(detected_events.begin(), detected_events.end(), [](const GatheringEvent& e_l, const GatheringEvent& e_r)
+				{
+					return e_l.time < e_r.time || (e_l.time == e_r.time && !e_l.is_office && e_r.is_office);
+				});
+
+			return detected_events;
+		}
+	}
+
+	std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, const std::vector<Gatherer>& gatherers)
+	{
+		return FindIndexedEvents(items, nullptr, gatherers);
+	}
+
+	std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, const ItemIndex& offices, const std::vector<Gatherer>& gatherers)
+	{
+		return FindIndexedEvents(items, &offices, gatherers);
+	}
+
+	void ItemIndex::Add(Item item)
+	{
+		cells_[KeyOf(item)].push_back(items_.size());
+		items_.push_back(item);
+
+		max_width_ = std::max(max_width_, item.width);
+	}
+
+	void ItemIndex::Remove(size_t id)
+	{
+		auto cell = cells_.find(KeyOf(items_[id]));
+		std::vector<size_t>& ids = cell->second;
+
+		ids.erase(std::find(ids.begin(), ids.end(), id));
+
+		if (ids.empty())
+		{
+			cells_.erase(cell);
+		}
+
+		const size_t last = items_.size() - 1;
+
+		if (id != last)
+		{
+			std::vector<size_t>& last_ids = cells_.find(KeyOf(items_[last]))->second;
+
+			*std::find(last_ids.begin(), last_ids.end(), last) = id;
+			items_[id] = items_[last];
+		}
+
+		items_.pop_back();
+	}
+
+	void ItemIndex::CollectCandidates(geom::Point2D a, geom::Point2D b, double radius, std::vector<size_t>& ids) const
+	{
+		//A hair wider, so rounding in the slope never drops a cell an item at exactly the radius sits in
+		radius += max_width_ + 1e-9;
+
+		if (b.x < a.x)
+		{
+			std::swap(a, b);
+		}
+
+		const std::int64_t min_x = ToCell(a.x - radius);
+		const std::int64_t max_x = ToCell(b.x + radius);
+		const std::int64_t min_y = ToCell(std::min(a.y, b.y) - radius);
+		const std::int64_t max_y = ToCell(std::max(a.y, b.y) + radius);
+
+		const double columns = static_cast<double>(max_x - min_x + 1);
+		const double rows = static_cast<double>(max_y - min_y + 1);
+
+		//Walking the path looks at about this many cells
+		const double path_cells = 2 * (columns + rows);
+
+		//Short or straight paths: the box around them is barely bigger than the path
+		if (columns * rows <= path_cells)
+		{
+			for (std::int64_t x = min_x; x <= max_x; ++x)
+			{
+				for (std::int64_t y = min_y; y <= max_y; ++y)
+				{
+					CollectCell(x, y, ids);
+				}
+			}
+
+			return;
+		}
+
+		//Sparse items: going over all of them is cheaper than walking the path
+		if (path_cells >= static_cast<double>(cells_.size()))
+		{
+			for (const auto& [key, cell_ids] : cells_)
+			{
+				ids.insert(ids.end(), cell_ids.begin(), cell_ids.end());
+			}
+
+			return;
+		}
+
+		//Long paths: column by column, only the rows the path passes in each one
+		const double slope = b.x != a.x ? (b.y - a.y) / (b.x - a.x) : 0;
+
+		for (std::int64_t x = min_x; x <= max_x; ++x)
+		{
+			const double from = std::max(a.x, x * cell_size_ - radius);
+			const double to = std::min(b.x, (x + 1) * cell_size_ + radius);
+
+			double low = std::min(a.y, b.y);
+			double high = std::max(a.y, b.y);
+
+			if (b.x != a.x)
+			{
+				const double y_from = a.y + (from - a.x) * slope;
+				const double y_to = a.y + (to - a.x) * slope;
+
+				low = std::min(y_from, y_to);
+				high = std::max(y_from, y_to);
+			}
+
+			for (std::int64_t y = ToCell(low - radius); y <= ToCell(high + radius); ++y)
+			{
+				CollectCell(x, y, ids);
+			}
+		}
+	}
+
+	void ItemIndex::CollectCell(std::int64_t x, std::int64_t y, std::vector<size_t>& ids) const
+	{
+		if (auto cell = cells_.find(Key(x, y)); cell != cells_.end())
+		{
+			ids.insert(ids.end(), cell->second.begin(), cell->second.end());
+		}
+	}
+
+	void ItemIndex::Clear()
+	{
+		items_.clear();
+		cells_.clear();
+		max_width_ = 0;
+	}
+
 
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 namespace geom
@@ -45,6 +49,73 @@ namespace collision_detector
 		double width;
 	};
 
+	//Broadphase for FindGatherEvents. Items are bucketed by a uniform grid of which only the occupied
+	//cells are stored, so a gatherer only meets the items in the cells around its path.
+	//Item ids are positions in the list the index mirrors and follow its erases
+	class ItemIndex
+	{
+	public:
+		explicit ItemIndex(double cell_size = 4)
+			:cell_size_(cell_size) {}
+
+		//The item gets the next id
+		void Add(Item item);
+
+		//The last item takes over the id of the removed one, the way util::SlotMap fills its holes
+		void Remove(size_t id);
+
+		void Clear();
+
+		size_t Size() const
+		{
+			return items_.size();
+		}
+
+		const Item& GetItem(size_t id) const
+		{
+			return items_[id];
+		}
+
+		//Appends the ids of the items that may be within radius plus their own width of the segment from a to b.
+		//Each one comes up once, in no particular order
+		void CollectCandidates(geom::Point2D a, geom::Point2D b, double radius, std::vector<size_t>& ids) const;
+
+	private:
+		using CellKey = std::uint64_t;
+
+		struct CellKeyHasher
+		{
+			size_t operator()(CellKey key) const
+			{
+				//Neighbouring cells differ in the low bits of either half, spread them over the buckets
+				return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 16);
+			}
+		};
+
+		std::int64_t ToCell(double coord) const
+		{
+			return static_cast<std::int64_t>(std::floor(coord / cell_size_));
+		}
+
+		static CellKey Key(std::int64_t x, std::int64_t y)
+		{
+			return (static_cast<CellKey>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+		}
+
+		CellKey KeyOf(const Item& item) const
+		{
+			return Key(ToCell(item.position.x), ToCell(item.position.y));
+		}
+
+		void CollectCell(std::int64_t x, std::int64_t y, std::vector<size_t>& ids) const;
+
+		double cell_size_;
+		double max_width_ = 0;
+
+		std::vector<Item> items_;
+		std::unordered_map<CellKey, std::vector<size_t>, CellKeyHasher> cells_;
+	};
+
 	class ItemGathererProvider 
 	{
 	protected:
@@ -57,18 +128,61 @@ namespace collision_detector
 		virtual Gatherer GetGatherer(size_t idx) const = 0;
 	};
 
+	//Batched narrowphase. Items come as columns of the same length, so a whole run of them is
+	//checked against one gatherer with SIMD lanes instead of one TryCollectPoint call each
+	struct ItemColumns
+	{
+		std::span<const double> x;
+		std::span<const double> y;
+		std::span<const double> width;
+	};
+
+	struct CollectionHit
+	{
+		//Index in the columns
+		size_t item_id;
+		double sq_distance;
+		double proj_ratio;
+	};
+
+	enum class CollectKernel
+	{
+		SCALAR,
+		SSE2,
+		AVX2
+	};
+
+	//The widest kernel this CPU runs, picked once on first use
+	CollectKernel BestCollectKernel();
+
+	//Appends the items the gatherer collects, in column order, with the same numbers TryCollectPoint gives.
+	//The gatherer has to move
+	void TryCollectPoints(const Gatherer& gatherer, const ItemColumns& items, std::vector<CollectionHit>& hits);
+
+	//Same with the kernel chosen by the caller, for tests and benchmarks. It has to run on this CPU
+	void TryCollectPoints(CollectKernel kernel, const Gatherer& gatherer, const ItemColumns& items, std::vector<CollectionHit>& hits);
+
 	struct GatheringEvent 
 	{
+		//Index of the office instead when is_office is set
 		size_t item_id;
 		size_t gatherer_id;
 		double sq_distance;
 		double time;
+		bool is_office = false;
 	};
 
 	// Эту функцию вам нужно будет реализовать в соответствующем задании.
 	// При проверке ваших тестов она не нужна - функция будет линковаться снаружи.
 	std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
 
+	//Same events in the same order, checking each gatherer against the items near its path only
+	std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, const std::vector<Gatherer>& gatherers);
+
+	//Item and office events of every gatherer in one pass, offices being static targets swept like items.
+	//Ordered by time, at the same time items come before offices
+	std::vector<GatheringEvent> FindGatherEvents(const ItemIndex& items, const ItemIndex& offices, const std::vector<Gatherer>& gatherers);
+
 	class VectorItemGathererProvider : public collision_detector::ItemGathererProvider
 	{
 	public:
@@ -0,0 +1,45 @@
+#include "content_type.h"
+
+#include <map>
+
+namespace http_handler
+{
+	//Dictionary with different extensions
+	std::map<std::string_view, std::string_view> EXTENSION_TO_VALUE =
+	{
+		{".json"sv, ContentType::APPLICATION_JSON},
+		{".xml"sv, ContentType::APPLICATION_XML},
+
+		{".js"sv, ContentType::TEXT_JS},
+		{".css"sv, ContentType::TEXT_CSS},
+		{".txt"sv, ContentType::TEXT_TXT},
+		{".htm"sv, ContentType::TEXT_HTML},
+		{".html"sv, ContentType::TEXT_HTML},
+
+		{".png"sv, ContentType::IMAGE_PNG},
+		{".jpg"sv, ContentType::IMAGE_JPG},
+		{".jpe"sv, ContentType::IMAGE_JPG},
+		{".jpeg"sv, ContentType::IMAGE_JPG},
+		{".gif"sv, ContentType::IMAGE_GIF},
+		{".bmp"sv, ContentType::IMAGE_BMP},
+		{".ico"sv, ContentType::IMAGE_ICO},
+		{".tif"sv, ContentType::IMAGE_TIF},
+		{".tiff"sv, ContentType::IMAGE_TIF},
+		{".svg"sv, ContentType::IMAGE_SVG},
+		{".svgz"sv, ContentType::IMAGE_SVG},
+
+		{".mp3"sv, ContentType::AUDIO_MP3},
+	};
+
+	std::string_view GetContentType(std::string_view extension)
+	{
+		auto iter = EXTENSION_TO_VALUE.find(extension);
+
+		if (iter != EXTENSION_TO_VALUE.end())
+		{
+			return iter->second;
+		}
+
+		return ContentType::APPLICATION_BLANK;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string_view>
+
+namespace http_handler
+{
+	using namespace std::literals;
+
+	struct ContentType
+	{
+		ContentType() = delete;
+		constexpr static std::string_view APPLICATION_JSON = "application/json"sv;
+		constexpr static std::string_view APPLICATION_XML = "application/xml"sv;
+		constexpr static std::string_view APPLICATION_BLANK = "application/octet-stream"sv;
+		constexpr static std::string_view TEXT_JS = "text/javascript"sv;
+		constexpr static std::string_view TEXT_CSS = "text/css"sv;
+		constexpr static std::string_view TEXT_TXT = "text/plain"sv;
+		constexpr static std::string_view TEXT_HTML = "text/html"sv;
+		constexpr static std::string_view IMAGE_PNG = "image/png"sv;
+		constexpr static std::string_view IMAGE_JPG = "image/jpeg"sv;
+		constexpr static std::string_view IMAGE_GIF = "image/gif"sv;
+		constexpr static std::string_view IMAGE_BMP = "image/bmp"sv;
+		constexpr static std::string_view IMAGE_ICO = "image/vnd.microsoft.icon"sv;
+		constexpr static std::string_view IMAGE_TIF = "image/tiff"sv;
+		constexpr static std::string_view IMAGE_SVG = "image/svg+xml"sv;
+		constexpr static std::string_view AUDIO_MP3 = "audio/mpeg"sv;
+	};
+
+	// Returns content type by raw extension string_view
+	std::string_view GetContentType(std::string_view extension);
+}
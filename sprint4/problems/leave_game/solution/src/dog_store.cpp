@@ -0,0 +1,144 @@
+#include "dog_store.h"
+
+#include <utility>
+
+namespace model
+{
+	namespace
+	{
+		//No branches and no calls here, so this loop runs in SIMD lanes. The columns never overlap,
+		//which the compiler can't prove on its own. Only the axis the dog moves along is checked,
+		//same as Dog::Move does
+		void MoveInsideBounds(std::size_t count, double seconds, double* __restrict x, double* __restrict y,
+			const double* __restrict vel_x, const double* __restrict vel_y,
+			const double* __restrict min_x, const double* __restrict max_x,
+			const double* __restrict min_y, const double* __restrict max_y, double* __restrict stays)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				const double step_x = seconds * vel_x[i];
+				const double step_y = seconds * vel_y[i];
+
+				const double next_x = x[i] + step_x;
+				const double next_y = y[i] + step_y;
+
+				const bool still_x = vel_x[i] == 0;
+				const bool still_y = vel_y[i] == 0;
+
+				const bool x_fits = still_x | ((next_x >= min_x[i]) & (next_x <= max_x[i]));
+				const bool y_fits = still_y | ((next_y >= min_y[i]) & (next_y <= max_y[i]));
+
+				//Diagonal movement is not allowed, such dogs are left to the scalar path as well
+				const bool fits = x_fits & y_fits & (still_x | still_y);
+
+				//Adding a zero step keeps the dog in place. A select would be clearer, but GCC only
+				//vectorizes the blend when it is written as arithmetic
+				const double keep = fits ? 1.0 : 0.0;
+
+				x[i] += keep * step_x;
+				y[i] += keep * step_y;
+				stays[i] = keep;
+			}
+		}
+	}
+
+	DogStore::Slot DogStore::Add(double x, double y, double speed, char dir, std::uint32_t road, RoadBounds bounds)
+	{
+		if (!free_.empty())
+		{
+			Slot slot = free_.back();
+			free_.pop_back();
+
+			x_[slot] = x;
+			y_[slot] = y;
+			vel_x_[slot] = 0;
+			vel_y_[slot] = 0;
+
+			speed_[slot] = speed;
+			dir_[slot] = dir;
+			since_[slot] = clock_;
+			SetRoad(slot, road, bounds);
+
+			return slot;
+		}
+
+		x_.push_back(x);
+		y_.push_back(y);
+		vel_x_.push_back(0);
+		vel_y_.push_back(0);
+
+		min_x_.push_back(bounds.min_x);
+		max_x_.push_back(bounds.max_x);
+		min_y_.push_back(bounds.min_y);
+		max_y_.push_back(bounds.max_y);
+
+		speed_.push_back(speed);
+		dir_.push_back(dir);
+		road_.push_back(road);
+		since_.push_back(clock_);
+
+		return x_.size() - 1;
+	}
+
+	void DogStore::Remove(Slot slot)
+	{
+		SetPos(slot, GetX(slot), GetY(slot));
+
+		vel_x_[slot] = 0;
+		vel_y_[slot] = 0;
+
+		free_.push_back(slot);
+	}
+
+	void DogStore::SetVel(Slot slot, double vel_x, double vel_y)
+	{
+		const bool was_moving = vel_x_[slot] != 0 || vel_y_[slot] != 0;
+
+		//The walk so far is settled with the old velocity
+		SetPos(slot, GetX(slot), GetY(slot));
+
+		vel_x_[slot] = vel_x;
+		vel_y_[slot] = vel_y;
+
+		if (track_changes_)
+		{
+			changes_.push_back({ slot, was_moving });
+		}
+	}
+
+	std::vector<DogStore::VelocityChange> DogStore::TakeVelocityChanges()
+	{
+		return std::exchange(changes_, {});
+	}
+
+	void DogStore::SetRoad(Slot slot, std::uint32_t road, RoadBounds bounds)
+	{
+		road_[slot] = road;
+
+		min_x_[slot] = bounds.min_x;
+		max_x_[slot] = bounds.max_x;
+		min_y_[slot] = bounds.min_y;
+		max_y_[slot] = bounds.max_y;
+	}
+
+	const std::vector<DogStore::Slot>& DogStore::AdvanceStraight(double seconds)
+	{
+		const std::size_t count = x_.size();
+
+		stays_.resize(count);
+		leaving_.clear();
+
+		MoveInsideBounds(count, seconds, x_.data(), y_.data(), vel_x_.data(), vel_y_.data(),
+			min_x_.data(), max_x_.data(), min_y_.data(), max_y_.data(), stays_.data());
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (stays_[i] == 0)
+			{
+				leaving_.push_back(i);
+			}
+		}
+
+		return leaving_;
+	}
+}
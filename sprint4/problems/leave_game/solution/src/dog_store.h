@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace model
+{
+	//Area a dog may walk without leaving its road: the road itself plus the margin on every side
+	struct RoadBounds
+	{
+		double min_x, max_x;
+		double min_y, max_y;
+	};
+
+	//Dogs of one map, stored column by column. A tick streams through a few plain arrays instead of
+	//jumping from player to dog, which lets the compiler move several dogs per instruction.
+	//Belongs to the map's strand like the rest of the map state
+	class DogStore
+	{
+	public:
+		using Slot = std::size_t;
+
+		struct VelocityChange
+		{
+			Slot slot;
+			bool was_moving;
+		};
+
+		//Takes a slot freed by Remove if there is one
+		Slot Add(double x, double y, double speed, char dir, std::uint32_t road, RoadBounds bounds);
+
+		//The dog stops for good and its slot waits for the next Add. Columns never shrink, a freed
+		//slot just stands still in them, so the batched kernel keeps running over plain arrays
+		void Remove(Slot slot);
+
+		//Slots taken and free alike
+		std::size_t Size() const
+		{
+			return x_.size();
+		}
+
+		std::size_t GetFreeCount() const
+		{
+			return free_.size();
+		}
+
+		//A position is stored as of the clock reading it was set at, the dog has been walking since.
+		//Ticked maps never wind the clock, so there it is always the stored one
+		double GetX(Slot slot) const
+		{
+			return x_[slot] + vel_x_[slot] * (clock_ - since_[slot]);
+		}
+
+		double GetY(Slot slot) const
+		{
+			return y_[slot] + vel_y_[slot] * (clock_ - since_[slot]);
+		}
+
+		double GetVelX(Slot slot) const
+		{
+			return vel_x_[slot];
+		}
+
+		double GetVelY(Slot slot) const
+		{
+			return vel_y_[slot];
+		}
+
+		double GetSpeed(Slot slot) const
+		{
+			return speed_[slot];
+		}
+
+		char GetDir(Slot slot) const
+		{
+			return dir_[slot];
+		}
+
+		std::uint32_t GetRoad(Slot slot) const
+		{
+			return road_[slot];
+		}
+
+		void SetPos(Slot slot, double x, double y)
+		{
+			x_[slot] = x;
+			y_[slot] = y;
+			since_[slot] = clock_;
+		}
+
+		void SetVel(Slot slot, double vel_x, double vel_y);
+
+		void SetDir(Slot slot, char dir)
+		{
+			dir_[slot] = dir;
+		}
+
+		void SetRoad(Slot slot, std::uint32_t road, RoadBounds bounds);
+
+		//Seconds of game time, only kinetic maps (see KineticEngine) move it
+		void SetClock(double seconds)
+		{
+			clock_ = seconds;
+		}
+
+		//While on, SetVel remembers which dogs were steered since the last TakeVelocityChanges
+		void TrackVelocityChanges(bool track)
+		{
+			track_changes_ = track;
+		}
+
+		std::vector<VelocityChange> TakeVelocityChanges();
+
+		//Moves every dog whose step ends on its current road and returns the rest: dogs that reach
+		//the end of the road and may turn onto another one. They are left where they were.
+		//Works on the stored positions, so it is only for maps whose clock stays put
+		const std::vector<Slot>& AdvanceStraight(double seconds);
+
+	private:
+		std::vector<double> x_;
+		std::vector<double> y_;
+		std::vector<double> vel_x_;
+		std::vector<double> vel_y_;
+
+		std::vector<double> min_x_;
+		std::vector<double> max_x_;
+		std::vector<double> min_y_;
+		std::vector<double> max_y_;
+
+		std::vector<double> speed_;
+		std::vector<char> dir_;
+		std::vector<std::uint32_t> road_;
+
+		double clock_ = 0;
+		std::vector<double> since_;
+
+		std::vector<Slot> free_;
+
+		bool track_changes_ = false;
+		std::vector<VelocityChange> changes_;
+
+		//Scratch space of AdvanceStraight, kept to avoid allocating every tick
+		std::vector<double> stays_;
+		std::vector<Slot> leaving_;
+	};
+}
@@ -2,6 +2,26 @@
 
 namespace Data
 {
+	LootTable CompileLootTable(const boost::json::array& table)
+	{
+		LootTable compiled;
+		std::vector<double> weights;
+
+		for (const boost::json::value& type : table)
+		{
+			const boost::json::object& loot_type = type.as_object();
+
+			compiled.values.push_back(loot_type.at("value").as_int64());
+
+			const boost::json::value* weight = loot_type.if_contains("weight");
+			weights.push_back(weight != nullptr ? weight->to_number<double>() : 1.0);
+		}
+
+		compiled.types = util::AliasTable{ weights };
+
+		return compiled;
+	}
+
 	MapExtras::MapExtras(boost::json::object config)
 		:loot_config_(std::move(config)), 
 		generator_(std::chrono::milliseconds{ static_cast<int>(loot_config_.at("period").as_double() * 1000) }, loot_config_.at("probability").as_double())
@@ -10,17 +30,34 @@ namespace Data
 	void MapExtras::AddTable(const std::string& map_id, boost::json::array& table)
 	{
 		loot_table_by_id_[map_id] = table;
+		compiled_table_by_id_[map_id] = CompileLootTable(table);
 	}
 
-	boost::json::array MapExtras::GetTable(const std::string& map_id) const
+	const boost::json::array& MapExtras::GetTable(const std::string& map_id) const
 	{
-		if (loot_table_by_id_.contains(map_id))
+		static const boost::json::array empty_table;
+
+		if (auto iter = loot_table_by_id_.find(map_id); iter != loot_table_by_id_.end())
+		{
+			return iter->second;
+		}
+		else
+		{
+			return empty_table;
+		}
+	}
+
+	const LootTable& MapExtras::GetCompiledTable(const std::string& map_id) const
+	{
+		static const LootTable empty_table;
+
+		if (auto iter = compiled_table_by_id_.find(map_id); iter != compiled_table_by_id_.end())
 		{
-			return loot_table_by_id_.at(map_id);
+			return iter->second;
 		}
 		else
 		{
-			return {};
+			return empty_table;
 		}
 	}
 
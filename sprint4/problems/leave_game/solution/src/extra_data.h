@@ -2,11 +2,25 @@
 
 #include <boost/json.hpp>
 #include "loot_generator.h"
+#include "random.h"
+
+#include <cstdint>
+#include <vector>
 
 namespace json = boost::json;
 
 namespace Data
 {
+	//Loot types of a map ready for spawning: the value of every type and a sampler over them
+	struct LootTable
+	{
+		std::vector<int64_t> values;
+		util::AliasTable types;
+	};
+
+	//A type may carry an optional "weight", types without one are weighted 1
+	LootTable CompileLootTable(const boost::json::array& table);
+
 	class MapExtras
 	{
 		public:
@@ -17,7 +31,11 @@ namespace Data
 
 			void AddTable(const std::string& map_id, boost::json::array& table);
 
-			boost::json::array GetTable(const std::string& map_id) const;
+			//Returns an empty table if the map has none
+			const boost::json::array& GetTable(const std::string& map_id) const;
+
+			//Same table compiled at load time, empty if the map has none
+			const LootTable& GetCompiledTable(const std::string& map_id) const;
 
 			boost::json::object GetConfig() const;
 
@@ -27,6 +45,7 @@ namespace Data
 
 			boost::json::object loot_config_;
 			std::unordered_map<std::string, boost::json::array> loot_table_by_id_;
+			std::unordered_map<std::string, LootTable> compiled_table_by_id_;
 
 			loot_gen::LootGenerator generator_{ std::chrono::milliseconds{5}, 1 };
 	};
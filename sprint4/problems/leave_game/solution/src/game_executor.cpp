@@ -0,0 +1,110 @@
+#include "game_executor.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace model
+{
+	using namespace std::literals;
+
+	namespace
+	{
+		//Shared by the tasks of one ForEachMap pass
+		struct Pass
+		{
+			GameExecutor::MapTask task;
+			GameExecutor::Done done;
+			std::atomic<size_t> remaining;
+		};
+	}
+
+	GameExecutor::GameExecutor(net::io_context& ioc, Game& game)
+		:game_(game),
+		timings_(std::make_unique<TickTiming[]>(game.GetMaps().size()))
+	{
+		strands_.reserve(game_.GetMaps().size());
+
+		for (size_t i = 0; i < game_.GetMaps().size(); ++i)
+		{
+			strands_.push_back(net::make_strand(ioc));
+		}
+	}
+
+	void GameExecutor::RefreshMapState(const Map& map)
+	{
+		//First player on an empty map, there is nothing to keep serving until the rebuild
+		if (!game_.FindMapState(map))
+		{
+			game_.PublishMapState(map);
+			return;
+		}
+
+		if (game_.MarkMapStateChanged(map))
+		{
+			net::post(strands_.at(game_.GetMapIndex(map)), [this, &map]
+				{
+					game_.PublishMapState(map);
+				});
+		}
+	}
+
+	void GameExecutor::ForEachMap(MapTask task, Done done)
+	{
+		Game::Maps& maps = game_.GetMaps();
+
+		if (maps.empty())
+		{
+			if (done)
+			{
+				done();
+			}
+
+			return;
+		}
+
+		auto pass = std::make_shared<Pass>(std::move(task), std::move(done), maps.size());
+
+		for (size_t i = 0; i < maps.size(); ++i)
+		{
+			net::post(strands_[i], [pass, i, &map = maps[i]]
+				{
+					try
+					{
+						pass->task(i, map);
+					}
+					catch (const std::exception& ex)
+					{
+						//One broken map shouldn't stop the others or leave done() uncalled
+						json::object logger_data{ {"code", "mapTaskError"}, {"map", *map.GetId()}, {"exception", ex.what()} };
+						BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "error"sv;
+					}
+
+					if (pass->remaining.fetch_sub(1) == 1 && pass->done)
+					{
+						pass->done();
+					}
+				});
+		}
+	}
+
+	void GameExecutor::Tick(int milliseconds, Done done)
+	{
+		ForEachMap([this, milliseconds](size_t index, Map& map)
+			{
+				auto start = std::chrono::steady_clock::now();
+
+				game_.TickMap(map, milliseconds);
+
+				std::int64_t duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+				//Only this strand writes the timing, so plain stores are enough
+				TickTiming& timing = timings_[index];
+				timing.last_us.store(duration, std::memory_order_relaxed);
+				timing.max_us.store(std::max(timing.max_us.load(std::memory_order_relaxed), duration), std::memory_order_relaxed);
+				timing.total_us.store(timing.total_us.load(std::memory_order_relaxed) + duration, std::memory_order_relaxed);
+				timing.ticks.store(timing.ticks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+				async_log::LogMapTick(*map.GetId(), duration, game_.GetPlayerCount(*map.GetId()), map.GetItemCount());
+			}, std::move(done));
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "model.h"
+
+namespace model
+{
+	namespace net = boost::asio;
+
+	//Every map and the players on it belong to a strand. Whatever reads or changes a map after loading
+	//runs there, so maps never wait for each other and need no global lock. Players is the only thing
+	//they share, and it guards itself
+	class GameExecutor
+	{
+	public:
+		using Strand = net::strand<net::io_context::executor_type>;
+		using MapTask = std::function<void(size_t index, Map& map)>;
+		using Done = std::function<void()>;
+
+		//Written by the map's strand after every tick, can be read from anywhere
+		struct TickTiming
+		{
+			std::atomic<std::int64_t> last_us{ 0 };
+			std::atomic<std::int64_t> max_us{ 0 };
+			std::atomic<std::int64_t> total_us{ 0 };
+			std::atomic<std::uint64_t> ticks{ 0 };
+		};
+
+		GameExecutor(net::io_context& ioc, Game& game);
+
+		GameExecutor(const GameExecutor&) = delete;
+		GameExecutor& operator=(const GameExecutor&) = delete;
+
+		//Runs fn on the strand owning the map, right away if we are already there
+		template <typename Fn>
+		void Run(const Map& map, Fn&& fn)
+		{
+			net::dispatch(strands_.at(game_.GetMapIndex(map)), std::forward<Fn>(fn));
+		}
+
+		//Has to run on the map's strand, after a join or an action changed it. Readers keep getting the
+		//published snapshot, the changes queued on the strand share one rebuild that follows them
+		void RefreshMapState(const Map& map);
+
+		//Calls task on every map's strand. done is called once, by the map that finishes last
+		void ForEachMap(MapTask task, Done done = {});
+
+		//Every map is ticked on its own strand, in parallel with the others. Idle io threads pick up
+		//whichever map is ready, so one slow map only delays itself. done is the tick barrier
+		void Tick(int milliseconds, Done done = {});
+
+		const TickTiming& GetTickTiming(size_t map_index) const
+		{
+			return timings_[map_index];
+		}
+
+	private:
+		Game& game_;
+		std::vector<Strand> strands_;
+		std::unique_ptr<TickTiming[]> timings_;
+	};
+}
@@ -3,6 +3,11 @@
 #include <boost/asio/dispatch.hpp>
 #include <iostream>
 
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <cerrno>
+#endif
+
 namespace http_server
 {
     void ReportError(beast::error_code ec, std::string_view what)
@@ -22,4 +27,141 @@ namespace http_server
         net::dispatch(stream_.get_executor(), beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
+    void SessionBase::Write(SendfileResponse&& response)
+    {
+        auto safe_response = std::make_shared<SendfileResponse>(std::move(response));
+        auto serializer = std::make_shared<http::response_serializer<http::empty_body>>(safe_response->header);
+
+        auto self = GetSharedThis();
+        http::async_write_header(stream_, *serializer,
+            [safe_response, serializer, self](beast::error_code ec, std::size_t bytes_written)
+            {
+                if (ec)
+                {
+                    return self->OnWrite(true, ec, bytes_written);
+                }
+
+                self->SendFileBody(safe_response, bytes_written);
+            });
+    }
+
+#ifdef __linux__
+
+    void SessionBase::SendFileBody(std::shared_ptr<SendfileResponse> response, std::size_t bytes_written)
+    {
+        // Одна порция за вызов: между порциями поток возвращается в io_context, и быстрый
+        // клиент не занимает его на весь файл
+        constexpr std::uint64_t MAX_CHUNK = 1 << 20;
+
+        tcp::socket& socket = stream_.socket();
+        beast::error_code ec;
+        socket.native_non_blocking(true, ec);
+
+        while (!ec && response->length > 0)
+        {
+            off_t offset = static_cast<off_t>(response->offset);
+            ssize_t sent = ::sendfile(socket.native_handle(), response->file.native_handle(), &offset, std::min(response->length, MAX_CHUNK));
+
+            if (sent > 0)
+            {
+                response->offset += sent;
+                response->length -= sent;
+                bytes_written += sent;
+
+                if (response->length == 0)
+                {
+                    break;
+                }
+
+                return WaitWritable(response, bytes_written);
+            }
+
+            if (sent == 0)
+            {
+                // Файл стал короче, чем было обещано в Content-Length
+                ec = net::error::eof;
+                break;
+            }
+
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // Буфер сокета заполнен, продолжим, когда в него снова можно будет писать
+                return WaitWritable(response, bytes_written);
+            }
+
+            ec.assign(errno, sys::system_category());
+        }
+
+        OnWrite(ec || response->header.need_eof(), ec, bytes_written);
+    }
+
+    void SessionBase::WaitWritable(std::shared_ptr<SendfileResponse> response, std::size_t bytes_written)
+    {
+        using namespace std::literals;
+
+        // Таймаут взводится заново перед каждой порцией, как stream_ перед каждой операцией
+        send_timer_.expires_after(30s);
+        send_timer_.async_wait([self = GetSharedThis()](beast::error_code ec)
+            {
+                // Таймер могли взвести заново, пока обработчик стоял в очереди
+                if (!ec && self->send_timer_.expiry() <= net::steady_timer::clock_type::now())
+                {
+                    self->stream_.socket().cancel(ec);
+                }
+            });
+
+        stream_.socket().async_wait(tcp::socket::wait_write,
+            [response, bytes_written, self = GetSharedThis()](beast::error_code ec)
+            {
+                const bool timed_out = self->send_timer_.expiry() <= net::steady_timer::clock_type::now();
+                self->send_timer_.cancel();
+
+                if (ec == net::error::operation_aborted && timed_out)
+                {
+                    ec = beast::error::timeout;
+                }
+
+                if (ec)
+                {
+                    return self->OnWrite(true, ec, bytes_written);
+                }
+
+                self->SendFileBody(response, bytes_written);
+            });
+    }
+
+#else
+
+    void SessionBase::SendFileBody(std::shared_ptr<SendfileResponse> response, std::size_t bytes_written)
+    {
+        // Без sendfile читаем нужный диапазон файла в память и отправляем обычным способом
+        beast::error_code ec;
+        auto buffer = std::make_shared<std::string>(response->length, '\0');
+
+        response->file.seek(response->offset, ec);
+
+        if (!ec && !buffer->empty())
+        {
+            response->file.read(buffer->data(), buffer->size(), ec);
+        }
+
+        if (ec)
+        {
+            return OnWrite(true, ec, bytes_written);
+        }
+
+        net::async_write(stream_, net::buffer(*buffer),
+            [response, buffer, bytes_written, self = GetSharedThis()](beast::error_code ec, std::size_t bytes)
+            {
+                self->OnWrite(ec || response->header.need_eof(), ec, bytes_written + bytes);
+            });
+    }
+
+#endif
+
 }  // namespace http_server
@@ -11,9 +11,11 @@
 #include <boost/json.hpp>
 
 #include "sdk.h"
+#include "async_logger.h"
 // boost.beast будет использовать std::string_view вместо boost::string_view
 #define BOOST_BEAST_USE_STD_STRING_VIEW
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
@@ -25,6 +27,7 @@
 #include <thread>
 #include <vector>
 #include <variant>
+#include <memory>
 
 namespace logging = boost::log;
 namespace keywords = logging::keywords;
@@ -46,6 +49,59 @@ namespace http_server
 
 	void ReportError(beast::error_code ec, std::string_view what);
 
+	// Тело ответа, разделяемое между несколькими ответами без копирования.
+	// Буфер должен оставаться неизменным, пока на него ссылается хотя бы один ответ
+	struct SharedStringBody
+	{
+		using value_type = std::shared_ptr<const std::string>;
+
+		static std::uint64_t size(const value_type& body)
+		{
+			return body ? body->size() : 0;
+		}
+
+		class writer
+		{
+		public:
+			using const_buffers_type = net::const_buffer;
+
+			template <bool isRequest, class Fields>
+			writer(const http::header<isRequest, Fields>&, const value_type& body)
+				: body_(body)
+			{}
+
+			void init(beast::error_code& ec)
+			{
+				ec = {};
+			}
+
+			boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec)
+			{
+				ec = {};
+
+				if (!body_ || body_->empty())
+				{
+					return boost::none;
+				}
+
+				return { { const_buffers_type{ body_->data(), body_->size() }, false } };
+			}
+
+		private:
+			const value_type& body_;
+		};
+	};
+
+	// Ответ с телом из файла, которое отправляется ядром (sendfile) без копирования в user space.
+	// Заголовок пишется как обычно, затем передаются length байт файла, начиная с offset
+	struct SendfileResponse
+	{
+		http::response<http::empty_body> header;
+		beast::file file;
+		std::uint64_t offset = 0;
+		std::uint64_t length = 0;
+	};
+
 	class SessionBase
 	{
 
@@ -73,8 +129,17 @@ namespace http_server
 				});
 		}
 
+		void Write(SendfileResponse&& response);
+
+		// Strand сессии: все операции с сокетом выполняются в нём
+		beast::tcp_stream::executor_type GetExecutor()
+		{
+			return stream_.get_executor();
+		}
+
 		explicit SessionBase(tcp::socket&& socket)
 			: stream_(std::move(socket))
+			, send_timer_(stream_.get_executor())
 		{}
 
 		using HttpRequest = http::request<http::string_body>;
@@ -102,8 +167,16 @@ namespace http_server
 			Read();
 		}
 
+		// Передаёт очередную порцию файла и ждёт готовности сокета перед следующей
+		void SendFileBody(std::shared_ptr<SendfileResponse> response, std::size_t bytes_written);
+
+		// Возвращает поток в io_context до готовности сокета к записи. Ожидание идёт мимо
+		// tcp_stream, поэтому таймаут отсчитывает send_timer_
+		void WaitWritable(std::shared_ptr<SendfileResponse> response, std::size_t bytes_written);
+
 		// tcp_stream содержит внутри себя сокет и добавляет поддержку таймаутов
 		beast::tcp_stream stream_;
+		net::steady_timer send_timer_;
 		beast::flat_buffer buffer_;
 		HttpRequest request_;
 
@@ -173,16 +246,22 @@ namespace http_server
 		void HandleRequest(HttpRequest&& request, const std::string& address) override
 		{
 			HttpRequest tmp{ std::move(request) };
-			json::object logger_data{ {"ip", address}, {"URI", tmp.target() }, {"method", tmp.method_string()} };
 
-			BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "request received"sv;
+			async_log::LogRequestReceived(address, tmp.target(), tmp.method_string());
 
 			// Захватываем умный указатель на текущий объект Session в лямбде,
 			// чтобы продлить время жизни сессии до вызова лямбды.
 			// Используется generic-лямбда функция, способная принять response произвольного типа
+			// Ответ может быть сформирован в strand карты, поэтому запись переносится в strand сессии.
+			// Если ответ готов сразу, dispatch выполнит запись на месте
 			request_handler_(std::move(tmp), [self = this->shared_from_this()](auto&& response)
 				{
-					self->Write(std::move(response));
+					using Response = std::decay_t<decltype(response)>;
+
+					net::dispatch(self->GetExecutor(), [self, response = Response(std::move(response))]() mutable
+						{
+							self->Write(std::move(response));
+						});
 				});
 		}
 
@@ -0,0 +1,362 @@
+#include "kinetic_engine.h"
+#include "model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <tuple>
+
+namespace model
+{
+	namespace
+	{
+		//Same as the ticked maps use
+		constexpr double GATHERER_WIDTH = 0.3;
+
+		//Where the dog would be along its way and to the side of it
+		struct Way
+		{
+			bool horizontal;
+
+			double Along(Coordinates pos) const
+			{
+				return horizontal ? pos.x : pos.y;
+			}
+
+			double Across(Coordinates pos) const
+			{
+				return horizontal ? pos.y : pos.x;
+			}
+		};
+	}
+
+	void KineticEngine::Advance(Map& map, PlayerList& players, std::span<const util::SlotKey> joined, int ms)
+	{
+		DogStore& dogs = map.GetDogs();
+
+		players_ = &players;
+
+		for (util::SlotKey key : joined)
+		{
+			Track(map, key);
+		}
+
+		//Actions since the last tick, they all happened at its end
+		for (const DogStore::VelocityChange& change : dogs.TakeVelocityChanges())
+		{
+			if (FindPlayer(change.slot) != nullptr)
+			{
+				Sweep(map, change.slot);
+				Age(change.slot, change.was_moving);
+				Schedule(map, change.slot);
+			}
+		}
+
+		//Stops and turns made here are already accounted for
+		dogs.TrackVelocityChanges(false);
+
+		const double end = now_ + ms;
+
+		while (!events_.empty() && events_.front().time <= end)
+		{
+			std::pop_heap(events_.begin(), events_.end(), std::greater<>{});
+			Event event = events_.back();
+			events_.pop_back();
+
+			if (event.generation != generations_[event.slot])
+			{
+				continue;
+			}
+
+			now_ = event.time;
+			dogs.SetClock(now_ / 1000);
+
+			Process(map, event);
+		}
+
+		now_ = end;
+		dogs.SetClock(now_ / 1000);
+		dogs.TrackVelocityChanges(true);
+
+		Compact();
+	}
+
+	void KineticEngine::Track(Map& map, util::SlotKey key)
+	{
+		const Player* player = players_->Find(key);
+
+		if (player == nullptr)
+		{
+			return;
+		}
+
+		const Dog* dog = player->GetDog();
+		DogStore::Slot slot = dog->GetSlot();
+
+		if (slot >= keys_.size())
+		{
+			size_t size = std::max(slot + 1, map.GetDogs().Size());
+
+			keys_.resize(size);
+			generations_.resize(size, 0);
+			swept_to_.resize(size);
+			aged_at_.resize(size, 0);
+		}
+
+		keys_[slot] = key;
+		swept_to_[slot] = dog->GetPos();
+		aged_at_[slot] = now_;
+
+		Schedule(map, slot);
+	}
+
+	Player* KineticEngine::FindPlayer(DogStore::Slot slot) const
+	{
+		return slot < keys_.size() ? players_->Find(keys_[slot]) : nullptr;
+	}
+
+	void KineticEngine::Schedule(const Map& map, DogStore::Slot slot)
+	{
+		const std::uint32_t generation = ++generations_[slot];
+		const Player* player = FindPlayer(slot);
+
+		if (player == nullptr || player->IsRetired())
+		{
+			return;
+		}
+
+		const DogStore& dogs = map.GetDogs();
+		Velocity vel{ dogs.GetVelX(slot), dogs.GetVelY(slot) };
+
+		if (vel.x == 0 && vel.y == 0)
+		{
+			PushEvent({ aged_at_[slot] + std::ceil(map.GetAFK() - player->GetIdleTime()), slot, generation, EventType::AFK, 0 });
+			return;
+		}
+
+		//Dogs only ever walk along one axis
+		if (vel.x != 0 && vel.y != 0)
+		{
+			return;
+		}
+
+		const Way way{ vel.x != 0 };
+		const double speed = way.horizontal ? vel.x : vel.y;
+		const double direction = speed > 0 ? 1 : -1;
+
+		Coordinates pos{ dogs.GetX(slot), dogs.GetY(slot) };
+		RoadBounds bounds = map.GetRoadBounds(dogs.GetRoad(slot));
+
+		double edge = way.horizontal ? (speed > 0 ? bounds.max_x : bounds.min_x) : (speed > 0 ? bounds.max_y : bounds.min_y);
+
+		//Distance to the nearest event and where it happens
+		double reach = std::max(0.0, (edge - way.Along(pos)) * direction);
+		double target = edge;
+		EventType type = EventType::ROAD_END;
+
+		auto consider = [&](Coordinates spot, double radius)
+		{
+			double ahead = (way.Along(spot) - way.Along(pos)) * direction;
+
+			if (ahead > 0 && ahead < reach && std::abs(way.Across(spot) - way.Across(pos)) <= radius)
+			{
+				reach = ahead;
+				target = way.Along(spot);
+				type = EventType::PASSING;
+			}
+		};
+
+		const geom::Point2D way_end = way.horizontal ? geom::Point2D{ edge, pos.y } : geom::Point2D{ pos.x, edge };
+
+		if (player->GetItemCount() < map.GetBagCapacity())
+		{
+			const collision_detector::ItemIndex& items = map.GetItemIndex();
+
+			candidates_.clear();
+			items.CollectCandidates({ pos.x, pos.y }, way_end, GATHERER_WIDTH, candidates_);
+
+			for (size_t id : candidates_)
+			{
+				const collision_detector::Item& item = items.GetItem(id);
+
+				consider({ item.position.x, item.position.y }, item.width + GATHERER_WIDTH);
+			}
+		}
+
+		if (player->GetItemCount() > 0)
+		{
+			candidates_.clear();
+			map.GetOfficeIndex().CollectCandidates({ pos.x, pos.y }, way_end, GATHERER_WIDTH, candidates_);
+
+			for (size_t id : candidates_)
+			{
+				const collision_detector::Item& office = map.GetOfficeIndex().GetItem(id);
+
+				consider({ office.position.x, office.position.y }, office.width + GATHERER_WIDTH);
+			}
+		}
+
+		PushEvent({ now_ + reach / std::abs(speed) * 1000, slot, generation, type, target });
+	}
+
+	void KineticEngine::Process(Map& map, const Event& event)
+	{
+		DogStore& dogs = map.GetDogs();
+		const DogStore::Slot slot = event.slot;
+
+		if (event.type == EventType::AFK)
+		{
+			Age(slot, false);
+		}
+		else
+		{
+			//Exactly at the spot, the arithmetic may land a hair short of it or past it
+			if (dogs.GetVelX(slot) != 0)
+			{
+				dogs.SetPos(slot, event.target, dogs.GetY(slot));
+			}
+			else
+			{
+				dogs.SetPos(slot, dogs.GetX(slot), event.target);
+			}
+
+			Sweep(map, slot);
+
+			if (event.type == EventType::ROAD_END && !Dog{ &map, slot }.CrossJunction())
+			{
+				//Idling starts now
+				Age(slot, true);
+			}
+		}
+
+		Schedule(map, slot);
+	}
+
+	void KineticEngine::Sweep(Map& map, DogStore::Slot slot)
+	{
+		const DogStore& dogs = map.GetDogs();
+
+		Coordinates from = swept_to_[slot];
+		Coordinates to{ dogs.GetX(slot), dogs.GetY(slot) };
+
+		swept_to_[slot] = to;
+
+		//Dogs walk along one axis between sweeps, anything else is a jump made outside the engine
+		if (from.x != to.x && from.y != to.y)
+		{
+			from = to;
+		}
+
+		const Way way{ from.y == to.y };
+		const double low = std::min(way.Along(from), way.Along(to));
+		const double high = std::max(way.Along(from), way.Along(to));
+
+		//Things on the way, by the distance from the start of it. Offices are visited after the items at the same spot
+		struct Stop
+		{
+			double distance;
+			bool is_office;
+			size_t item;
+		};
+
+		std::vector<Stop> stops;
+
+		const collision_detector::ItemIndex& items = map.GetItemIndex();
+
+		candidates_.clear();
+		items.CollectCandidates({ from.x, from.y }, { to.x, to.y }, GATHERER_WIDTH, candidates_);
+
+		for (size_t id : candidates_)
+		{
+			const collision_detector::Item& item = items.GetItem(id);
+			Coordinates item_pos{ item.position.x, item.position.y };
+			double along = way.Along(item_pos);
+
+			if (along >= low && along <= high && std::abs(way.Across(item_pos) - way.Across(to)) <= item.width + GATHERER_WIDTH)
+			{
+				stops.push_back({ std::abs(along - way.Along(from)), false, id });
+			}
+		}
+
+		candidates_.clear();
+		map.GetOfficeIndex().CollectCandidates({ from.x, from.y }, { to.x, to.y }, GATHERER_WIDTH, candidates_);
+
+		for (size_t id : candidates_)
+		{
+			const collision_detector::Item& office = map.GetOfficeIndex().GetItem(id);
+			Coordinates center{ office.position.x, office.position.y };
+
+			//Closest point of the way to the office
+			double along = std::clamp(way.Along(center), low, high);
+
+			if (std::hypot(along - way.Along(center), way.Across(to) - way.Across(center)) <= office.width + GATHERER_WIDTH)
+			{
+				stops.push_back({ std::abs(along - way.Along(from)), true, 0 });
+			}
+		}
+
+		if (stops.empty())
+		{
+			return;
+		}
+
+		std::sort(stops.begin(), stops.end(), [](const Stop& lhs, const Stop& rhs)
+			{
+				return std::tie(lhs.distance, lhs.is_office, lhs.item) < std::tie(rhs.distance, rhs.is_office, rhs.item);
+			});
+
+		Player* player = FindPlayer(slot);
+		const util::SlotMap<Item>& map_items = map.GetItemList();
+		std::vector<size_t> collected;
+
+		for (const Stop& stop : stops)
+		{
+			if (stop.is_office)
+			{
+				player->Depot();
+			}
+			else if (player->GetItemCount() < map.GetBagCapacity())
+			{
+				player->StoreItem(map_items[stop.item]);
+				collected.push_back(stop.item);
+			}
+		}
+
+		std::sort(collected.rbegin(), collected.rend());
+
+		for (size_t item : collected)
+		{
+			map.RemoveItem(static_cast<int>(item));
+		}
+	}
+
+	void KineticEngine::Age(DogStore::Slot slot, bool moving)
+	{
+		//Rounded up, so the AFK event always brings the idle time up to the threshold
+		int ms = static_cast<int>(std::ceil(now_ - aged_at_[slot]));
+
+		if (ms > 0)
+		{
+			aged_at_[slot] += ms;
+		}
+
+		FindPlayer(slot)->AddTime(std::max(ms, 0), moving);
+	}
+
+	void KineticEngine::PushEvent(Event event)
+	{
+		events_.push_back(event);
+		std::push_heap(events_.begin(), events_.end(), std::greater<>{});
+	}
+
+	void KineticEngine::Compact()
+	{
+		if (events_.size() <= 2 * players_->Size() + 64)
+		{
+			return;
+		}
+
+		std::erase_if(events_, [this](const Event& event) { return event.generation != generations_[event.slot]; });
+		std::make_heap(events_.begin(), events_.end(), std::greater<>{});
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "model_core.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace model
+{
+	class Player;
+
+	//Players of one map
+	using PlayerList = util::SlotMap<Player>;
+
+	//Event-driven way of running a map. Instead of stepping every dog each tick, a moving dog gets the time
+	//of the next thing that can happen to it: reaching the end of its road, or an item or an office on
+	//the way. A standing one gets the time it goes AFK. A tick only touches the dogs whose events fall
+	//inside it, the DogStore works out where the others are from the time they were last settled.
+	//Belongs to the map's strand like the map itself
+	class KineticEngine
+	{
+	public:
+		//Runs the map for ms milliseconds. Joined are the keys of the players added to the list since the last call
+		void Advance(Map& map, PlayerList& players, std::span<const util::SlotKey> joined, int ms);
+
+		//Events queued, stale ones included
+		size_t GetEventCount() const
+		{
+			return events_.size();
+		}
+
+	private:
+		enum class EventType : char
+		{
+			ROAD_END,
+			PASSING,
+			AFK
+		};
+
+		struct Event
+		{
+			double time;
+			DogStore::Slot slot;
+			std::uint32_t generation;
+			EventType type;
+
+			//Coordinate along the way the event happens at
+			double target;
+
+			bool operator>(const Event& other) const
+			{
+				return time != other.time ? time > other.time : slot > other.slot;
+			}
+		};
+
+		void Track(Map& map, util::SlotKey key);
+
+		//Player of a tracked dog, nullptr once released
+		Player* FindPlayer(DogStore::Slot slot) const;
+
+		//Replaces the pending event of the dog with a fresh one
+		void Schedule(const Map& map, DogStore::Slot slot);
+
+		void Process(Map& map, const Event& event);
+
+		//Collects the items and visits the offices passed since the last sweep, in the order the dog met them
+		void Sweep(Map& map, DogStore::Slot slot);
+
+		//Brings the age of the player up to now. The dog either moved or stood still since the last time
+		void Age(DogStore::Slot slot, bool moving);
+
+		void PushEvent(Event event);
+
+		//Drops the stale events once they outnumber the live ones
+		void Compact();
+
+		//Milliseconds since the first tick
+		double now_ = 0;
+
+		//Min-heap on the event time
+		std::vector<Event> events_;
+
+		//List of the map being advanced
+		PlayerList* players_ = nullptr;
+
+		//By dog slot. A slot freed and taken by another dog gets the key of the new player
+		std::vector<util::SlotKey> keys_;
+		std::vector<std::uint32_t> generations_;
+		std::vector<Coordinates> swept_to_;
+		std::vector<double> aged_at_;
+
+		//Scratch space for item lookups
+		std::vector<size_t> candidates_;
+	};
+}
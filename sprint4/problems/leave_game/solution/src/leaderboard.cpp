@@ -0,0 +1,374 @@
+#include "leaderboard.h"
+
+#include <algorithm>
+#include <mutex>
+
+using pqxx::operator"" _zv;
+
+namespace db
+{
+	namespace
+	{
+		constexpr pqxx::zview RECORDS_PAGE = "records_page"_zv;
+		constexpr pqxx::zview BEST_RECORD = "best_record"_zv;
+		constexpr pqxx::zview RECORDS_ABOVE = "records_above"_zv;
+	}
+
+	Leaderboard::Leaderboard(std::size_t capacity)
+		:capacity_(capacity) {}
+
+	void Leaderboard::Load(ConnectionPool& pool)
+	{
+		ConnectionPool::ConnectionWrapper wrap = pool.GetConnection();
+		pqxx::read_transaction read_t{ *wrap };
+
+		const auto total = read_t.query_value<std::int64_t>("SELECT COUNT(*) FROM retired_players;"_zv);
+
+		pqxx::result rows = read_t.exec_params("SELECT name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT $1;"_zv,
+			static_cast<std::int64_t>(capacity_));
+
+		for (const auto& row : rows)
+		{
+			Add({ row[0].as<std::string>(), row[1].as<std::int64_t>(), row[2].as<std::int64_t>() });
+		}
+
+		std::unique_lock lock{ mutex_ };
+		total_ = std::max(total_, static_cast<std::size_t>(total));
+	}
+
+	void Leaderboard::Add(Record record)
+	{
+		std::unique_lock lock{ mutex_ };
+
+		++total_;
+		const std::uint64_t sequence = next_sequence_++;
+
+		if (capacity_ == 0)
+		{
+			return;
+		}
+
+		if (SizeOf(root_) == capacity_)
+		{
+			std::uint32_t worst = root_;
+
+			while (nodes_[worst].right != NIL)
+			{
+				worst = nodes_[worst].right;
+			}
+
+			if (!Less(record, sequence, nodes_[worst]))
+			{
+				return;
+			}
+
+			DropWorst();
+		}
+
+		std::uint32_t index;
+
+		if (free_.empty())
+		{
+			index = static_cast<std::uint32_t>(nodes_.size());
+			nodes_.emplace_back();
+		}
+		else
+		{
+			index = free_.back();
+			free_.pop_back();
+		}
+
+		Node& node = nodes_[index];
+
+		node = Node{};
+		node.record = std::move(record);
+		node.sequence = sequence;
+		node.priority = static_cast<std::uint32_t>(random_() >> 32);
+
+		auto [before, after] = Split(root_, node.record, sequence);
+		root_ = Merge(Merge(before, index), after);
+
+		auto [it, inserted] = best_.try_emplace(nodes_[index].record.name, index);
+
+		if (!inserted && Less(nodes_[index].record, sequence, nodes_[it->second]))
+		{
+			it->second = index;
+		}
+	}
+
+	std::optional<std::vector<Record>> Leaderboard::GetRange(std::size_t start, std::size_t count) const
+	{
+		std::shared_lock lock{ mutex_ };
+
+		const std::size_t size = SizeOf(root_);
+
+		if (start + count > size && total_ > size)
+		{
+			return std::nullopt;
+		}
+
+		std::vector<Record> result;
+		result.reserve(start < size ? std::min(count, size - start) : 0);
+
+		//Ancestors still to be listed, the node at start ends up on top
+		std::vector<std::uint32_t> path;
+		std::uint32_t node = root_;
+		std::size_t skip = start;
+
+		while (node != NIL)
+		{
+			const std::size_t left = SizeOf(nodes_[node].left);
+
+			if (skip < left)
+			{
+				path.push_back(node);
+				node = nodes_[node].left;
+			}
+			else if (skip == left)
+			{
+				path.push_back(node);
+				break;
+			}
+			else
+			{
+				skip -= left + 1;
+				node = nodes_[node].right;
+			}
+		}
+
+		while (!path.empty() && result.size() < count)
+		{
+			node = path.back();
+			path.pop_back();
+
+			result.push_back(nodes_[node].record);
+
+			for (std::uint32_t next = nodes_[node].right; next != NIL; next = nodes_[next].left)
+			{
+				path.push_back(next);
+			}
+		}
+
+		return result;
+	}
+
+	std::optional<RankedRecord> Leaderboard::FindRank(std::string_view name) const
+	{
+		std::shared_lock lock{ mutex_ };
+
+		auto it = best_.find(std::string{ name });
+
+		if (it == best_.end())
+		{
+			return std::nullopt;
+		}
+
+		const Node& node = nodes_[it->second];
+
+		return RankedRecord{ RankOf(node.record, node.sequence), node.record };
+	}
+
+	bool Leaderboard::IsComplete() const
+	{
+		std::shared_lock lock{ mutex_ };
+		return total_ == SizeOf(root_);
+	}
+
+	std::size_t Leaderboard::Size() const
+	{
+		std::shared_lock lock{ mutex_ };
+		return SizeOf(root_);
+	}
+
+	std::size_t Leaderboard::GetTotal() const
+	{
+		std::shared_lock lock{ mutex_ };
+		return total_;
+	}
+
+	void Leaderboard::PrepareStatements(ConnectionPool& pool)
+	{
+		pool.Prepare(std::string{ RECORDS_PAGE }, "SELECT name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT $1 OFFSET $2;");
+		pool.Prepare(std::string{ BEST_RECORD }, "SELECT score, play_time_ms FROM retired_players WHERE name = $1 ORDER BY score DESC, play_time_ms LIMIT 1;");
+
+		//Mixed directions rule out a row comparison, so the order is spelled out. The index covers it
+		pool.Prepare(std::string{ RECORDS_ABOVE }, "SELECT COUNT(*) FROM retired_players WHERE score > $2 OR (score = $2 AND (play_time_ms < $3 OR (play_time_ms = $3 AND name < $1)));");
+	}
+
+	std::vector<Record> Leaderboard::QueryRange(pqxx::connection& connection, std::size_t start, std::size_t count)
+	{
+		pqxx::read_transaction read_t{ connection };
+
+		pqxx::result rows = read_t.exec_prepared(RECORDS_PAGE, static_cast<std::int64_t>(count), static_cast<std::int64_t>(start));
+
+		std::vector<Record> result;
+		result.reserve(rows.size());
+
+		for (const auto& row : rows)
+		{
+			result.push_back({ row[0].as<std::string>(), row[1].as<std::int64_t>(), row[2].as<std::int64_t>() });
+		}
+
+		return result;
+	}
+
+	std::optional<RankedRecord> Leaderboard::QueryRank(pqxx::connection& connection, std::string_view name)
+	{
+		pqxx::read_transaction read_t{ connection };
+
+		pqxx::result best = read_t.exec_prepared(BEST_RECORD, name);
+
+		if (best.empty())
+		{
+			return std::nullopt;
+		}
+
+		RankedRecord result{ 0, { std::string{ name }, best[0][0].as<std::int64_t>(), best[0][1].as<std::int64_t>() } };
+
+		pqxx::result better = read_t.exec_prepared(RECORDS_ABOVE, name, result.record.score, result.record.play_time_ms);
+
+		result.rank = static_cast<std::size_t>(better[0][0].as<std::int64_t>()) + 1;
+
+		return result;
+	}
+
+	bool Leaderboard::Less(const Record& record, std::uint64_t sequence, const Node& node)
+	{
+		if (record.score != node.record.score)
+		{
+			return record.score > node.record.score;
+		}
+
+		if (record.play_time_ms != node.record.play_time_ms)
+		{
+			return record.play_time_ms < node.record.play_time_ms;
+		}
+
+		if (int order = record.name.compare(node.record.name); order != 0)
+		{
+			return order < 0;
+		}
+
+		return sequence < node.sequence;
+	}
+
+	std::uint32_t Leaderboard::SizeOf(std::uint32_t node) const
+	{
+		return node == NIL ? 0 : nodes_[node].size;
+	}
+
+	void Leaderboard::Update(std::uint32_t node)
+	{
+		nodes_[node].size = SizeOf(nodes_[node].left) + SizeOf(nodes_[node].right) + 1;
+	}
+
+	std::pair<std::uint32_t, std::uint32_t> Leaderboard::Split(std::uint32_t node, const Record& record, std::uint64_t sequence)
+	{
+		if (node == NIL)
+		{
+			return { NIL, NIL };
+		}
+
+		if (Less(record, sequence, nodes_[node]))
+		{
+			auto [before, after] = Split(nodes_[node].left, record, sequence);
+			nodes_[node].left = after;
+			Update(node);
+
+			return { before, node };
+		}
+
+		auto [before, after] = Split(nodes_[node].right, record, sequence);
+		nodes_[node].right = before;
+		Update(node);
+
+		return { node, after };
+	}
+
+	std::pair<std::uint32_t, std::uint32_t> Leaderboard::SplitAt(std::uint32_t node, std::size_t count)
+	{
+		if (node == NIL)
+		{
+			return { NIL, NIL };
+		}
+
+		const std::size_t left = SizeOf(nodes_[node].left);
+
+		if (count <= left)
+		{
+			auto [before, after] = SplitAt(nodes_[node].left, count);
+			nodes_[node].left = after;
+			Update(node);
+
+			return { before, node };
+		}
+
+		auto [before, after] = SplitAt(nodes_[node].right, count - left - 1);
+		nodes_[node].right = before;
+		Update(node);
+
+		return { node, after };
+	}
+
+	std::uint32_t Leaderboard::Merge(std::uint32_t left, std::uint32_t right)
+	{
+		if (left == NIL)
+		{
+			return right;
+		}
+
+		if (right == NIL)
+		{
+			return left;
+		}
+
+		if (nodes_[left].priority > nodes_[right].priority)
+		{
+			nodes_[left].right = Merge(nodes_[left].right, right);
+			Update(left);
+
+			return left;
+		}
+
+		nodes_[right].left = Merge(left, nodes_[right].left);
+		Update(right);
+
+		return right;
+	}
+
+	std::size_t Leaderboard::RankOf(const Record& record, std::uint64_t sequence) const
+	{
+		std::size_t count = 0;
+		std::uint32_t node = root_;
+
+		while (node != NIL)
+		{
+			if (Less(record, sequence, nodes_[node]))
+			{
+				node = nodes_[node].left;
+			}
+			else
+			{
+				count += SizeOf(nodes_[node].left) + 1;
+				node = nodes_[node].right;
+			}
+		}
+
+		return count;
+	}
+
+	void Leaderboard::DropWorst()
+	{
+		auto [rest, worst] = SplitAt(root_, SizeOf(root_) - 1);
+		root_ = rest;
+
+		//The worst record is the player's best only if it's the last one the player has in memory
+		if (auto it = best_.find(nodes_[worst].record.name); it != best_.end() && it->second == worst)
+		{
+			best_.erase(it);
+		}
+
+		nodes_[worst].record = {};
+		free_.push_back(worst);
+	}
+}
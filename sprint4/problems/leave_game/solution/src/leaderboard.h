@@ -0,0 +1,120 @@
+#pragma once
+
+#include "DB_manager.h"
+#include "random.h"
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace db
+{
+	struct Record
+	{
+		std::string name;
+		std::int64_t score = 0;
+		std::int64_t play_time_ms = 0;
+	};
+
+	//Best record of a player and its place in the table, the first place is 1
+	struct RankedRecord
+	{
+		std::size_t rank = 0;
+		Record record;
+	};
+
+	//Top of retired_players kept in memory, ordered by score descending, play time and name like the
+	//records endpoint. It's a treap where every node knows the size of its subtree, so a page starting
+	//anywhere takes O(log n + k) and a rank O(log n). Past capacity the worst records are dropped, the
+	//table then only knows the top and the queries below go to the database for the rest
+	class Leaderboard
+	{
+	public:
+		static constexpr std::size_t DEFAULT_CAPACITY = 100'000;
+
+		explicit Leaderboard(std::size_t capacity = DEFAULT_CAPACITY);
+
+		Leaderboard(const Leaderboard&) = delete;
+		Leaderboard& operator=(const Leaderboard&) = delete;
+
+		//Takes the top of retired_players and the number of rows. Meant for startup, before any Add
+		void Load(ConnectionPool& pool);
+
+		void Add(Record record);
+
+		//Nullopt if the page reaches past the records in memory and the database has more
+		std::optional<std::vector<Record>> GetRange(std::size_t start, std::size_t count) const;
+
+		//Nullopt if the player has no record in memory, IsComplete tells whether the database may still have one
+		std::optional<RankedRecord> FindRank(std::string_view name) const;
+
+		//Every record ever added is in memory
+		bool IsComplete() const;
+
+		//Records in memory
+		std::size_t Size() const;
+
+		//Records in memory and in the database
+		std::size_t GetTotal() const;
+
+		//Registers the queries below with the pool, they run as prepared statements
+		static void PrepareStatements(ConnectionPool& pool);
+
+		//Page of retired_players read with LIMIT and OFFSET
+		static std::vector<Record> QueryRange(pqxx::connection& connection, std::size_t start, std::size_t count);
+
+		static std::optional<RankedRecord> QueryRank(pqxx::connection& connection, std::string_view name);
+
+	private:
+		static constexpr std::uint32_t NIL = UINT32_MAX;
+
+		//Records equal in every field are told apart by the order they came in
+		struct Node
+		{
+			Record record;
+			std::uint64_t sequence = 0;
+			std::uint32_t priority = 0;
+			std::uint32_t size = 1;
+			std::uint32_t left = NIL;
+			std::uint32_t right = NIL;
+		};
+
+		static bool Less(const Record& record, std::uint64_t sequence, const Node& node);
+
+		std::uint32_t SizeOf(std::uint32_t node) const;
+		void Update(std::uint32_t node);
+
+		//Splits the tree into nodes ordered before the record and the rest
+		std::pair<std::uint32_t, std::uint32_t> Split(std::uint32_t node, const Record& record, std::uint64_t sequence);
+
+		//The first count nodes and the rest
+		std::pair<std::uint32_t, std::uint32_t> SplitAt(std::uint32_t node, std::size_t count);
+
+		std::uint32_t Merge(std::uint32_t left, std::uint32_t right);
+
+		//Place of a record in memory, counted from 1
+		std::size_t RankOf(const Record& record, std::uint64_t sequence) const;
+
+		void DropWorst();
+
+		std::size_t capacity_;
+
+		mutable std::shared_mutex mutex_;
+
+		std::vector<Node> nodes_;
+		std::vector<std::uint32_t> free_;
+		std::uint32_t root_ = NIL;
+
+		//Node of the best record of every player in memory
+		std::unordered_map<std::string, std::uint32_t> best_;
+
+		std::size_t total_ = 0;
+		std::uint64_t next_sequence_ = 0;
+
+		util::Xoshiro256 random_{ 0x5eed };
+	};
+}
@@ -10,6 +10,10 @@
 #include <optional>
 
 #include "DB_manager.h"
+#include "leaderboard.h"
+#include "query_executor.h"
+#include "retirement_writer.h"
+#include "game_executor.h"
 #include "json_loader.h"
 #include "request_handler.h"
 #include "save_manager.h"
@@ -69,9 +73,11 @@ class Ticker : public std::enable_shared_from_this<Ticker>
 {
 public:
 	using Strand = net::strand<net::io_context::executor_type>;
-	using Handler = std::function<void(std::chrono::milliseconds delta)>;
+	using Done = std::function<void()>;
+	using Handler = std::function<void(std::chrono::milliseconds delta, Done done)>;
 
-	// Функция handler будет вызываться внутри strand с интервалом period
+	// Функция handler будет вызываться внутри strand с интервалом period.
+	// Следующий тик планируется только после вызова done, поэтому тики не накладываются друг на друга
 	Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
 		: strand_{ strand }
 		, period_{ period }
@@ -88,7 +94,8 @@ public:
 private:
 	void ScheduleTick() {
 		assert(strand_.running_in_this_thread());
-		timer_.expires_after(period_);
+		// Отсчитываем от начала прошлого тика: если тик затянулся, следующий начнётся сразу
+		timer_.expires_at(last_tick_ + period_);
 		timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
 			self->OnTick(ec);
 			});
@@ -103,11 +110,15 @@ private:
 			auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
 			last_tick_ = this_tick;
 			try {
-				handler_(delta);
+				handler_(delta, [self = shared_from_this()] {
+					net::dispatch(self->strand_, [self] {
+						self->ScheduleTick();
+						});
+					});
 			}
 			catch (...) {
+				ScheduleTick();
 			}
-			ScheduleTick();
 		}
 	}
 
@@ -128,6 +139,10 @@ struct Args
 	int tick_period;
 	int autosave_period = -1;
 	bool randomize = false;
+	bool kinetic = false;
+	std::optional<std::uint64_t> random_seed;
+	std::uintmax_t sendfile_threshold = http_handler::DEFAULT_SENDFILE_THRESHOLD;
+	std::vector<std::string> log_sampling;
 };
 
 [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) 
@@ -145,7 +160,11 @@ struct Args
 		("config-file,c", po::value(&args.config_file)->value_name("file"s), "set config file path")
 		("state-file,s", po::value(&args.save_file)->value_name("file"s), "set save file path")
 		("www-root,w", po::value(&args.static_dir)->value_name("dir"s), "set static files root")
-		("randomize-spawn-points", "spawn dogs at random positions");	
+		("sendfile-threshold", po::value(&args.sendfile_threshold)->value_name("bytes"s), "send static files bigger than this with sendfile")
+		("log-sampling", po::value(&args.log_sampling)->multitoken()->value_name("event=N"s), "log one of every N events (request_received, response_sent, generated_item, collected_item, map_tick)")
+		("randomize-spawn-points", "spawn dogs at random positions")
+		("kinetic-simulation", "move dogs from event to event instead of stepping every dog each tick")
+		("random-seed", po::value<std::uint64_t>()->value_name("seed"s), "spawn loot and dogs the same way on every run");
 
 	po::variables_map vm;
 	po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -196,6 +215,16 @@ struct Args
 		args.randomize = true;
 	}
 
+	if (vm.contains("kinetic-simulation"))
+	{
+		args.kinetic = true;
+	}
+
+	if (vm.contains("random-seed"))
+	{
+		args.random_seed = vm["random-seed"].as<std::uint64_t>();
+	}
+
 	return args;
 }
 
@@ -217,6 +246,11 @@ int main(int argc, const char* argv[])
 				return EXIT_FAILURE;
 			}
 		}
+
+		for (const std::string& spec : args.log_sampling)
+		{
+			async_log::Logger::Instance().ConfigureSampling(spec);
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -236,10 +270,11 @@ int main(int argc, const char* argv[])
 
 		const unsigned num_threads = std::thread::hardware_concurrency();
 
-		//Creating and initializing the connection pool
+		//Creating and initializing the connection pool. An idle server keeps a single connection,
+		//more are opened while requests and the writer need them
 		db::ConnectionPool conn_pool
 		{
-			num_threads, [db_url]
+			1, std::max(2u, num_threads), [db_url]
 			{
 				auto conn = std::make_shared<pqxx::connection>(db_url);
 				return conn;
@@ -255,9 +290,28 @@ int main(int argc, const char* argv[])
 			work.commit();
 		}
 
+		//Statements are prepared against the tables, so only once they exist
+		db::Leaderboard::PrepareStatements(conn_pool);
+
+		//Retired players are written in batches by a background thread, ticks never wait for the database
+		db::RetirementWriter retirement_writer{ conn_pool };
+		retirement_writer.Start();
+
+		//Records are served from memory, only pages past the top kept there go to the database
+		db::Leaderboard leaderboard;
+		leaderboard.Load(conn_pool);
+
 		// 1. Загружаем карту из файла и построить модель игры
 		model::Players player_manager_{args.randomize};
 		model::Game game = json_loader::LoadGame(args.config_file, player_manager_, conn_pool);
+		game.SetKineticMode(args.kinetic);
+		game.SetRetirementWriter(&retirement_writer);
+		game.SetLeaderboard(&leaderboard);
+
+		if (args.random_seed)
+		{
+			game.SetRandomSeed(*args.random_seed);
+		}
 
 		savesystem::SaveManager save_manager{ args.save_file, args.autosave_period, game };
 
@@ -271,6 +325,13 @@ int main(int argc, const char* argv[])
 		// 2. Инициализируем io_context
 		net::io_context ioc(num_threads);
 
+		//Each map lives on its own strand, so maps are served and ticked in parallel
+		model::GameExecutor executor{ ioc, game };
+
+		//Requests that need the database wait for it on these threads, io threads never do
+		db::QueryExecutor query_executor{ conn_pool, num_threads, ioc.get_executor() };
+		game.SetQueryExecutor(&query_executor);
+
 		// 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
 		net::signal_set signals(ioc, SIGINT, SIGTERM);
 		
@@ -284,7 +345,8 @@ int main(int argc, const char* argv[])
         	
 		// 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
 		bool rest_api_tick_system = args.tick_period == -1;
-		http_handler::RequestHandler handler{ args.static_dir, game, rest_api_tick_system, save_manager};
+		http_handler::RequestHandler handler{ args.static_dir, game, executor, rest_api_tick_system, save_manager, args.sendfile_threshold };
+		handler.WatchStaticFiles(ioc);
 
 		const auto address = net::ip::make_address("0.0.0.0");
 		constexpr net::ip::port_type port = 8080;
@@ -293,6 +355,9 @@ int main(int argc, const char* argv[])
 
 		InitBoostLogFilter();
 
+		//Requests and loot events are written by a background thread
+		async_log::Logger::Instance().Start();
+
 		http_server::ServeHttp(ioc, { address, port }, [&handler](auto&& req, auto&& send)
 			{
 				handler(std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
@@ -307,12 +372,16 @@ int main(int argc, const char* argv[])
 
 		if (!rest_api_tick_system)
 		{
-			auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds(args.tick_period), [&game, &save_manager](std::chrono::milliseconds delta)
+			auto ticker = std::make_shared<Ticker>(api_strand, std::chrono::milliseconds(args.tick_period), [&executor, &save_manager](std::chrono::milliseconds delta, Ticker::Done done)
 				{
-					double ms = static_cast<double>(delta.count());
-
-					game.ServerTick(ms);
-					save_manager.Listen(ms);
+					int ms = static_cast<int>(delta.count());
+
+					//Maps are ticked on their own strands, the autosave waits until all of them are done
+					//and the next tick waits for the autosave
+					executor.Tick(ms, [&executor, &save_manager, ms, done = std::move(done)]
+						{
+							save_manager.Listen(ms, executor, done);
+						});
 				}
 			);
 
@@ -330,9 +399,26 @@ int main(int argc, const char* argv[])
 			save_manager.SaveState();
 		}
 
+		query_executor.Stop();
+
+		db::QueryMetrics query_metrics = query_executor.GetMetrics();
+		json::object query_data{ {"completed", query_metrics.completed}, {"failed", query_metrics.failed}, {"timedOut", query_metrics.timed_out},
+			{"maxQueueDepth", query_metrics.max_queue_depth}, {"maxWaitUs", query_metrics.max_wait.count()} };
+
+		BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, query_data) << "database queries"sv;
+
+		retirement_writer.Stop();
+
+		db::RetirementWriter::Metrics metrics = retirement_writer.GetMetrics();
+		json::object writer_data{ {"written", metrics.written}, {"batches", metrics.batches}, {"retries", metrics.retries}, {"overflowed", metrics.overflowed}, {"lost", metrics.lost} };
+
+		BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, writer_data) << "retirements written"sv;
+
 	}
 	catch (const std::exception& ex)
 	{
+		async_log::Logger::Instance().Stop();
+
 		//Logging server exit with errors
 		json::object logger_data{ {"code", EXIT_FAILURE}, {"exception", ex.what()} };
 
@@ -342,6 +428,8 @@ int main(int argc, const char* argv[])
 	}
 
 
+	async_log::Logger::Instance().Stop();
+
 	//Logging server exit without errors
 	json::object logger_data{ {"code", 0} };
 
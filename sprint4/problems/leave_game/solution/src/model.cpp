@@ -26,8 +26,17 @@ namespace model
 		}
 
 		map.SetAFK(afk_threshold);
+		map.SetLootGenerator(*extra_data_.GetLootGenerator());
+		map.SetLootTable(extra_data_.GetCompiledTable(*map.GetId()));
+		map.SetRetirementWriter(retirement_writer_);
+		map.SetLeaderboard(leaderboard_);
 
 		const size_t index = maps_.size();
+
+		if (random_seed_)
+		{
+			map.SeedRandom(*random_seed_ + index);
+		}
 		if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
 			throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
 		}
@@ -42,102 +51,274 @@ namespace model
 				map_id_to_index_.erase(it);
 				throw;
 			}
+
+			player_manager_.AddMap(*maps_.back().GetId());
+			state_snapshots_->AddMap();
+			kinetic_engines_.emplace_back();
+			afk_watches_.emplace_back();
+
+			//Both ways of running a map learn about stops and starts from the store
+			maps_.back().GetDogs().TrackVelocityChanges(true);
 		}
 	}
 
-	void Game::MoveAndCalcPickups(Map& map, int ms)
+	void Game::SetRetirementWriter(db::RetirementWriter* writer)
 	{
-		std::string map_id{ *(map.GetId()) };
+		retirement_writer_ = writer;
 
-		//Saving positions of players with an empty slots in their bags before moving them
-		std::deque<Coordinates> start_positions{ player_manager_.GetLooterPositionsByMap(map_id) };
+		for (Map& map : maps_)
+		{
+			map.SetRetirementWriter(writer);
+		}
+	}
 
-		//Moving Players
-		player_manager_.MoveAllByMap(ms, map_id);
+	void Game::SetLeaderboard(db::Leaderboard* leaderboard)
+	{
+		leaderboard_ = leaderboard;
 
-		//Saving positions of players with an empty slots in their bags
-		std::deque<Coordinates> end_positions{ player_manager_.GetLooterPositionsByMap(map_id) };
+		for (Map& map : maps_)
+		{
+			map.SetLeaderboard(leaderboard);
+		}
+	}
 
-		//Getting a list of all items on the map
-		const std::deque<Item>& map_items = map.GetItemList();
+	void Game::SetRandomSeed(std::uint64_t seed)
+	{
+		random_seed_ = seed;
 
-		//Temporary container to feed ItemProvider (Item Data)
-		std::vector<collision_detector::Item> items;
+		for (size_t i = 0; i < maps_.size(); ++i)
+		{
+			maps_[i].SeedRandom(seed + i);
+		}
+	}
+
+	void Game::SetKineticMode(bool kinetic)
+	{
+		kinetic_ = kinetic;
+	}
+
+	void Game::MoveAndCalcPickups(Map& map, int ms)
+	{
+		std::string map_id{ *(map.GetId()) };
 
-		for (const auto& item : map_items)
+		//Every player of the map with their position before moving them, full bags still have offices to reach
+		std::vector<Player*> players;
+		std::vector<Coordinates> start_positions;
+
+		//Nobody joins or leaves the list until the tick is over, so the pointers hold
+		for (Player& player : player_manager_.GetPlayerList(map_id))
 		{
-			items.push_back({ {item.pos.x, item.pos.y}, item.width });
+			players.push_back(&player);
+			start_positions.push_back(player.GetPos());
 		}
 
+		//Moving Players
+		player_manager_.MoveAllByMap(ms, map);
 
-		//Temporary container to feed ItemProvider (Gatherer Data)
 		std::vector<collision_detector::Gatherer> gatherers;
 
-		for (int i = 0; i < start_positions.size(); ++i)
+		for (size_t i = 0; i < players.size(); ++i)
 		{
-			gatherers.push_back({ {start_positions[i].x, start_positions[i].y}, {end_positions[i].x, end_positions[i].y}, .3 });
-		}
+			Coordinates end_position = players[i]->GetPos();
 
-		//The provider itself
-		collision_detector::VectorItemGathererProvider provider{ items, gatherers };
+			gatherers.push_back({ {start_positions[i].x, start_positions[i].y}, {end_position.x, end_position.y}, .3 });
+		}
 
-		//Calculating collisions
-		auto events = collision_detector::FindGatherEvents(provider);
+		//Items and offices swept in one pass against the targets near each path only
+		auto events = collision_detector::FindGatherEvents(map.GetItemIndex(), map.GetOfficeIndex(), gatherers);
 
 		//Items to remove
 		std::set<int> removed_ids;
 
+		//In time order, so a dog can pick up, deposit and pick up again within one step
 		for (collision_detector::GatheringEvent& loot_event : events)
 		{
+			//Gatherer ids are indices in this map's player list, not global player ids
+			Player* player = players[loot_event.gatherer_id];
+
+			if (loot_event.is_office)
+			{
+				player->Depot();
+				continue;
+			}
+
 			int item_id = loot_event.item_id;
-			removed_ids.insert(item_id);
 
-			player_manager_.FindPlayerByIdx(loot_event.gatherer_id)->StoreItem(map.GetItemByIdx(item_id));
+			//Taken earlier in the step, or no room left in the bag
+			if (removed_ids.contains(item_id) || player->GetItemCount() >= map.GetBagCapacity())
+			{
+				continue;
+			}
+
+			removed_ids.insert(item_id);
+			player->StoreItem(map.GetItemByIdx(item_id));
 		}
 
 		for (auto iter = removed_ids.rbegin(); iter != removed_ids.rend(); ++iter)
 		{
 			map.RemoveItem(*iter);
-		} //Wonder if I forgot anything..
+		}
+	}
+
+	void Game::TickMap(Map& map, int milliseconds)
+	{
+		std::vector<util::SlotKey> joined = player_manager_.TakeJoined(*map.GetId());
 
-		for(auto& player : player_manager_.GetPlayerList(map_id))
+		if (kinetic_)
 		{
-			Coordinates player_pos = player->GetPos();
+			kinetic_engines_[GetMapIndex(map)].Advance(map, player_manager_.GetPlayerList(*map.GetId()), joined, milliseconds);
+		}
+		else
+		{
+			afk_watches_[GetMapIndex(map)].Advance(map, player_manager_.GetPlayerList(*map.GetId()), joined, milliseconds);
+			MoveAndCalcPickups(map, milliseconds);
+		}
 
-			for (auto& office : map.GetOffices())
-			{
-				Point office_pos_int = office.GetPosition();
+		//Retired players leave the state from this tick on
+		player_manager_.ReleaseRetired(map);
 
-				double w = std::abs(player_pos.x - office_pos_int.x);
-				double h = std::abs(player_pos.y - office_pos_int.y);
+		unsigned player_count = GetPlayerCount(*map.GetId());
+		int item_count = map.GetItemCount();
 
-				double res = std::sqrt(std::pow(w, 2) + std::pow(h, 2));
+		map.GenerateItems(map.GetLootGenerator().Generate(std::chrono::milliseconds{ milliseconds }, item_count, player_count));
 
-				if (res <= 0.55)
-				{
-					player->Depot();
-					break;
-				}
-			}
-		}
+		PublishMapState(map);
 	}
 
 	void Game::ServerTick(int milliseconds)
 	{
-		loot_gen::LootGenerator* gen_ptr = extra_data_.GetLootGenerator();
+		for (Map& map : maps_)
+		{
+			TickMap(map, milliseconds);
+		}
+	}
 
-		if (gen_ptr != nullptr)
+	std::string Game::SerializeMapState(const Map& map) const
+	{
+		json::object response;
+		json::object player_data;
+
+		for (const Player& player : player_manager_.GetPlayerList(*map.GetId()))
 		{
-			for (Map& map : maps_)
+			json::object entry;
+			Coordinates pos = player.GetPos();
+			json::array pos_arr;
+
+			pos_arr.push_back(pos.x);
+			pos_arr.push_back(pos.y);
+
+			entry.emplace("pos", pos_arr);
+
+			Velocity vel = player.GetVel();
+
+			json::array vel_arr;
+
+			vel_arr.push_back(vel.x);
+			vel_arr.push_back(vel.y);
+
+			entry.emplace("speed", vel_arr);
+			entry.emplace("dir", std::string{ static_cast<char>(player.GetDir()) });
+
+			json::array bag_contents;
+
+			for (const Item& item : player.PeekInTheBag())
 			{
-				MoveAndCalcPickups(map, milliseconds);
+				json::object item_data;
 
-				unsigned player_count = GetPlayerCount(*map.GetId());
-				int item_count = map.GetItemCount();
+				item_data.emplace("id", item.id);
+				item_data.emplace("type", item.type);
 
-				map.GenerateItems(gen_ptr->Generate(std::chrono::milliseconds{ milliseconds }, item_count, player_count), extra_data_);
+				bag_contents.push_back(item_data);
 			}
+
+			entry.emplace("bag", bag_contents);
+
+			entry.emplace("score", player.GetScore());
+
+			player_data.emplace(std::to_string(static_cast<int>(player.GetId())), entry);
+		}
+
+		response.emplace("players", player_data);
+
+		json::object loot_data;
+
+		const util::SlotMap<Item>& items = map.GetItemList();
+
+		for (size_t i = 0; i < items.Size(); ++i)
+		{
+			const Item& obj = items[i];
+
+			json::object item_data;
+
+			item_data.emplace("type", obj.type);
+
+			json::array position;
+
+			position.push_back(obj.pos.x);
+			position.push_back(obj.pos.y);
+
+			item_data.emplace("pos", position);
+
+			loot_data.emplace(std::to_string(i), item_data);
+		}
+
+		response.emplace("lostObjects", loot_data);
+
+		return json::serialize(response);
+	}
+
+	std::string Game::SerializeMapPlayers(const Map& map) const
+	{
+		json::object response;
+
+		for (const Player& player : player_manager_.GetPlayerList(*map.GetId()))
+		{
+			json::object entry;
+
+			entry.emplace("name", player.GetName());
+
+			response.emplace(std::to_string(static_cast<int>(player.GetId())), entry);
+		}
+
+		return json::serialize(response);
+	}
+
+	StateSnapshots::Snapshot Game::MakeMapSnapshot(const Map& map) const
+	{
+		return std::make_shared<const MapSnapshot>(MapSnapshot{
+			std::make_shared<const std::string>(SerializeMapState(map)),
+			std::make_shared<const std::string>(SerializeMapPlayers(map)) });
+	}
+
+	StateSnapshots::Snapshot Game::GetMapState(const Map& map) const
+	{
+		const size_t index = GetMapIndex(map);
+
+		if (StateSnapshots::Snapshot snapshot = state_snapshots_->Get(index))
+		{
+			return snapshot;
+		}
+
+		//The map was empty until now and nothing has been published yet.
+		//The first reader builds it on the strand, the rest will share the result
+		StateSnapshots::Snapshot snapshot = MakeMapSnapshot(map);
+		state_snapshots_->Publish(index, snapshot);
+
+		return snapshot;
+	}
+
+	void Game::PublishMapState(const Map& map)
+	{
+		const size_t index = GetMapIndex(map);
+
+		//Nobody is going to poll an empty map, no need to serialize it every tick
+		if (GetPlayerCount(*map.GetId()) == 0)
+		{
+			state_snapshots_->Invalidate(index);
+			return;
 		}
+
+		state_snapshots_->Publish(index, MakeMapSnapshot(map));
 	}
 
 	void Game::SetLootOnMap(const std::deque<Item>& items, const std::string& map_id)
@@ -162,208 +343,312 @@ namespace model
 
 	//===Dog===
 	Dog::Dog(Coordinates coords, const Map* map)
-		:position_(coords)
-		, speed_(map->GetDogSpeed())
-		, current_map_(map)
+		:current_map_(map)
 	{
-		const std::deque<std::shared_ptr<Road>>& roads = GetRoadsByPos(coords);
-		current_road_ = roads.front().get();
+		std::optional<RoadNetwork::RoadIndex> road = map->GetRoadNetwork().FindRoadAt(GetCell(coords), [](RoadNetwork::RoadIndex) { return true; });
+
+		if (!road)
+		{
+			throw std::out_of_range("No road at the spawn point");
+		}
 
-		Point start = current_road_->GetStart();
-		Point end = roads[0]->GetEnd();
+		slot_ = Store().Add(coords.x, coords.y, map->GetDogSpeed(), static_cast<char>(Direction::NORTH), *road, map->GetRoadBounds(*road));
 	}
 
 
-	Dog::Dog(Coordinates coords, Road* current_road, Velocity vel, double speed, Direction dir, const Map* map)
-	:position_(coords),
-	current_road_(current_road),
-	velocity_(vel),
-	speed_(speed),
-	direction_(dir),
-	current_map_(map){}
+	Dog::Dog(Coordinates coords, const Road* current_road, Velocity vel, double speed, Direction dir, const Map* map)
+		:current_map_(map)
+	{
+		std::uint32_t road = map->GetRoadIndex(*current_road);
+
+		slot_ = Store().Add(coords.x, coords.y, speed, static_cast<char>(dir), road, map->GetRoadBounds(road));
+		Store().SetVel(slot_, vel.x, vel.y);
+	}
 
-	void Dog::MoveVertical(double distance, int iteration)
+	namespace
 	{
-		if (distance == 0 || iteration > 2)
-			return;
+		//Lets Dog::MoveAlong treat both directions the same way
+		struct HorizontalAxis
+		{
+			static bool IsAlong(const Road& road)
+			{
+				return road.IsHorizontal();
+			}
 
-		Point start = current_road_->GetStart();
-		Point end = current_road_->GetEnd();
+			static double Along(Coordinates pos)
+			{
+				return pos.x;
+			}
 
-		double desired_point = position_.y + distance;
+			static double Across(Coordinates pos)
+			{
+				return pos.y;
+			}
 
-		double small_y, big_y;
+			static Coord Along(Point p)
+			{
+				return p.x;
+			}
 
-		if (start.y < end.y)
-		{
-			small_y = start.y;
-			big_y = end.y;
-		}
-		else
-		{
-			small_y = end.y;
-			big_y = start.y;
-		}
+			static Coord Across(Point p)
+			{
+				return p.y;
+			}
+
+			static Point Cell(Coord along, Coord across)
+			{
+				return { along, across };
+			}
 
-		double y1 = small_y - 0.4;
-		double y2 = big_y + 0.4;
+			static double Min(const RoadBounds& bounds)
+			{
+				return bounds.min_x;
+			}
+
+			static double Max(const RoadBounds& bounds)
+			{
+				return bounds.max_x;
+			}
 
-		if (desired_point < y1 || desired_point > y2)
+			static Coordinates Place(double along, double across)
+			{
+				return { along, across };
+			}
+		};
+
+		struct VerticalAxis
 		{
-			for (std::shared_ptr<Road> road : GetRoadsByPos(position_))
+			static bool IsAlong(const Road& road)
 			{
-				if (road != nullptr)
-				{
-					if (road.get() != current_road_ && road.get()->IsVertical())
-					{
-						current_road_ = road.get();
+				return road.IsVertical();
+			}
 
-						MoveVertical(distance, ++iteration);
-						return;
-					}
-				}
+			static double Along(Coordinates pos)
+			{
+				return pos.y;
 			}
 
-			velocity_ = { 0,0 };
-			if (desired_point < y1)
+			static double Across(Coordinates pos)
 			{
-				position_.y = y1;
+				return pos.x;
 			}
-			else
+
+			static Coord Along(Point p)
 			{
-				position_.y = y2;
+				return p.y;
 			}
-			return;
-		}
 
-		position_.y = desired_point;
-		return;
-	}
+			static Coord Across(Point p)
+			{
+				return p.x;
+			}
 
-	void Dog::MoveHorizontal(double distance, int iteration)
-	{
-		if (distance == 0 || iteration > 2)
-			return;
+			static Point Cell(Coord along, Coord across)
+			{
+				return { across, along };
+			}
 
-		Point start = current_road_->GetStart();
-		Point end = current_road_->GetEnd();
+			static double Min(const RoadBounds& bounds)
+			{
+				return bounds.min_y;
+			}
 
-		double desired_point = position_.x + distance;
+			static double Max(const RoadBounds& bounds)
+			{
+				return bounds.max_y;
+			}
 
-		double small_x, big_x;
+			static Coordinates Place(double along, double across)
+			{
+				return { across, along };
+			}
+		};
+	}
 
-		if (start.x < end.x)
-		{
-			small_x = start.x;
-			big_x = end.x;
-		}
-		else
+	template <typename Axis>
+	std::optional<RoadNetwork::RoadIndex> Dog::FindNextRoad(RoadNetwork::RoadIndex road, bool forward, Coord across_cell) const
+	{
+		const Map::Roads& roads = current_map_->GetRoads();
+
+		auto edge_of = [forward](const RoadBounds& bounds)
 		{
-			small_x = end.x;
-			big_x = start.x;
-		}
+			return forward ? Axis::Max(bounds) : Axis::Min(bounds);
+		};
 
-		double x1 = small_x - 0.4;
-		double x2 = big_x + 0.4;
+		const Road& current = roads[road];
+		Coord end = forward ? std::max(Axis::Along(current.GetStart()), Axis::Along(current.GetEnd()))
+			: std::min(Axis::Along(current.GetStart()), Axis::Along(current.GetEnd()));
 
-		if (desired_point < x1 || desired_point > x2)
-		{
-			for (std::shared_ptr<Road> road : GetRoadsByPos(position_))
+		std::optional<RoadNetwork::RoadIndex> next;
+		double next_edge = edge_of(current_map_->GetRoadBounds(road));
+
+		current_map_->GetRoadNetwork().ForEachRoadAt(Axis::Cell(end, across_cell), [&](RoadNetwork::RoadIndex candidate)
 			{
-				if (road != nullptr)
+				if (candidate == road || !Axis::IsAlong(roads[candidate]))
 				{
-					if (road.get() != current_road_ && road.get()->IsHorizontal())
-					{
-						current_road_ = road.get();
+					return;
+				}
+
+				double edge = edge_of(current_map_->GetRoadBounds(candidate));
 
-						MoveHorizontal(distance, ++iteration);
-						return;
-					}
+				if ((forward ? edge > next_edge : edge < next_edge) || (next && edge == next_edge && candidate < *next))
+				{
+					next = candidate;
+					next_edge = edge;
 				}
-			}
+			});
 
-			velocity_ = { 0,0 };
-			if (desired_point < x1)
-			{
-				position_.x = x1;
-			}
-			else
+		return next;
+	}
+
+	template <typename Axis>
+	void Dog::MoveAlong(double distance)
+	{
+		if (distance == 0)
+			return;
+
+		DogStore& store = Store();
+
+		const bool forward = distance > 0;
+
+		Coordinates pos = GetPos();
+		double target = Axis::Along(pos) + distance;
+		double across = Axis::Across(pos);
+		Coord across_cell = Axis::Across(GetCell(pos));
+
+		RoadNetwork::RoadIndex road = store.GetRoad(slot_);
+		RoadBounds bounds = current_map_->GetRoadBounds(road);
+
+		//Every pass crosses one junction at the end of the current road
+		while (forward ? target > Axis::Max(bounds) : target < Axis::Min(bounds))
+		{
+			std::optional<RoadNetwork::RoadIndex> next = FindNextRoad<Axis>(road, forward, across_cell);
+
+			if (!next)
 			{
-				position_.x = x2;
+				store.SetVel(slot_, 0, 0);
+				target = forward ? Axis::Max(bounds) : Axis::Min(bounds);
+				break;
 			}
-			return;
+
+			road = *next;
+			bounds = current_map_->GetRoadBounds(road);
+			SetRoad(road);
 		}
 
-		position_.x = desired_point;
-		return;
+		Coordinates result = Axis::Place(target, across);
+		store.SetPos(slot_, result.x, result.y);
 	}
 
 	void Dog::Move(double ms)
 	{
 		double distance = ms / 1000;
-		bool is_vertical = velocity_.x == 0 && velocity_.y != 0;
-		bool is_horizontal = velocity_.x != 0 && velocity_.y == 0;
+		Velocity velocity = GetVel();
+
+		bool is_vertical = velocity.x == 0 && velocity.y != 0;
+		bool is_horizontal = velocity.x != 0 && velocity.y == 0;
 
 		if (is_vertical)
 		{
-			MoveVertical(distance * velocity_.y, 0);
+			MoveAlong<VerticalAxis>(distance * velocity.y);
 		}
 
 		if (is_horizontal)
 		{
-			MoveHorizontal(distance * velocity_.x, 0);
+			MoveAlong<HorizontalAxis>(distance * velocity.x);
 		}
 	}
 
+	bool Dog::CrossJunction()
+	{
+		Velocity velocity = GetVel();
+		Coordinates pos = GetPos();
+		std::optional<RoadNetwork::RoadIndex> next;
+
+		if (velocity.x == 0 && velocity.y != 0)
+		{
+			next = FindNextRoad<VerticalAxis>(Store().GetRoad(slot_), velocity.y > 0, VerticalAxis::Across(GetCell(pos)));
+		}
+		else if (velocity.x != 0 && velocity.y == 0)
+		{
+			next = FindNextRoad<HorizontalAxis>(Store().GetRoad(slot_), velocity.x > 0, HorizontalAxis::Across(GetCell(pos)));
+		}
+
+		if (!next)
+		{
+			Store().SetVel(slot_, 0, 0);
+			return false;
+		}
+
+		SetRoad(*next);
+		return true;
+	}
+
 	//Players
 
-	std::string Players::MakePlayer(std::string username, const Map* map)
+	void Players::AddMap(const std::string& map_id)
+	{
+		GetMapPlayers(map_id);
+	}
+
+	Player* Players::MakePlayer(std::string username, const Map* map)
 	{
-		Player player{ BirthDog(map), players_.size(), username, map, *this};
-		players_.push_back(std::move(player));
+		return AddPlayer({ BirthDog(map), next_player_id_++, username, map, *this }, std::nullopt, *map->GetId());
+	}
+
+	Player* Players::AddPlayer(Player player, std::optional<Token> token, const std::string& map_id)
+	{
+		MapPlayers& map_players = GetMapPlayers(map_id);
 
-		Player* ptr = &players_.back();
+		//The list belongs to the strand we are on, only the token index is shared
+		util::SlotKey key = map_players.players.Insert(std::move(player));
+		Player* ptr = map_players.players.Find(key);
 
-		std::string token{ std::move(GenerateToken()) };
+		ptr->SetKey(key);
+		map_players.joined.push_back(key);
+
+		if (!token)
+		{
+			token = GenerateToken();
+		}
+
+		std::unique_lock lock{ mutex_ };
 
 		//Protection against impossible odds of two identical tokens generating. What a waste :p
-		while (FindPlayerByToken(token) != nullptr)
+		//Broken or duplicate tokens in a save file get replaced the same way
+		while (!token_to_player_.Insert(*token, ptr->GetRef()))
 		{
 			//You should buy a lottery ticket!
-			token = std::move(GenerateToken());
+			token = GenerateToken();
 		}
 
-		token_to_player_.emplace(token, ptr);
-		map_id_to_players_[*map->GetId()].push_back(ptr);
+		ptr->SetToken(*token);
 
-		return token;
+		return ptr;
 	}
 
-	Player* Players::FindPlayerByIdx(size_t idx)
+	Player* Players::FindPlayer(PlayerRef ref)
 	{
-		if (idx < players_.size())
+		if (ref.map == nullptr)
 		{
-			return &players_[idx];
+			return nullptr;
 		}
 
-		return nullptr;
+		MapPlayers* map_players = FindMapPlayers(*ref.map->GetId());
+
+		return map_players != nullptr ? map_players->players.Find(ref.key) : nullptr;
 	}
-	Player* Players::FindPlayerByToken(std::string token) const
+
+	std::optional<PlayerRef> Players::FindPlayerByToken(Token token) const
 	{
-		std::transform(token.begin(), token.end(), token.begin(), [](unsigned char c)
-			{
-				return std::tolower(c);
-			});
+		std::shared_lock lock{ mutex_ };
 
-		if (token_to_player_.contains(token))
-		{
-			return token_to_player_.at(token);
-		}
+		const PlayerRef* ref = token_to_player_.Find(token);
 
-		return nullptr;
+		return ref != nullptr ? std::optional{ *ref } : std::nullopt;
 	}
 
-	Dog* Players::BirthDog(const Map* map)
+	Dog Players::BirthDog(const Map* map)
 	{
 		//Finding the suitable road for the puppy to be born
 		const std::vector<Road>& roads = map->GetRoads();
@@ -379,91 +664,128 @@ namespace model
 			spot.y = p.y;
 		}
 
-		Dog pup{ spot, map };
-		dogs_.push_back(std::move(pup));
-		return &dogs_.back();
+		return { spot, map };
 	}
 
-	Dog* Players::FindDogByIdx(size_t idx)
+	Players::MapPlayers* Players::FindMapPlayers(const std::string& map_id)
 	{
-		if (idx >= 0 || idx < dogs_.size())
+		std::shared_lock lock{ mutex_ };
+
+		if (auto iter = map_id_to_players_.find(map_id); iter != map_id_to_players_.end())
 		{
-			return &dogs_[idx];
+			return &iter->second;
 		}
 
 		return nullptr;
 	}
 
-	const int Players::GetPlayerCount(std::string map_id) const
+	const Players::MapPlayers* Players::FindMapPlayers(const std::string& map_id) const
 	{
-		if (map_id_to_players_.contains(map_id))
+		std::shared_lock lock{ mutex_ };
+
+		if (auto iter = map_id_to_players_.find(map_id); iter != map_id_to_players_.end())
 		{
-			return map_id_to_players_.at(map_id).size();
+			return &iter->second;
 		}
-		else
+
+		return nullptr;
+	}
+
+	Players::MapPlayers& Players::GetMapPlayers(const std::string& map_id)
+	{
+		if (MapPlayers* map_players = FindMapPlayers(map_id))
 		{
-			return 0;
+			return *map_players;
 		}
+
+		std::unique_lock lock{ mutex_ };
+
+		return map_id_to_players_[map_id];
 	}
 
-	void Players::MoveAllByMap(double ms, std::string& id)
+	const PlayerList& Players::GetPlayerList(const std::string& map_id) const
 	{
-		for (Player* player : map_id_to_players_[id])
+		static const PlayerList no_players;
+
+		const MapPlayers* map_players = FindMapPlayers(map_id);
+
+		return map_players != nullptr ? map_players->players : no_players;
+	}
+
+	PlayerList& Players::GetPlayerList(const std::string& map_id)
+	{
+		return GetMapPlayers(map_id).players;
+	}
+
+	const int Players::GetPlayerCount(std::string map_id) const
+	{
+		const MapPlayers* map_players = FindMapPlayers(map_id);
+
+		return map_players != nullptr ? map_players->players.Size() : 0;
+	}
+
+	void Players::MoveAllByMap(double ms, const Map& map)
+	{
+		//Idle and retired dogs have no velocity, moving them changes nothing
+		for (DogStore::Slot slot : map.GetDogs().AdvanceStraight(ms / 1000))
 		{
-			if (player != nullptr)
-			{
-				player->Move(ms);
-			}
+			Dog{ &map, slot }.Move(ms);
 		}
 	}
 
-	std::deque<Coordinates> Players::GetLooterPositionsByMap(const std::string& id) const
+	Player* Players::InsertPlayer(Player player, std::optional<Token> token, const std::string& map_id)
 	{
-		std::deque<Coordinates> result;
+		//Restored players keep their ids, new ones must not take them
+		size_t next_id = next_player_id_.load();
 
-		if (map_id_to_players_.contains(id))
+		while (next_id <= player.GetId() && !next_player_id_.compare_exchange_weak(next_id, player.GetId() + 1))
 		{
-			for (Player* player : map_id_to_players_.at(id))
-			{
-				if(player != nullptr)
-				{
-					if (player->GetItemCount() < player->GetCurrentMap()->GetBagCapacity())
-					{
-						result.push_back(player->GetPos());
-					}
-				}
-			}
 		}
 
-		return result;
+		return AddPlayer(std::move(player), token, map_id);
 	}
 
-	Dog* Players::InsertDog(const Dog& dog)
+	void Players::RemovePlayer(const Player& pl)
 	{
-		dogs_.push_back(dog);
-		return &dogs_.back();
+		{
+			std::unique_lock lock{ mutex_ };
+
+			token_to_player_.Erase(pl.GetToken());
+		}
+
+		//The player may be in the middle of a walk over the list, it is erased once the tick is over
+		if (MapPlayers* map_players = FindMapPlayers(*pl.GetCurrentMap()->GetId()))
+		{
+			map_players->retired.push_back(pl.GetRef().key);
+		}
 	}
 
-	void Players::InsertPlayer(Player& player, const std::string& token, const std::string& map_id)
+	std::vector<util::SlotKey> Players::TakeJoined(const std::string& map_id)
 	{
-		players_.push_back(std::move(player));
+		MapPlayers* map_players = FindMapPlayers(map_id);
 
-		Player* player_ptr = &players_.back();
+		return map_players != nullptr ? std::exchange(map_players->joined, {}) : std::vector<util::SlotKey>{};
+	}
 
-		token_to_player_.emplace(token, player_ptr);
-		map_id_to_players_[map_id].push_back(player_ptr);
-	}		
-	
-	void Players::RemovePlayer(Player* pl)
+	void Players::ReleaseRetired(const Map& map)
 	{
-		for (auto& entry : token_to_player_)
+		MapPlayers* map_players = FindMapPlayers(*map.GetId());
+
+		if (map_players == nullptr)
 		{
-			if (pl == entry.second)
+			return;
+		}
+
+		for (util::SlotKey key : map_players->retired)
+		{
+			if (const Player* player = map_players->players.Find(key))
 			{
-				token_to_player_.erase(entry.first);
-				break;
+				map.GetDogs().Remove(player->GetDog()->GetSlot());
+				map_players->players.Erase(key);
 			}
 		}
+
+		map_players->retired.clear();
 	}
 
 	//===Player===
@@ -472,16 +794,7 @@ namespace model
 	{
 		bag_.push_back(item);
 
-		json::object logger_data;
-		logger_data.emplace("Player ID", id_);
-		logger_data.emplace("Item ID", item.id);
-		logger_data.emplace("Type", item.type);
-		logger_data.emplace("Value", item.value);
-
-		logger_data.emplace("Total Count", bag_.size());
-
-
-		BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "collected item";
+		async_log::LogCollectedItem(id_, item.id, item.type, item.value, bag_.size());
 	}
 
 	void Player::Depot()
@@ -497,7 +810,7 @@ namespace model
 		{
 			is_removed = true;
 			current_map_->RetireDog(username_, score_, current_age);
-			player_manager_.RemovePlayer(this);
+			player_manager_->RemovePlayer(*this);
 		}
 	}
 	void Player::SetVel(double vel_x, double vel_y)
@@ -507,29 +820,43 @@ namespace model
 			idle_time = 0;
 		}
 
-		pet_->SetVel(vel_x, vel_y);
+		pet_.SetVel(vel_x, vel_y);
 	}
 
 	void Player::Move(int ms)
 	{
-		age_ms_ += ms;
+		if (Age(ms))
+		{
+			pet_.Move(ms);
+		}
+	}
 
-		Velocity vel = pet_->GetVel();
+	bool Player::Age(int ms)
+	{
+		Velocity vel = pet_.GetVel();
+		bool moving = vel.x != 0 || vel.y != 0;
 
-		if (vel.x == 0 && vel.y == 0)
-		{
-			idle_time += ms;
+		AddTime(ms, moving);
 
-			if (idle_time >= current_map_->GetAFK())
-			{
-				age_ms_ -= idle_time - current_map_->GetAFK();
-				Retire(age_ms_);
-			}
-		}
-		else
+		return moving;
+	}
+
+	void Player::AddTime(int ms, bool moving)
+	{
+		age_ms_ += ms;
+
+		if (moving)
 		{
 			idle_time = 0;
-			pet_->Move(ms);
+			return;
+		}
+
+		idle_time += ms;
+
+		if (idle_time >= current_map_->GetAFK())
+		{
+			age_ms_ -= idle_time - current_map_->GetAFK();
+			Retire(age_ms_);
 		}
 	}
 
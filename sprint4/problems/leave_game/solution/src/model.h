@@ -1,40 +1,55 @@
 #pragma once
 
+#include "afk_watch.h"
+#include "kinetic_engine.h"
 #include "model_core.h"
+#include "query_executor.h"
+#include "state_snapshot.h"
+#include "token.h"
+
+#include <atomic>
+#include <shared_mutex>
 
 namespace model
 {
+	//Handle of a dog living in its map's DogStore. Copies refer to the same dog
 	class Dog
 	{
 	public:
 
 		Dog(Coordinates coords, const Map* map);
-		Dog(Coordinates coords, Road* current_road, Velocity vel, double speed, Direction dir, const Map* map);
+		Dog(Coordinates coords, const Road* current_road, Velocity vel, double speed, Direction dir, const Map* map);
+
+		//Wraps a dog which is already in the store
+		Dog(const Map* map, DogStore::Slot slot)
+			:current_map_(map),
+			slot_(slot) {}
 
 		void SetVel(double vel_x, double vel_y)
 		{
-			velocity_.x = speed_ * vel_x;
-			velocity_.y = speed_ * vel_y;
+			double speed = Store().GetSpeed(slot_);
+
+			Store().SetVel(slot_, speed * vel_x, speed * vel_y);
 		}
 
 		void SetDir(Direction dir)
 		{
-			direction_ = dir;
+			Store().SetDir(slot_, static_cast<char>(dir));
 		}
 
 		Coordinates GetPos() const
 		{
-			return position_;
+			return { Store().GetX(slot_), Store().GetY(slot_) };
 		}
 
 		Velocity GetVel() const
 		{
-			return velocity_;
+			return { Store().GetVelX(slot_), Store().GetVelY(slot_) };
 		}
 
 		Direction GetDir() const
 		{
-			return direction_;
+			return static_cast<Direction>(Store().GetDir(slot_));
 		}
 
 		const Map* GetCurrentMap() const
@@ -42,58 +57,83 @@ namespace model
 			return current_map_;
 		}
 
-		Road* GetCurrentRoad() const
+		const Road* GetCurrentRoad() const
 		{
-			return current_road_;
+			return &current_map_->GetRoads()[Store().GetRoad(slot_)];
 		}
 
-		const std::deque<std::shared_ptr<Road>>& GetRoadsByPos(Coordinates pos) const
+		DogStore::Slot GetSlot() const
 		{
-			int pos_x = static_cast<int>(pos.x + 0.5);
-			int pos_y = static_cast<int>(pos.y + 0.5);
-
-			return current_map_->GetRoadsAtPoint({ pos_x, pos_y });
+			return slot_;
 		}
 
-		void MoveVertical(double distance, int iteration); 
-		
-		void MoveHorizontal(double distance, int iteration);
+		//Grid point the position belongs to
+		static Point GetCell(Coordinates pos)
+		{
+			return { static_cast<int>(pos.x + 0.5), static_cast<int>(pos.y + 0.5) };
+		}
 
+		//Scalar path, it also crosses onto the next roads at junctions. Ticks move the dogs of a whole map
+		//with DogStore::AdvanceStraight and only fall back to this for the ones reaching a road end
 		void Move(double ms);
 
+		//For a dog standing at the end of its road: turns it onto the road going on the same way,
+		//or stops it there if there is none. Returns false if the dog stopped
+		bool CrossJunction();
+
 	private:
 
-		Coordinates position_;
-		Road* current_road_;
+		//Walks distance along one axis, road after road, and stops at the end of the last one.
+		//Costs one step per junction crossed, however long the distance is
+		template <typename Axis>
+		void MoveAlong(double distance);
+
+		//Of the roads at the end of the given one that go on in the same direction, the one leading furthest
+		template <typename Axis>
+		std::optional<RoadNetwork::RoadIndex> FindNextRoad(RoadNetwork::RoadIndex road, bool forward, Coord across_cell) const;
 
-		Velocity velocity_{ 0, 0 };
-		double speed_;
+		DogStore& Store() const
+		{
+			return current_map_->GetDogs();
+		}
 
-		Direction direction_ = Direction::NORTH;
+		void SetRoad(std::uint32_t road)
+		{
+			Store().SetRoad(slot_, road, current_map_->GetRoadBounds(road));
+		}
 
 		const Map* current_map_;
+		DogStore::Slot slot_;
 	};
 
 	class Players;
 
+	//Where a player lives: the map and the player's key in its list. Unlike a pointer it can be kept
+	//across ticks and handed between threads, once the player is released it just finds nothing
+	struct PlayerRef
+	{
+		const Map* map = nullptr;
+		util::SlotKey key;
+	};
+
 	class Player
 	{
 	public:
-		Player(Dog* dog, size_t id, std::string username, const Map* maptr, Players& pm)
+		Player(Dog dog, size_t id, std::string username, const Map* maptr, Players& pm)
 			:username_(username),
 			current_map_(maptr),
 			id_(id),
 			pet_(dog),
-			player_manager_(pm){}
+			player_manager_(&pm){}
 
-		Player(Dog* dog, size_t id, std::string username, const Map* maptr, int64_t score, std::deque<Item> items, Players& pm)
+		Player(Dog dog, size_t id, std::string username, const Map* maptr, int64_t score, std::deque<Item> items, Players& pm)
 			:username_(username),
 			current_map_(maptr),
 			bag_(items),
 			id_(id),
 			score_(score),
 			pet_(dog),
-			player_manager_(pm){}
+			player_manager_(&pm){}
 
 		std::string GetName() const
 		{
@@ -112,37 +152,45 @@ namespace model
 
 		Coordinates GetPos() const
 		{
-			if (pet_ == nullptr)
-				return { -1, -1 };
-
-			return pet_->GetPos();
+			return pet_.GetPos();
 		}
 
 		Velocity GetVel() const
 		{
-			if (pet_ == nullptr)
-				return { -1, -1 };
-
-			return pet_->GetVel();
+			return pet_.GetVel();
 		}
 
 		Direction GetDir() const
 		{
-			if (pet_ == nullptr)
-				return Direction::NORTH;
-
-			return pet_->GetDir();
+			return pet_.GetDir();
 		}
 
 		void SetVel(double vel_x, double vel_y);
 
 		void SetDir(Direction dir)
 		{
-			pet_->SetDir(dir);
+			pet_.SetDir(dir);
 		}
 
 		void Move(int ms);
 
+		//Counts the time alive and idle and retires the player after being idle for too long.
+		//Returns false if the dog should not move this tick
+		bool Age(int ms);
+
+		//Same for a stretch of time during which the dog either moved or stood still all along
+		void AddTime(int ms, bool moving);
+
+		int GetIdleTime() const
+		{
+			return idle_time;
+		}
+
+		bool IsRetired() const
+		{
+			return is_removed;
+		}
+
 		void Retire(int64_t current_age);
 
 		void StoreItem(const Item& item);
@@ -164,9 +212,34 @@ namespace model
 			return score_;
 		}
 
-		Dog* GetDog() const
+		Dog* GetDog()
+		{
+			return &pet_;
+		}
+
+		const Dog* GetDog() const
+		{
+			return &pet_;
+		}
+
+		PlayerRef GetRef() const
+		{
+			return { current_map_, key_ };
+		}
+
+		void SetKey(util::SlotKey key)
+		{
+			key_ = key;
+		}
+
+		Token GetToken() const
+		{
+			return token_;
+		}
+
+		void SetToken(Token token)
 		{
-			return pet_;
+			token_ = token;
 		}
 
 	private:
@@ -175,65 +248,93 @@ namespace model
 		const Map* current_map_;
 
 		std::deque<Item> bag_;
-		const size_t id_;
+		size_t id_;
 
 		int64_t score_ = 0;
 
-		Dog* pet_;
+		Dog pet_;
+		Token token_;
+		util::SlotKey key_;
 
 		int idle_time = 0;
 		int64_t age_ms_ = 0;
 
-		Players& player_manager_;
+		Players* player_manager_;
 		bool is_removed = false;
 	};
 
+	//Registry shared by every map. Tokens and the set of maps are guarded by a lock, while the players
+	//of a map are only touched on that map's strand (see GameExecutor). Player pointers are only good
+	//until the next join or release on their map, anything kept longer holds a PlayerRef
 	class Players
 	{
 	public:
 		explicit Players(bool randomize)
 			:randomize_(randomize) {}
 
-		//This function creates a player and returns a token
-		std::string MakePlayer(std::string username, const Map* map);
+		//Creates an empty player list, so joins never have to change the map table itself
+		void AddMap(const std::string& map_id);
 
-		Player* FindPlayerByIdx(size_t idx);
-		Player* FindPlayerByToken(std::string token) const;
+		//This function creates a player with a fresh token
+		Player* MakePlayer(std::string username, const Map* map);
 
-		Dog* BirthDog(const Map* map);
-		Dog* FindDogByIdx(size_t idx);
+		//Has to run on the player's map strand. Returns nullptr once the player is released
+		Player* FindPlayer(PlayerRef ref);
 
-		const std::deque<Player*> GetPlayerList(std::string map_id) const
-		{
-			return map_id_to_players_.at(map_id);
-		}
+		//Safe from any thread
+		std::optional<PlayerRef> FindPlayerByToken(Token token) const;
+
+		Dog BirthDog(const Map* map);
+
+		//The list belongs to the map's strand, callers must be running there
+		const PlayerList& GetPlayerList(const std::string& map_id) const;
+		PlayerList& GetPlayerList(const std::string& map_id);
 
 		const int GetPlayerCount(std::string map_id) const;
 
-		void MoveAllByMap(double ms, std::string& id);
+		//Only walks the dogs, ageing players is up to AfkWatch
+		void MoveAllByMap(double ms, const Map& map);
+
+		//Player without a valid token gets a new one
+		Player* InsertPlayer(Player player, std::optional<Token> token, const std::string& map_id);
 
-		std::deque<Coordinates> GetLooterPositionsByMap(const std::string& id) const;
+		//Drops the token of a retiring player, the player itself stays until ReleaseRetired
+		void RemovePlayer(const Player& pl);
 
-		Dog* InsertDog(const Dog& dog);
+		//Players that joined the map since the last call
+		std::vector<util::SlotKey> TakeJoined(const std::string& map_id);
 
-		void InsertPlayer(Player& pl, const std::string& token, const std::string& map_id);
+		//Erases the players retired on the map since the last call and frees the slots of their dogs.
+		//Runs on the map's strand, outside of any walk over its list
+		void ReleaseRetired(const Map& map);
 
-		const std::unordered_map<std::string, Player*>& GetTokenToPlayerTable() const
+	private:
+		struct MapPlayers
 		{
-			return token_to_player_;
-		}
+			PlayerList players;
+			std::vector<util::SlotKey> joined;
+			std::vector<util::SlotKey> retired;
+		};
 
-		void RemovePlayer(Player* pl);
+		//Returns nullptr for an unknown map
+		MapPlayers* FindMapPlayers(const std::string& map_id);
+		const MapPlayers* FindMapPlayers(const std::string& map_id) const;
 
-	private:
+		//Adds the map if it is not there yet
+		MapPlayers& GetMapPlayers(const std::string& map_id);
+
+		Player* AddPlayer(Player player, std::optional<Token> token, const std::string& map_id);
 
 		bool randomize_;
 
-		std::unordered_map<std::string, Player*> token_to_player_;
-		std::unordered_map<std::string, std::deque<Player*>> map_id_to_players_;
-		std::deque<Player> players_;
-		std::deque<Dog> dogs_;
+		mutable std::shared_mutex mutex_;
 
+		TokenIndex<PlayerRef> token_to_player_;
+
+		//Nodes never move, so a strand keeps its map's players while other maps are added
+		std::unordered_map<std::string, MapPlayers> map_id_to_players_;
+
+		std::atomic<size_t> next_player_id_ = 0;
 	};
 
 	class Game
@@ -252,19 +353,34 @@ namespace model
 			return maps_;
 		}
 
+		Maps& GetMaps() noexcept {
+			return maps_;
+		}
+
 		const Map* FindMap(const Map::Id& id) const noexcept;
 
-		std::string SpawnPlayer(std::string username, const Map* map)
+		size_t GetMapIndex(const Map& map) const
+		{
+			return map_id_to_index_.at(map.GetId());
+		}
+
+		Player* SpawnPlayer(std::string username, const Map* map)
 		{
 			return player_manager_.MakePlayer(username, map);
 		}
 
-		Player* FindPlayerByToken(std::string token) const
+		std::optional<PlayerRef> FindPlayerByToken(Token token) const
 		{
 			return player_manager_.FindPlayerByToken(token);
 		}
 
-		const std::deque<Player*> GetPlayerList(std::string map_id) const
+		//Has to run on the player's map strand
+		Player* FindPlayer(PlayerRef ref)
+		{
+			return player_manager_.FindPlayer(ref);
+		}
+
+		const PlayerList& GetPlayerList(const std::string& map_id) const
 		{
 			return player_manager_.GetPlayerList(map_id);
 		}
@@ -289,13 +405,58 @@ namespace model
 			afk_threshold = threshold * 1000;
 		}
 
+		//Retirements of every map go through the writer from here on. It has to outlive the game
+		void SetRetirementWriter(db::RetirementWriter* writer);
+
+		//Every map adds its retirements to the leaderboard, the records endpoint reads it. It has to outlive the game
+		void SetLeaderboard(db::Leaderboard* leaderboard);
+
+		//nullptr if the records come straight from the database
+		db::Leaderboard* GetLeaderboard() const
+		{
+			return leaderboard_;
+		}
+
+		//Requests hand their queries to the executor instead of waiting for the pool. It has to outlive the game
+		void SetQueryExecutor(db::QueryExecutor* query_executor)
+		{
+			query_executor_ = query_executor;
+		}
+
+		//nullptr if queries run on the thread that needs them
+		db::QueryExecutor* GetQueryExecutor() const
+		{
+			return query_executor_;
+		}
+
+		//Every map gets its own seed derived from this one, so loot and spawn spots can be replayed
+		void SetRandomSeed(std::uint64_t seed);
+
+		//Maps run on KineticEngine instead of moving every dog each tick
+		void SetKineticMode(bool kinetic);
+
+		bool IsKinetic() const
+		{
+			return kinetic_;
+		}
+
 		void MoveAndCalcPickups(Map& map, int ms);
 
+		//Moves players, collects loot and spawns new items on a single map
+		void TickMap(Map& map, int milliseconds);
+
+		//Ticks every map on the calling thread. The server ticks them on their strands instead
 		void ServerTick(int milliseconds);
 
 		void SetExtraData(Data::MapExtras extras)
 		{
 			extra_data_ = extras;
+
+			for (Map& map : maps_)
+			{
+				map.SetLootGenerator(*extra_data_.GetLootGenerator());
+				map.SetLootTable(extra_data_.GetCompiledTable(*map.GetId()));
+			}
 		}
 
 		boost::json::object GetLootConfig() const
@@ -303,7 +464,7 @@ namespace model
 			return extra_data_.GetConfig();
 		}
 
-		boost::json::array GetLootTable(const std::string& id) const
+		const boost::json::array& GetLootTable(const std::string& id) const
 		{
 			return extra_data_.GetTable(id);
 		}
@@ -316,6 +477,11 @@ namespace model
 		void AddTable(const std::string& id, boost::json::array& table)
 		{
 			extra_data_.AddTable(id, table);
+
+			if (auto iter = map_id_to_index_.find(Map::Id{ id }); iter != map_id_to_index_.end())
+			{
+				maps_[iter->second].SetLootTable(extra_data_.GetCompiledTable(id));
+			}
 		}
 
 		db::ConnectionPool& GetPool()
@@ -325,8 +491,34 @@ namespace model
 
 		void SetLootOnMap(const std::deque<Item>& items, const std::string& map_id);
 
+		//Builds the /game/state JSON body for the given map
+		std::string SerializeMapState(const Map& map) const;
+
+		//Builds the /game/players JSON body for the given map
+		std::string SerializeMapPlayers(const Map& map) const;
+
+		//Returns the published snapshot, building it if the map had none. Has to run on the map's strand
+		StateSnapshots::Snapshot GetMapState(const Map& map) const;
+
+		//Returns nullptr if the snapshot has to be rebuilt. Safe to call from any thread, never blocks
+		StateSnapshots::Snapshot FindMapState(const Map& map) const
+		{
+			return state_snapshots_->Get(GetMapIndex(map));
+		}
+
+		//Has to run on the map's strand. See StateSnapshots::MarkChanged
+		bool MarkMapStateChanged(const Map& map)
+		{
+			return state_snapshots_->MarkChanged(GetMapIndex(map));
+		}
+
+		//Rebuilds the snapshot and publishes it. Has to run on the map's strand
+		void PublishMapState(const Map& map);
+
 	private:
 
+		StateSnapshots::Snapshot MakeMapSnapshot(const Map& map) const;
+
 		double global_dog_speed_ = 1;
 		int global_bag_capacity = 3;
 		double afk_threshold = 60000.0;
@@ -342,6 +534,20 @@ namespace model
 		Players& player_manager_;
 		Data::MapExtras extra_data_;
 
+		//Heap allocated so Game stays movable
+		std::unique_ptr<StateSnapshots> state_snapshots_ = std::make_unique<StateSnapshots>();
+
+		std::optional<std::uint64_t> random_seed_;
+		db::RetirementWriter* retirement_writer_ = nullptr;
+		db::Leaderboard* leaderboard_ = nullptr;
+		db::QueryExecutor* query_executor_ = nullptr;
+
+		bool kinetic_ = false;
+		std::vector<KineticEngine> kinetic_engines_;
+
+		//Ticked maps retire idle players through these
+		std::vector<AfkWatch> afk_watches_;
+
 		int save_period_ = -1;
 		std::string save_file_ = "";
 	};
@@ -1,35 +1,132 @@
 ﻿#include "model_core.h"
 
-int GetRandomNumber(int range)
+#include <tuple>
+
+namespace model
 {
-	std::srand(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
+	using namespace std::literals;
 
-	return rand() % range;
-}
+	//===RoadNetwork===
+	namespace
+	{
+		struct Segment
+		{
+			Coord line;
+			Coord from;
+			Coord to;
+			RoadNetwork::RoadIndex road;
+		};
 
-std::string GenerateToken()
-{
+		bool PointLess(Point lhs, Point rhs)
+		{
+			return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+		}
 
-	const char hexChar[] =
+		template <typename T>
+		size_t VectorMemory(const std::vector<T>& vec)
+		{
+			return vec.capacity() * sizeof(T);
+		}
+	}
+
+	RoadNetwork::RoadNetwork(const std::vector<Road>& roads)
 	{
-		'0', '1', '2', '3', '4',
-		'5', '6', '7', '8', '9',
-		'a','b','c','d','e','f'
-	};
+		std::vector<Segment> horizontal;
+		std::vector<Segment> vertical;
+
+		for (size_t i = 0; i < roads.size(); ++i)
+		{
+			Point start = roads[i].GetStart();
+			Point end = roads[i].GetEnd();
+			RoadIndex index = static_cast<RoadIndex>(i);
+
+			if (roads[i].IsHorizontal())
+			{
+				horizontal.push_back({ start.y, std::min(start.x, end.x), std::max(start.x, end.x), index });
+			}
+			else
+			{
+				vertical.push_back({ start.x, std::min(start.y, end.y), std::max(start.y, end.y), index });
+			}
+
+			junctions_.push_back(start);
+			junctions_.push_back(end);
+		}
+
+		for (auto [segments, lines] : { std::pair{ &horizontal, &horizontal_ }, std::pair{ &vertical, &vertical_ } })
+		{
+			std::sort(segments->begin(), segments->end(), [](const Segment& lhs, const Segment& rhs)
+				{
+					return std::tie(lhs.line, lhs.from, lhs.road) < std::tie(rhs.line, rhs.from, rhs.road);
+				});
+
+			for (size_t i = 0; i < segments->size(); ++i)
+			{
+				const Segment& segment = (*segments)[i];
+				bool new_line = i == 0 || (*segments)[i - 1].line != segment.line;
+
+				if (new_line && i != 0)
+				{
+					lines->line_offsets.push_back(static_cast<std::uint32_t>(i));
+				}
+
+				if (new_line)
+				{
+					lines->line_coords.push_back(segment.line);
+				}
+
+				lines->from.push_back(segment.from);
+				lines->to.push_back(segment.to);
+				lines->reach.push_back(new_line ? segment.to : std::max(lines->reach.back(), segment.to));
+				lines->roads.push_back(segment.road);
+			}
+
+			if (!segments->empty())
+			{
+				lines->line_offsets.push_back(static_cast<std::uint32_t>(segments->size()));
+			}
+		}
+
+		std::sort(junctions_.begin(), junctions_.end(), PointLess);
+		junctions_.erase(std::unique(junctions_.begin(), junctions_.end()), junctions_.end());
 
-	std::string token;
+		//Every road through a junction, including the ones just passing by
+		for (Point junction : junctions_)
+		{
+			size_t first = junction_roads_.size();
+			auto add = [this](RoadIndex road) { junction_roads_.push_back(road); };
+
+			horizontal_.ForEachAt(junction.y, junction.x, add);
+			vertical_.ForEachAt(junction.x, junction.y, add);
+
+			std::sort(junction_roads_.begin() + first, junction_roads_.end());
+			junction_offsets_.push_back(static_cast<std::uint32_t>(junction_roads_.size()));
+		}
+	}
 
-	for (int i = 0; i < 32; i++)
+	std::optional<std::span<const RoadNetwork::RoadIndex>> RoadNetwork::FindJunction(Point p) const
 	{
-		token += hexChar[GetRandomNumber(16)];
+		auto iter = std::lower_bound(junctions_.begin(), junctions_.end(), p, PointLess);
+
+		if (iter == junctions_.end() || !(*iter == p))
+		{
+			return std::nullopt;
+		}
+
+		size_t index = iter - junctions_.begin();
+
+		return std::span<const RoadIndex>{ junction_roads_.data() + junction_offsets_[index], junction_roads_.data() + junction_offsets_[index + 1] };
 	}
 
-	return token;
-}
+	size_t RoadNetwork::Lines::GetMemoryUsage() const
+	{
+		return VectorMemory(line_coords) + VectorMemory(line_offsets) + VectorMemory(from) + VectorMemory(to) + VectorMemory(reach) + VectorMemory(roads);
+	}
 
-namespace model
-{
-	using namespace std::literals;
+	size_t RoadNetwork::GetMemoryUsage() const
+	{
+		return horizontal_.GetMemoryUsage() + vertical_.GetMemoryUsage() + VectorMemory(junctions_) + VectorMemory(junction_offsets_) + VectorMemory(junction_roads_);
+	}
 
 	//===Map===	
 	void Map::AddOffice(Office office)
@@ -50,130 +147,94 @@ namespace model
 			offices_.pop_back();
 			throw;
 		}
+
+		//Together with the dog's own width this makes the depot radius
+		constexpr double OFFICE_WIDTH = 0.25;
+
+		Point position = o.GetPosition();
+		office_index_.Add({ { static_cast<double>(position.x), static_cast<double>(position.y) }, OFFICE_WIDTH });
 	}
 	void Map::CalcRoads()
 	{
-		for (Road& road : roads_)
+		road_network_ = RoadNetwork{ roads_ };
+
+		road_cells_.clear();
+
+		std::int64_t cells = 0;
+
+		for (const Road& road : roads_)
 		{
 			Point start = road.GetStart();
 			Point end = road.GetEnd();
 
-			int small, big;
-
-			if (road.IsHorizontal())
-			{
-				int x1 = start.x, x2 = end.x;
-
-				if (x1 > x2)
-				{
-					small = x2;
-					big = x1;
-				}
-				else
-				{
-					big = x2;
-					small = x1;
-				}
+			cells += std::abs(end.x - start.x) + std::abs(end.y - start.y);
+			road_cells_.push_back(cells);
+		}
+	}
 
-				for (int i = small; i <= big; ++i)
-				{
-					point_to_roads_[{i, start.y}].push_back(std::make_shared<Road>(road));
-				}
+	void Map::GenerateItems(unsigned int amount)
+	{
+		if (loot_table_.types.Empty())
+		{
+			return;
+		}
 
-			}
-			else
-			{
-				int y1 = start.y, y2 = end.y;
+		for (unsigned int i = 0; i < amount; ++i)
+		{
+			int id = next_item_id_++;
+			int item_type_id = static_cast<int>(loot_table_.types.Sample(random_));
+			Coordinates pos = GetRandomSpot();
+			int64_t value = loot_table_.values[item_type_id];
 
-				if (y1 > y2)
-				{
-					small = y2;
-					big = y1;
-				}
-				else
-				{
-					big = y2;
-					small = y1;
-				}
+			const Item& item = *items_.Find(items_.Emplace(pos, id, item_type_id, value));
+			item_index_.Add({ { pos.x, pos.y }, item.width });
 
-				for (int i = small; i <= big; ++i)
-				{
-					point_to_roads_[{start.x, i}].push_back(std::make_shared<Road>(road));
-				}
-			}
+			async_log::LogGeneratedItem(id, item_type_id, value, pos.x, pos.y);
 		}
 	}
 
-	void Map::GenerateItems(unsigned int amount, const Data::MapExtras& extras)
+	void Map::SetItems(const std::deque<Item>& items)
 	{
-		json::array loot_table_ = extras.GetTable(*id_);
+		items_.Clear();
+		item_index_.Clear();
 
-		size_t s = items_.size();
-
-		for (int i = 0; i < amount; ++i)
+		for (const Item& item : items)
 		{
-			int id = s + i;
-			int item_type_id = GetRandomNumber(loot_table_.size());
-			Coordinates pos = GetRandomSpot();
-			int64_t value = loot_table_[item_type_id].as_object().at("value").as_int64();
-
-			items_.push_back({ pos, id, item_type_id, value });
-
-			json::object logger_data;
-			logger_data.emplace("ID", id);
-			logger_data.emplace("Type", item_type_id);
-			logger_data.emplace("Value", value);
-			logger_data.emplace("Position X", pos.x);
-			logger_data.emplace("Position Y", pos.y);
+			items_.Insert(item);
+			item_index_.Add({ { item.pos.x, item.pos.y }, item.width });
 
-			BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "generated item";
+			next_item_id_ = std::max(next_item_id_, item.id + 1);
 		}
 	}
 
 	Coordinates Map::GetRandomSpot() const
 	{
-		//Getting a random road
 		const std::vector<Road>& roads = GetRoads();
-		const Road& road = roads.at(GetRandomNumber(roads.size()));
 
-		//Now we find the precise spot on that road
-		Coordinates spot;
+		//A map of nothing but single points, any of them will do
+		if (road_cells_.empty() || road_cells_.back() == 0)
+		{
+			Point start = roads.at(random_.Below(roads.size())).GetStart();
+
+			return { static_cast<double>(start.x), static_cast<double>(start.y) };
+		}
+
+		//One draw picks both the road and the spot on it: roads take up stretches of cells by their length
+		std::int64_t cell = static_cast<std::int64_t>(random_.Below(road_cells_.back()));
+		size_t index = std::upper_bound(road_cells_.begin(), road_cells_.end(), cell) - road_cells_.begin();
+
+		const Road& road = roads[index];
+		std::int64_t offset = cell - (index > 0 ? road_cells_[index - 1] : 0);
 
 		Point start = road.GetStart();
 		Point end = road.GetEnd();
 
 		if (road.IsVertical())
 		{
-			spot.x = start.x;
-
-			int offset = GetRandomNumber(std::abs(start.y - end.y));
-
-			if (start.y < end.y)
-			{
-				spot.y = start.y + offset;
-			}
-			else
-			{
-				spot.y = end.y + offset;
-			}
+			return { static_cast<double>(start.x), static_cast<double>(std::min(start.y, end.y) + offset) };
 		}
-		else
-		{
-			spot.y = start.y;
-
-			int offset = GetRandomNumber(std::abs(start.x - end.x));
 
-			if (start.x < end.x)
-			{
-				spot.x = start.x + offset;
-			}
-			else
-			{
-				spot.x = end.x + offset;
-			}
-		}
-
-		return spot;
+		return { static_cast<double>(std::min(start.x, end.x) + offset), static_cast<double>(start.y) };
 	}
 
 	bool operator==(const Road& r1, const Road& r2)
@@ -183,13 +244,42 @@ namespace model
 
 	const Road& Map::FindRoad(Point start, Point end) const
 	{
-		auto iter = std::find(roads_.begin(), roads_.end(), start.x == end.x ? Road(Road::VERTICAL, start, end.y) : Road(Road::HORIZONTAL, start, end.x));
+		std::optional<RoadNetwork::RoadIndex> index = road_network_.FindRoadAt(start, [this, start, end](RoadNetwork::RoadIndex road)
+			{
+				return roads_[road].GetStart() == start && roads_[road].GetEnd() == end;
+			});
+
+		if (!index)
+		{
+			throw std::invalid_argument("No such road on map "s + *id_);
+		}
 
-		return *iter;
+		return roads_[*index];
+	}
+
+	RoadBounds Map::GetRoadBounds(std::uint32_t index) const
+	{
+		Point start = roads_[index].GetStart();
+		Point end = roads_[index].GetEnd();
+
+		return {
+			std::min(start.x, end.x) - 0.4, std::max(start.x, end.x) + 0.4,
+			std::min(start.y, end.y) - 0.4, std::max(start.y, end.y) + 0.4 };
 	}
 
 	void Map::RetireDog(const std::string& username, int64_t score, int64_t time_alive) const
 	{
+		if (leaderboard_ != nullptr)
+		{
+			leaderboard_->Add({ username, score, time_alive });
+		}
+
+		if (retirement_writer_ != nullptr)
+		{
+			retirement_writer_->Push({ username, score, time_alive });
+			return;
+		}
+
 		db::ConnectionPool::ConnectionWrapper wrap = connection_pool_.GetConnection();
 
 		pqxx::work work{ *wrap };
@@ -10,12 +10,18 @@
 #include <memory>
 #include <algorithm>
 #include <optional>
+#include <span>
 #include <boost/signals2.hpp>
 #include <stdexcept>
 
 #include "collision_detector.h"
+#include "dog_store.h"
 #include "loot_generator.h"
 #include "extra_data.h"
+#include "leaderboard.h"
+#include "random.h"
+#include "retirement_writer.h"
+#include "slot_map.h"
 #include "tagged_uuid.h"
 #include "DB_manager.h"
 
@@ -38,10 +44,6 @@ const std::string Y1_COORDINATE = "y1";
 const std::string WIDTH = "w";
 const std::string HEIGHT = "h";
 
-int GetRandomNumber(int range);
-
-std::string GenerateToken();
-
 namespace model
 {
 
@@ -58,16 +60,6 @@ namespace model
 		}
 	};
 
-	struct PointHasher
-	{
-		std::size_t operator()(const Point& p) const
-		{
-			using std::size_t;
-
-			return p.x + p.y * p.y;
-		}
-	};
-
 	struct Size {
 		Dimension width, height;
 	};
@@ -128,6 +120,131 @@ namespace model
 		Point end_;
 	};
 
+	//Roads of a map indexed for lookups by position. Memory and build time depend on the number of roads,
+	//not on their length, so a map may have kilometres of them
+	class RoadNetwork
+	{
+	public:
+		using RoadIndex = std::uint32_t;
+
+		RoadNetwork() = default;
+		explicit RoadNetwork(const std::vector<Road>& roads);
+
+		//Calls fn(index) for every road passing through the point, in no particular order
+		template <typename Fn>
+		void ForEachRoadAt(Point p, Fn&& fn) const
+		{
+			if (auto junction = FindJunction(p))
+			{
+				for (RoadIndex road : *junction)
+				{
+					fn(road);
+				}
+
+				return;
+			}
+
+			horizontal_.ForEachAt(p.y, p.x, fn);
+			vertical_.ForEachAt(p.x, p.y, fn);
+		}
+
+		//Lowest index road passing through the point for which pred(index) is true
+		template <typename Pred>
+		std::optional<RoadIndex> FindRoadAt(Point p, Pred&& pred) const
+		{
+			//Dogs mostly turn where roads end, those points have their road lists ready
+			if (auto junction = FindJunction(p))
+			{
+				for (RoadIndex road : *junction)
+				{
+					if (pred(road))
+					{
+						return road;
+					}
+				}
+
+				return std::nullopt;
+			}
+
+			std::optional<RoadIndex> result;
+
+			auto visit = [&result, &pred](RoadIndex road)
+			{
+				if ((!result || road < *result) && pred(road))
+				{
+					result = road;
+				}
+			};
+
+			horizontal_.ForEachAt(p.y, p.x, visit);
+			vertical_.ForEachAt(p.x, p.y, visit);
+
+			return result;
+		}
+
+		//Roads starting or ending at the point, sorted by index. Empty if no road ends there
+		std::span<const RoadIndex> GetJunction(Point p) const
+		{
+			return FindJunction(p).value_or(std::span<const RoadIndex>{});
+		}
+
+		std::size_t GetMemoryUsage() const;
+
+	private:
+		//Roads lying on the same line: horizontal ones share y, vertical ones share x.
+		//Lines are sorted by their coordinate, roads of a line by the coordinate they start at
+		struct Lines
+		{
+			std::vector<Coord> line_coords;
+			std::vector<std::uint32_t> line_offsets{ 0 };
+
+			std::vector<Coord> from;
+			std::vector<Coord> to;
+
+			//Furthest end among the roads of the line up to this one
+			std::vector<Coord> reach;
+			std::vector<RoadIndex> roads;
+
+			template <typename Fn>
+			void ForEachAt(Coord line, Coord pos, Fn&& fn) const
+			{
+				auto line_iter = std::lower_bound(line_coords.begin(), line_coords.end(), line);
+
+				if (line_iter == line_coords.end() || *line_iter != line)
+				{
+					return;
+				}
+
+				size_t index = line_iter - line_coords.begin();
+
+				auto first = from.begin() + line_offsets[index];
+				auto last = from.begin() + line_offsets[index + 1];
+
+				//Roads starting after pos can't cover it, the ones before it are walked back
+				//until none of them reaches pos anymore
+				for (size_t i = std::upper_bound(first, last, pos) - from.begin(); i > line_offsets[index] && reach[i - 1] >= pos; --i)
+				{
+					if (to[i - 1] >= pos)
+					{
+						fn(roads[i - 1]);
+					}
+				}
+			}
+
+			size_t GetMemoryUsage() const;
+		};
+
+		std::optional<std::span<const RoadIndex>> FindJunction(Point p) const;
+
+		Lines horizontal_;
+		Lines vertical_;
+
+		//Junctions in CSR form: roads of junction i are junction_roads_[junction_offsets_[i]..junction_offsets_[i + 1])
+		std::vector<Point> junctions_;
+		std::vector<std::uint32_t> junction_offsets_{ 0 };
+		std::vector<RoadIndex> junction_roads_;
+	};
+
 	class Building {
 	public:
 		explicit Building(Rectangle bounds) noexcept
@@ -244,8 +361,17 @@ namespace model
 			roads_.emplace_back(road);
 		}
 
+		//Throws std::invalid_argument if there is no such road
 		const Road& FindRoad(Point start, Point end) const;
 
+		//Position of the road in GetRoads(), the road has to be taken from GetRoads()
+		std::uint32_t GetRoadIndex(const Road& road) const
+		{
+			return static_cast<std::uint32_t>(&road - roads_.data());
+		}
+
+		RoadBounds GetRoadBounds(std::uint32_t index) const;
+
 		void AddBuilding(const Building& building) {
 			buildings_.emplace_back(building);
 		}
@@ -270,33 +396,40 @@ namespace model
 			return afk_threshold_;
 		}
 
+		//Whole point of a road, every unit of road length equally likely
 		Coordinates GetRandomSpot() const;
 
+		//Loot spawned and spots picked from here on follow from the seed alone
+		void SeedRandom(std::uint64_t seed)
+		{
+			random_.Seed(seed);
+		}
+
 		double GetDogSpeed() const
 		{
 			return dog_speed_;
 		}
 
+		//Has to be called once all roads are added
 		void CalcRoads();
 
-		const std::deque<std::shared_ptr<Road>>& GetRoadsAtPoint(Point p) const
+		const RoadNetwork& GetRoadNetwork() const
 		{
-			return point_to_roads_.at(p);
+			return road_network_;
 		}
 
-		void GenerateItems(unsigned int amount, const Data::MapExtras& extras);
+		//Does nothing on a map without loot types
+		void GenerateItems(unsigned int amount);
 
-		void SetItems(const std::deque<Item>& items)
-		{
-			items_ = items;
-		}
+		void SetItems(const std::deque<Item>& items);
 
 		int GetItemCount() const
 		{
-			return items_.size();
+			return items_.Size();
 		}
 
-		const std::deque<Item>& GetItemList() const
+		//Items by position. Removing one moves the last item into its place
+		const util::SlotMap<Item>& GetItemList() const
 		{
 			return items_;
 		}
@@ -306,9 +439,16 @@ namespace model
 			return items_[idx];
 		}
 
-		void RemoveItem(int id)
+		void RemoveItem(int idx)
 		{
-			items_.erase(items_.begin() + id);
+			items_.EraseAt(idx);
+			item_index_.Remove(idx);
+		}
+
+		//Same items as GetItemList, under the same positions, bucketed for collision checks
+		const collision_detector::ItemIndex& GetItemIndex() const
+		{
+			return item_index_;
 		}
 
 		int GetBagCapacity() const
@@ -318,8 +458,49 @@ namespace model
 
 		void AddOffice(Office office);
 
+		//Offices under the indices of GetOffices, as static targets for the same collision pass as the items
+		const collision_detector::ItemIndex& GetOfficeIndex() const
+		{
+			return office_index_;
+		}
+
+		//Every map keeps its own copy, so maps can be ticked in parallel
+		void SetLootGenerator(const loot_gen::LootGenerator& generator)
+		{
+			loot_generator_ = generator;
+		}
+
+		loot_gen::LootGenerator& GetLootGenerator()
+		{
+			return loot_generator_;
+		}
+
+		void SetLootTable(Data::LootTable table)
+		{
+			loot_table_ = std::move(table);
+		}
+
+		//Hands the record to the writer if the map has one, writes it on the spot otherwise.
+		//The leaderboard learns about it either way
 		void RetireDog(const std::string& username, int64_t score, int64_t time_alive) const;
 
+		void SetRetirementWriter(db::RetirementWriter* writer)
+		{
+			retirement_writer_ = writer;
+		}
+
+		void SetLeaderboard(db::Leaderboard* leaderboard)
+		{
+			leaderboard_ = leaderboard;
+		}
+
+		//Dogs are game state rather than map geometry, so they stay writable through a const Map.
+		//Only the map's strand touches them
+		DogStore& GetDogs() const
+		{
+			return dogs_;
+		}
+
 	private:
 		using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
 
@@ -328,19 +509,37 @@ namespace model
 		Roads roads_;
 		Buildings buildings_;
 
-		std::unordered_map<Point, std::deque<std::shared_ptr<Road>>, PointHasher> point_to_roads_;
+		RoadNetwork road_network_;
+
+		//Road lengths summed up to and including every road, for picking spots by length
+		std::vector<std::int64_t> road_cells_;
 
-		std::deque<Item> items_;
+		util::SlotMap<Item> items_;
+		collision_detector::ItemIndex item_index_;
+
+		//Item ids are never handed out twice on a map
+		int next_item_id_ = 0;
 
 		double dog_speed_ = 1;
 		int bag_capacity_ = 3;
 
 		OfficeIdToIndex warehouse_id_to_index_;
 		Offices offices_;
+		collision_detector::ItemIndex office_index_;
 		std::deque<Coordinates> buffer_;
 		double afk_threshold_ = 60000.0;
 
+		loot_gen::LootGenerator loot_generator_{ std::chrono::milliseconds{5}, 1 };
+		Data::LootTable loot_table_;
+
+		//Picking spots is no change to the map, so it works on a const Map too. Only the map's strand draws
+		mutable util::Xoshiro256 random_;
+
+		mutable DogStore dogs_;
+
 		db::ConnectionPool& connection_pool_;
+		db::RetirementWriter* retirement_writer_ = nullptr;
+		db::Leaderboard* leaderboard_ = nullptr;
 	};
 
 } //~namespace model
\ No newline at end of file
@@ -63,20 +63,9 @@ namespace serialization
 		{
 			const model::Map* the_map = game.FindMap(current_map_id_);
 
-			model::Road* the_road;
-			// :(
-			for (auto& road : the_map->GetRoadsAtPoint(road_start_))
-			{
-				model::Road* tmp = road.get();
-
-				if (tmp->GetStart() == road_start_ && tmp->GetEnd() == road_end_)
-				{
-					the_road = tmp;
-					break;
-				}
-			}
-
-			model::Dog dog{ position_, the_road, velocity_, speed_, direction_, the_map };
+			const model::Road& the_road = the_map->FindRoad(road_start_, road_end_);
+
+			model::Dog dog{ position_, &the_road, velocity_, speed_, direction_, the_map };
 			return dog;
 		}
 
@@ -98,7 +87,7 @@ namespace serialization
 		const model::Map* current_map_ = nullptr;
 		model::Map::Id current_map_id_ = model::Map::Id("id");
 
-		model::Road* current_road_ = nullptr;
+		const model::Road* current_road_ = nullptr;
 		model::Point road_start_ = { -1, -1 };
 		model::Point road_end_ = { -1, -1 };
 
@@ -121,7 +110,7 @@ namespace serialization
 			bag_(player.PeekInTheBag()),
 			score(player.GetScore()){}
 
-		[[nodiscard]] model::Player Restore(model::Game& game, model::Dog* lost_pup, model::Players& pm) const
+		[[nodiscard]] model::Player Restore(model::Game& game, model::Dog lost_pup, model::Players& pm) const
 		{
 			const model::Map* the_map = game.FindMap(current_map_id_);
 
@@ -142,7 +131,7 @@ namespace serialization
 
 	private:
 
-		model::Dog* pet_ = nullptr;		
+		const model::Dog* pet_ = nullptr;		
 
 		size_t id_ = -1;
 		std::string username_ = "";
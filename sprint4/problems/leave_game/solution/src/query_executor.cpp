@@ -0,0 +1,12 @@
+#include "query_executor.h"
+
+#include <string>
+
+namespace db
+{
+	void ApplyStatementTimeout(pqxx::connection& connection, std::chrono::milliseconds timeout)
+	{
+		pqxx::nontransaction session{ connection };
+		session.exec("SET statement_timeout = " + std::to_string(timeout.count()));
+	}
+}
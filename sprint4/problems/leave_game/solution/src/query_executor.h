@@ -0,0 +1,364 @@
+#pragma once
+
+#include "DB_manager.h"
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace db
+{
+	namespace net = boost::asio;
+
+	//The query waited for a thread and a connection longer than its timeout and never ran
+	class QueryTimeout : public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	struct QueryMetrics
+	{
+		std::uint64_t submitted = 0;
+		std::uint64_t completed = 0;
+		std::uint64_t failed = 0;
+		std::uint64_t timed_out = 0;
+
+		//Queries waiting for a thread right now, and the most there ever were
+		std::size_t queue_depth = 0;
+		std::size_t max_queue_depth = 0;
+
+		//From submission until the query had a connection
+		std::chrono::microseconds total_wait{ 0 };
+		std::chrono::microseconds max_wait{ 0 };
+	};
+
+	//Sets statement_timeout of the session, so the server cancels a query that runs too long
+	void ApplyStatementTimeout(pqxx::connection& connection, std::chrono::milliseconds timeout);
+
+	//Completion of a query returning Result
+	template <typename Result>
+	struct QuerySignature
+	{
+		using type = void(std::exception_ptr, Result);
+	};
+
+	template <>
+	struct QuerySignature<void>
+	{
+		using type = void(std::exception_ptr);
+	};
+
+	//Runs queries on threads of its own, they are the only ones to wait for the pool. A query is a
+	//callable taking a connection, the completion gets (std::exception_ptr, result) on the executor
+	//associated with it, the fallback one if there is none. Any asio completion token works, so
+	//callbacks, use_awaitable and use_future alike. A query that waited longer than its timeout
+	//fails with QueryTimeout, one that runs longer is cancelled by the server
+	template <typename Pool>
+	class BasicQueryExecutor
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+		using Lease = decltype(std::declval<Pool&>().GetConnection());
+		using Connection = std::remove_reference_t<decltype(*std::declval<Lease&>())>;
+
+		static constexpr std::chrono::milliseconds DEFAULT_TIMEOUT{ 5000 };
+
+		BasicQueryExecutor(Pool& pool, std::size_t threads, net::any_io_executor fallback)
+			:pool_(pool),
+			fallback_(std::move(fallback))
+		{
+			threads = std::max<std::size_t>(threads, 1);
+			workers_.reserve(threads);
+
+			for (std::size_t i = 0; i < threads; ++i)
+			{
+				workers_.emplace_back([this]
+					{
+						Run(stop_.get_token());
+					});
+			}
+		}
+
+		~BasicQueryExecutor()
+		{
+			Stop();
+		}
+
+		BasicQueryExecutor(const BasicQueryExecutor&) = delete;
+		BasicQueryExecutor& operator=(const BasicQueryExecutor&) = delete;
+
+		//Runs what is queued and joins the threads. Queries submitted afterwards fail at once
+		void Stop()
+		{
+			{
+				//Nothing gets queued once the threads may have left
+				std::lock_guard lock{ mutex_ };
+				stop_.request_stop();
+			}
+
+			workers_.clear();
+		}
+
+		template <typename Query, typename CompletionToken>
+		auto AsyncExecute(std::chrono::milliseconds timeout, Query query, CompletionToken&& token)
+		{
+			using Result = std::invoke_result_t<Query&, Connection&>;
+			return net::async_initiate<CompletionToken, typename QuerySignature<Result>::type>([this, timeout](auto handler, Query query)
+				{
+					using Handler = std::decay_t<decltype(handler)>;
+
+					Submit(std::make_unique<Job<Query, Handler>>(timeout, std::move(query), std::move(handler), fallback_));
+				},
+				token, std::move(query));
+		}
+
+		template <typename Query, typename CompletionToken>
+		auto AsyncExecute(Query query, CompletionToken&& token)
+		{
+			return AsyncExecute(DEFAULT_TIMEOUT, std::move(query), std::forward<CompletionToken>(token));
+		}
+
+		QueryMetrics GetMetrics() const
+		{
+			QueryMetrics metrics;
+
+			metrics.submitted = submitted_.load();
+			metrics.completed = completed_.load();
+			metrics.failed = failed_.load();
+			metrics.timed_out = timed_out_.load();
+			metrics.total_wait = std::chrono::microseconds{ total_wait_us_.load() };
+			metrics.max_wait = std::chrono::microseconds{ max_wait_us_.load() };
+
+			std::lock_guard lock{ mutex_ };
+			metrics.queue_depth = jobs_.size();
+			metrics.max_queue_depth = max_queue_depth_;
+
+			return metrics;
+		}
+
+	private:
+		struct JobBase
+		{
+			explicit JobBase(std::chrono::milliseconds timeout)
+				:submitted(Clock::now()),
+				timeout(timeout) {}
+
+			virtual ~JobBase() = default;
+
+			//Runs the query and keeps its result. Returns what it threw
+			virtual std::exception_ptr Execute(Connection& connection) = 0;
+
+			//Hands the result, or the error, to the completion on its executor
+			virtual void Complete(std::exception_ptr error) = 0;
+
+			Clock::time_point submitted;
+			std::chrono::milliseconds timeout;
+		};
+
+		template <typename Query, typename Handler>
+		struct Job : JobBase
+		{
+			using Result = std::invoke_result_t<Query&, Connection&>;
+
+			struct NoResult {};
+
+			Job(std::chrono::milliseconds timeout, Query query, Handler handler, const net::any_io_executor& fallback)
+				:JobBase(timeout),
+				query(std::move(query)),
+				work(net::make_work_guard(handler, fallback)),
+				handler(std::move(handler)) {}
+
+			std::exception_ptr Execute(Connection& connection) override
+			{
+				try
+				{
+					if constexpr (std::is_void_v<Result>)
+					{
+						query(connection);
+					}
+					else
+					{
+						result = query(connection);
+					}
+				}
+				catch (...)
+				{
+					return std::current_exception();
+				}
+
+				return {};
+			}
+
+			void Complete(std::exception_ptr error) override
+			{
+				if constexpr (std::is_void_v<Result>)
+				{
+					net::post(work.get_executor(), [handler = std::move(handler), error]() mutable
+						{
+							handler(error);
+						});
+				}
+				else
+				{
+					net::post(work.get_executor(), [handler = std::move(handler), error, result = std::move(result)]() mutable
+						{
+							handler(error, std::move(result));
+						});
+				}
+
+				work.reset();
+			}
+
+			Query query;
+			std::conditional_t<std::is_void_v<Result>, NoResult, Result> result{};
+			net::executor_work_guard<net::associated_executor_t<Handler, net::any_io_executor>> work;
+			Handler handler;
+		};
+
+		void Submit(std::unique_ptr<JobBase> job)
+		{
+			++submitted_;
+
+			{
+				std::lock_guard lock{ mutex_ };
+
+				if (!stop_.stop_requested())
+				{
+					jobs_.push_back(std::move(job));
+					max_queue_depth_ = std::max(max_queue_depth_, jobs_.size());
+				}
+			}
+
+			if (job)
+			{
+				++failed_;
+				job->Complete(std::make_exception_ptr(std::runtime_error("Query executor is stopped")));
+				return;
+			}
+
+			wakeup_.notify_one();
+		}
+
+		void Run(std::stop_token stop)
+		{
+			while (true)
+			{
+				std::unique_ptr<JobBase> job;
+
+				{
+					std::unique_lock lock{ mutex_ };
+
+					//Once stopping, the queue is drained before the thread leaves
+					wakeup_.wait(lock, stop, [this]
+						{
+							return !jobs_.empty();
+						});
+
+					if (jobs_.empty())
+					{
+						return;
+					}
+
+					job = std::move(jobs_.front());
+					jobs_.pop_front();
+				}
+
+				std::exception_ptr error;
+
+				try
+				{
+					auto connection = pool_.GetConnection();
+					Clock::duration wait = Clock::now() - job->submitted;
+
+					AddWait(wait);
+
+					if (wait >= job->timeout)
+					{
+						++timed_out_;
+						error = std::make_exception_ptr(QueryTimeout("Query waited longer than its timeout"));
+					}
+					else
+					{
+						SetTimeout(connection, job->timeout);
+						error = job->Execute(*connection);
+
+						++(error ? failed_ : completed_);
+					}
+				}
+				catch (...)
+				{
+					//The connection couldn't be set up, the query never ran
+					++failed_;
+					error = std::current_exception();
+				}
+
+				//Counted first, so the completion sees itself in the metrics
+				job->Complete(error);
+			}
+		}
+
+		void AddWait(Clock::duration wait)
+		{
+			auto us = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+			total_wait_us_ += us;
+
+			std::uint64_t max = max_wait_us_.load();
+
+			while (us > max && !max_wait_us_.compare_exchange_weak(max, us))
+			{
+			}
+		}
+
+		//Most queries share a timeout, so the session keeps it and the server hears about it once.
+		//The pool remembers it with the connection, a reconnected session hears about it again
+		static void SetTimeout(Lease& connection, std::chrono::milliseconds timeout)
+		{
+			if (connection.GetSessionTimeout() != timeout)
+			{
+				ApplyStatementTimeout(*connection, timeout);
+				connection.SetSessionTimeout(timeout);
+			}
+		}
+
+		Pool& pool_;
+		net::any_io_executor fallback_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable_any wakeup_;
+		std::deque<std::unique_ptr<JobBase>> jobs_;
+		std::size_t max_queue_depth_ = 0;
+
+		std::atomic<std::uint64_t> submitted_ = 0;
+		std::atomic<std::uint64_t> completed_ = 0;
+		std::atomic<std::uint64_t> failed_ = 0;
+		std::atomic<std::uint64_t> timed_out_ = 0;
+		std::atomic<std::uint64_t> total_wait_us_ = 0;
+		std::atomic<std::uint64_t> max_wait_us_ = 0;
+
+		std::stop_source stop_;
+
+		//Last, so the threads are joined before anything they use goes away
+		std::vector<std::jthread> workers_;
+	};
+
+	using QueryExecutor = BasicQueryExecutor<ConnectionPool>;
+}
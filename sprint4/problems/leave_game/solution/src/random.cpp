@@ -0,0 +1,88 @@
+#include "random.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace util
+{
+	//===Xoshiro256===
+	Xoshiro256::Xoshiro256()
+	{
+		std::random_device device;
+
+		Seed((static_cast<std::uint64_t>(device()) << 32) ^ device());
+	}
+
+	void Xoshiro256::Seed(std::uint64_t seed)
+	{
+		for (std::uint64_t& word : state_)
+		{
+			seed += 0x9e3779b97f4a7c15;
+
+			std::uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+
+			word = z ^ (z >> 31);
+		}
+	}
+
+	//===AliasTable===
+	AliasTable::AliasTable(std::span<const double> weights)
+		:chance_(weights.size(), 1.0),
+		alias_(weights.size())
+	{
+		const size_t size = weights.size();
+		const double total = std::accumulate(weights.begin(), weights.end(), 0.0, [](double sum, double weight) { return sum + std::max(weight, 0.0); });
+
+		std::iota(alias_.begin(), alias_.end(), 0);
+
+		if (total <= 0)
+		{
+			return;
+		}
+
+		//Weights scaled so that an even share is 1. Columns below it are topped up from the ones above
+		std::vector<double> scaled(size);
+		std::vector<std::uint32_t> small;
+		std::vector<std::uint32_t> large;
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			scaled[i] = std::max(weights[i], 0.0) * size / total;
+
+			(scaled[i] < 1 ? small : large).push_back(static_cast<std::uint32_t>(i));
+		}
+
+		while (!small.empty() && !large.empty())
+		{
+			std::uint32_t less = small.back();
+			std::uint32_t more = large.back();
+
+			small.pop_back();
+
+			chance_[less] = scaled[less];
+			alias_[less] = more;
+
+			scaled[more] -= 1 - scaled[less];
+
+			if (scaled[more] < 1)
+			{
+				large.pop_back();
+				small.push_back(more);
+			}
+		}
+
+		//Whatever is left is a full column up to rounding
+		for (std::uint32_t i : small)
+		{
+			chance_[i] = 1;
+		}
+
+		for (std::uint32_t i : large)
+		{
+			chance_[i] = 1;
+		}
+	}
+}
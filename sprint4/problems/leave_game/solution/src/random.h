@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace util
+{
+	//xoshiro256** by Blackman and Vigna. A few nanoseconds per draw, 256 bits of state, and the same
+	//sequence for the same seed on every platform. Not for secrets, tokens come from elsewhere
+	class Xoshiro256
+	{
+	public:
+		using result_type = std::uint64_t;
+
+		//Seeded from std::random_device
+		Xoshiro256();
+
+		explicit Xoshiro256(std::uint64_t seed)
+		{
+			Seed(seed);
+		}
+
+		//Spreads the seed over the state with splitmix64, so close seeds give unrelated sequences
+		void Seed(std::uint64_t seed);
+
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+
+		static constexpr result_type max()
+		{
+			return std::numeric_limits<result_type>::max();
+		}
+
+		result_type operator()()
+		{
+			const std::uint64_t result = Rotate(state_[1] * 5, 7) * 9;
+			const std::uint64_t t = state_[1] << 17;
+
+			state_[2] ^= state_[0];
+			state_[3] ^= state_[1];
+			state_[1] ^= state_[2];
+			state_[0] ^= state_[3];
+
+			state_[2] ^= t;
+			state_[3] = Rotate(state_[3], 45);
+
+			return result;
+		}
+
+		//Uniform in [0, bound), bound > 0. Lemire's multiply and shift, a division only on the rare retry path
+		std::uint64_t Below(std::uint64_t bound)
+		{
+			unsigned __int128 product = static_cast<unsigned __int128>((*this)()) * bound;
+			std::uint64_t low = static_cast<std::uint64_t>(product);
+
+			if (low < bound)
+			{
+				const std::uint64_t threshold = (0 - bound) % bound;
+
+				while (low < threshold)
+				{
+					product = static_cast<unsigned __int128>((*this)()) * bound;
+					low = static_cast<std::uint64_t>(product);
+				}
+			}
+
+			return static_cast<std::uint64_t>(product >> 64);
+		}
+
+		//Uniform in [0, 1)
+		double Real()
+		{
+			return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+		}
+
+	private:
+		static std::uint64_t Rotate(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+		std::uint64_t state_[4];
+	};
+
+	//Walker's alias method in Vose's form: picks index i with probability weights[i] / sum(weights)
+	//in O(1), one column and one coin per draw however many weights there are
+	class AliasTable
+	{
+	public:
+		AliasTable() = default;
+
+		//Negative weights count as zero. If all of them are zero the indices are equally likely
+		explicit AliasTable(std::span<const double> weights);
+
+		std::size_t Size() const
+		{
+			return chance_.size();
+		}
+
+		bool Empty() const
+		{
+			return chance_.empty();
+		}
+
+		//The table must not be empty
+		std::size_t Sample(Xoshiro256& random) const
+		{
+			const std::size_t column = static_cast<std::size_t>(random.Below(chance_.size()));
+
+			return random.Real() < chance_[column] ? column : alias_[column];
+		}
+
+	private:
+		//Chance of a column to give its own index rather than its alias
+		std::vector<double> chance_;
+		std::vector<std::uint32_t> alias_;
+	};
+}
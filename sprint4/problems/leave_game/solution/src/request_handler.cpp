@@ -1,15 +1,5 @@
 ﻿#include "request_handler.h"
 
-bool IsValidToken(std::string token)
-{
-	if (token.size() != 32)
-	{
-		return false;
-	}
-
-	return true;
-}
-
 namespace http_handler 
 {
 	StringResponse MakeStringResponse(http::status status, std::string_view body, 
@@ -37,7 +27,115 @@ namespace http_handler
 		return response;
 	}
 
-	void PackMaps(json::array& target_container, model::Game& game)
+	SharedResponse MakeSharedResponse(http::status status, http_server::SharedStringBody::value_type body,
+		unsigned http_version, bool keep_alive, std::string_view content_type)
+	{
+		SharedResponse response(status, http_version);
+		response.set(http::field::content_type, content_type);
+		response.set(http::field::cache_control, "no-cache");
+		response.body() = std::move(body);
+		response.prepare_payload();
+		response.keep_alive(keep_alive);
+		return response;
+	}
+
+	SendfileResponse MakeSendfileResponse(http::status status, beast::file&& file, ByteRange range,
+		unsigned http_version, bool keep_alive, bool header_only, std::string_view content_type)
+	{
+		SendfileResponse response;
+		response.header.result(status);
+		response.header.version(http_version);
+		response.header.set(http::field::content_type, content_type);
+
+		if (status != http::status::not_modified)
+		{
+			response.header.content_length(range.length);
+		}
+
+		response.header.keep_alive(keep_alive);
+
+		response.file = std::move(file);
+		response.offset = range.offset;
+		response.length = header_only || status == http::status::not_modified ? 0 : range.length;
+		return response;
+	}
+
+	RangeResult ParseRange(std::string_view range, std::uint64_t size, ByteRange& result)
+	{
+		constexpr std::string_view prefix = "bytes=";
+
+		if (!range.starts_with(prefix) || range.find(',') != std::string_view::npos)
+		{
+			return RangeResult::FULL;
+		}
+
+		range.remove_prefix(prefix.size());
+
+		size_t dash = range.find('-');
+
+		if (dash == std::string_view::npos)
+		{
+			return RangeResult::FULL;
+		}
+
+		const auto parse = [](std::string_view str, std::uint64_t& value)
+			{
+				auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+				return ec == std::errc{} && ptr == str.data() + str.size();
+			};
+
+		std::string_view first = range.substr(0, dash);
+		std::string_view last = range.substr(dash + 1);
+
+		//"bytes=-500" means the last 500 bytes
+		if (first.empty())
+		{
+			std::uint64_t suffix = 0;
+
+			if (!parse(last, suffix))
+			{
+				return RangeResult::FULL;
+			}
+
+			if (suffix == 0 || size == 0)
+			{
+				return RangeResult::UNSATISFIABLE;
+			}
+
+			suffix = std::min(suffix, size);
+			result = { size - suffix, suffix };
+			return RangeResult::PARTIAL;
+		}
+
+		std::uint64_t start = 0;
+		std::uint64_t end = 0;
+
+		if (!parse(first, start))
+		{
+			return RangeResult::FULL;
+		}
+
+		//"bytes=500-" means everything from byte 500
+		if (last.empty())
+		{
+			end = size;
+		}
+		else if (!parse(last, end) || end < start)
+		{
+			return RangeResult::FULL;
+		}
+
+		if (start >= size)
+		{
+			return RangeResult::UNSATISFIABLE;
+		}
+
+		end = std::min(end, size - 1);
+		result = { start, end - start + 1 };
+		return RangeResult::PARTIAL;
+	}
+
+	void PackMaps(json::array& target_container, const model::Game& game)
 	{
 		for (auto& map : game.GetMaps())
 		{
@@ -119,6 +217,61 @@ namespace http_handler
 		}
 	}
 
+	json::object PackMap(const model::Map* map_ptr, const model::Game& game)
+	{
+		json::object result;
+
+		//Initializing object using map id and name
+		result.emplace("id", *map_ptr->GetId());
+		result.emplace("name", map_ptr->GetName());
+
+		//Inserting Roads
+		json::array roads;
+		PackRoads(roads, map_ptr);
+
+		result.emplace("roads", std::move(roads));
+
+		//Inserting Buildings
+		json::array buildings;
+		PackBuildings(buildings, map_ptr);
+
+		result.emplace("buildings", std::move(buildings));
+
+		//Inserting Offices
+		json::array offices;
+		PackOffices(offices, map_ptr);
+
+		result.emplace("offices", std::move(offices));
+
+		//Appending loot table
+		result.emplace("lootTypes", game.GetLootTable(*map_ptr->GetId()));
+
+		return result;
+	}
+
+	MapsCache::MapsCache(const model::Game& game)
+	{
+		json::array map_list;
+		PackMaps(map_list, game);
+
+		map_list_ = MakeCachedBody(json::serialize(map_list));
+
+		for (const model::Map& map : game.GetMaps())
+		{
+			map_by_id_.emplace(*map.GetId(), MakeCachedBody(json::serialize(PackMap(&map, game))));
+		}
+	}
+
+	const CachedBody* MapsCache::FindMap(const std::string& id) const
+	{
+		if (auto iter = map_by_id_.find(id); iter != map_by_id_.end())
+		{
+			return &iter->second;
+		}
+
+		return nullptr;
+	}
+
 	bool IsSubPath(fs::path path, fs::path base)
 	{
 		path = fs::weakly_canonical(path);
@@ -135,43 +288,4 @@ namespace http_handler
 		return true;
 	}
 
-	//Dictionary with different extensions. Idk where else to put it
-	std::map<std::string_view, std::string_view> EXTENSION_TO_VALUE =
-	{
-		{".json"sv, ContentType::APPLICATION_JSON},
-		{".xml"sv, ContentType::APPLICATION_XML},
-
-		{".js"sv, ContentType::TEXT_JS},
-		{".css"sv, ContentType::TEXT_CSS},
-		{".txt"sv, ContentType::TEXT_TXT},
-		{".htm"sv, ContentType::TEXT_HTML},
-		{".html"sv, ContentType::TEXT_HTML},
-
-		{".png"sv, ContentType::IMAGE_PNG},
-		{".jpg"sv, ContentType::IMAGE_JPG},
-		{".jpe"sv, ContentType::IMAGE_JPG},
-		{".jpeg"sv, ContentType::IMAGE_JPG},
-		{".gif"sv, ContentType::IMAGE_GIF},
-		{".bmp"sv, ContentType::IMAGE_BMP},
-		{".ico"sv, ContentType::IMAGE_ICO},
-		{".tif"sv, ContentType::IMAGE_TIF},
-		{".tiff"sv, ContentType::IMAGE_TIF},
-		{".svg"sv, ContentType::IMAGE_SVG},
-		{".svgz"sv, ContentType::IMAGE_SVG},
-
-		{".mp3"sv, ContentType::AUDIO_MP3},
-	};
-
-	std::string_view GetContentType(std::string_view extension)
-	{
-		auto iter = EXTENSION_TO_VALUE.find(extension);
-
-		if (iter != EXTENSION_TO_VALUE.end())
-		{
-			return iter->second;
-		}
-
-		return ContentType::APPLICATION_BLANK;
-	}
-
 }  // namespace http_handler
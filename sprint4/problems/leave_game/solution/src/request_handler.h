@@ -3,14 +3,20 @@
 #include "model.h"
 #include <boost/json.hpp>
 #include <map>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <variant>
 
 #include "save_manager.h"
-
-bool IsValidToken(std::string token);
+#include "game_executor.h"
+#include "response_cache.h"
+#include "content_type.h"
+#include "static_cache.h"
+#include "api_router.h"
 
 namespace http_handler
 {
@@ -25,25 +31,23 @@ namespace http_handler
 	using FileResponse = http::response<http::file_body>;
 	using StringRequest = http::request<http::string_body>;
 	using StringResponse = http::response<http::string_body>;
+	using SharedResponse = http::response<http_server::SharedStringBody>;
+	using SendfileResponse = http_server::SendfileResponse;
+
+	//Files bigger than this are sent with sendfile instead of being cached in memory
+	constexpr std::uintmax_t DEFAULT_SENDFILE_THRESHOLD = 1024 * 1024;
+
+	struct ByteRange
+	{
+		std::uint64_t offset;
+		std::uint64_t length;
+	};
 
-	struct ContentType
+	enum class RangeResult
 	{
-		ContentType() = delete;
-		constexpr static std::string_view APPLICATION_JSON = "application/json"sv;
-		constexpr static std::string_view APPLICATION_XML = "application/xml"sv;
-		constexpr static std::string_view APPLICATION_BLANK = "application/octet-stream"sv;
-		constexpr static std::string_view TEXT_JS = "text/javascript"sv;
-		constexpr static std::string_view TEXT_CSS = "text/css"sv;
-		constexpr static std::string_view TEXT_TXT = "text/plain"sv;
-		constexpr static std::string_view TEXT_HTML = "text/html"sv;
-		constexpr static std::string_view IMAGE_PNG = "image/png"sv;
-		constexpr static std::string_view IMAGE_JPG = "image/jpeg"sv;
-		constexpr static std::string_view IMAGE_GIF = "image/gif"sv;
-		constexpr static std::string_view IMAGE_BMP = "image/bmp"sv;
-		constexpr static std::string_view IMAGE_ICO = "image/vnd.microsoft.icon"sv;
-		constexpr static std::string_view IMAGE_TIF = "image/tiff"sv;
-		constexpr static std::string_view IMAGE_SVG = "image/svg+xml"sv;
-		constexpr static std::string_view AUDIO_MP3 = "audio/mpeg"sv;
+		FULL,
+		PARTIAL,
+		UNSATISFIABLE
 	};
 
 	//Creates a response using given parameters
@@ -51,38 +55,274 @@ namespace http_handler
 		unsigned http_version, bool keep_alive, std::string_view content_type);
 	FileResponse MakeResponse(http::status status, http::file_body::value_type& body,
 		unsigned http_version, bool keep_alive, std::string_view content_type);
+	SharedResponse MakeSharedResponse(http::status status, http_server::SharedStringBody::value_type body,
+		unsigned http_version, bool keep_alive, std::string_view content_type);
+	SendfileResponse MakeSendfileResponse(http::status status, beast::file&& file, ByteRange range,
+		unsigned http_version, bool keep_alive, bool header_only, std::string_view content_type);
+
+	//Parses a single "bytes=" range. Anything we don't support (several ranges, other units, bad syntax)
+	//is ignored and the whole file is sent, as RFC 9110 allows
+	RangeResult ParseRange(std::string_view range, std::uint64_t size, ByteRange& result);
 
 	//Data Packets
-	void PackMaps(json::array& target_container, model::Game& game);
+	void PackMaps(json::array& target_container, const model::Game& game);
 	void PackRoads(json::array& target_container, const model::Map* map_ptr);
 	void PackBuildings(json::array& target_container, const model::Map* map_ptr);
 	void PackOffices(json::array& target_container, const model::Map* map_ptr);
+	json::object PackMap(const model::Map* map_ptr, const model::Game& game);
+
+	//Map descriptions never change after loading, so their bodies are serialized once at startup
+	class MapsCache
+	{
+	public:
+		explicit MapsCache(const model::Game& game);
+
+		const CachedBody& GetMapList() const
+		{
+			return map_list_;
+		}
+
+		//Returns nullptr if there is no map with such id
+		const CachedBody* FindMap(const std::string& id) const;
+
+	private:
+		CachedBody map_list_;
+		std::unordered_map<std::string, CachedBody> map_by_id_;
+	};
 
 	// Returns true, if catalogue p is inside base_path.
 	bool IsSubPath(fs::path path, fs::path base);
 
-	// Returns content type by raw extension string_view
-	std::string_view GetContentType(std::string_view extension);
 	void LogResponse(auto time, int code, std::string_view content_type)
 	{
 		//Logging request
-		json::object logger_data{ {"response_time", time}, {"code", code} };
-		if (content_type.empty())
+		async_log::LogResponseSent(time, code, content_type);
+	}
+
+	//Reads the token from "Authorization: Bearer <token>" without copying the header
+	std::optional<model::Token> GetAuthToken(const auto& request)
+	{
+		auto auth = request.find(http::field::authorization);
+
+		if (auth == request.end())
+		{
+			return std::nullopt;
+		}
+
+		return model::ParseBearerToken(auth->value());
+	}
+
+	//Runs the query on the game's query executor, so the calling thread never waits for the database.
+	//Without one the query runs right here. The handler gets (std::exception_ptr, result) either way
+	template <typename Query, typename Handler>
+	void ExecuteQuery(model::Game& game, Query&& query, Handler&& handler)
+	{
+		if (db::QueryExecutor* query_executor = game.GetQueryExecutor())
+		{
+			query_executor->AsyncExecute(std::forward<Query>(query), std::forward<Handler>(handler));
+			return;
+		}
+
+		std::exception_ptr error;
+		std::invoke_result_t<Query&, pqxx::connection&> result{};
+
+		try
+		{
+			db::ConnectionPool::ConnectionWrapper wrap = game.GetPool().GetConnection();
+			result = query(*wrap);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		handler(error, std::move(result));
+	}
+
+	template <typename Send>
+	void SendDatabaseError(Send&& send, const auto& text_response, std::exception_ptr error)
+	{
+		json::object response;
+		std::string message;
+
+		try
+		{
+			std::rethrow_exception(error);
+		}
+		catch (const std::exception& ex)
+		{
+			message = ex.what();
+		}
+		catch (...)
+		{
+			message = "Unknown error";
+		}
+
+		json::object logger_data{ {"code", "databaseError"}, {"exception", message} };
+		BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "error"sv;
+
+		response.emplace("code", "databaseError");
+		response.emplace("message", "Records are unavailable right now");
+
+		StringResponse str_response{ text_response(http::status::service_unavailable, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+		str_response.set(http::field::cache_control, "no-cache");
+
+		send(str_response);
+	}
+
+	//Sends one of the prepared bodies, or 304 if the client already has it
+	template <typename Send>
+	void SendCachedBody(Send&& send, const auto& request, const auto& shared_response, const CachedBody& cached,
+		std::string_view content_type, std::string_view last_modified = {})
+	{
+		const bool use_gzip = cached.gzipped && AcceptsGzip(request[http::field::accept_encoding]);
+		const std::string& etag = use_gzip ? cached.gzip_etag : cached.etag;
+
+		//If-Modified-Since is only checked when the client didn't send an ETag
+		bool not_modified = false;
+
+		if (auto if_none_match = request.find(http::field::if_none_match); if_none_match != request.end())
+		{
+			not_modified = ETagMatches(if_none_match->value(), etag);
+		}
+		else if (auto if_modified_since = request.find(http::field::if_modified_since); if_modified_since != request.end() && !last_modified.empty())
+		{
+			not_modified = NotModifiedSince(if_modified_since->value(), last_modified);
+		}
+
+		SharedBuffer body;
+
+		if (!not_modified)
+		{
+			body = use_gzip ? cached.gzipped : cached.plain;
+		}
+
+		SharedResponse response{ shared_response(not_modified ? http::status::not_modified : http::status::ok, std::move(body), content_type) };
+
+		if (not_modified)
+		{
+			//304 has no body, the length would describe a representation we don't send
+			response.erase(http::field::content_length);
+		}
+		else if (use_gzip)
+		{
+			response.set(http::field::content_encoding, "gzip"sv);
+		}
+
+		response.set(http::field::etag, etag);
+		response.set(http::field::vary, "Accept-Encoding"sv);
+
+		if (!last_modified.empty())
 		{
-			logger_data.emplace("content_type", "null");
+			response.set(http::field::last_modified, last_modified);
+		}
+
+		send(response);
+	}
+
+	//Answers from the last published snapshot, without waiting for the map's strand.
+	//Only a map that had no players until now may have none, then the first reader builds it there
+	template <typename Send>
+	void SendMapSnapshot(Send&& send, const auto& shared_response, model::Game& game, model::GameExecutor& executor,
+		const model::Map& map, model::MapSnapshot::Body model::MapSnapshot::* body, bool no_cache)
+	{
+		const auto respond = [send, shared_response, body, no_cache](const model::StateSnapshots::Snapshot& snapshot)
+			{
+				SharedResponse response{ shared_response(http::status::ok, (*snapshot).*body, ContentType::APPLICATION_JSON) };
+
+				if (no_cache)
+				{
+					response.set(http::field::cache_control, "no-cache");
+				}
+
+				send(response);
+			};
+
+		if (model::StateSnapshots::Snapshot snapshot = game.FindMapState(map))
+		{
+			respond(snapshot);
+			return;
+		}
+
+		executor.Run(map, [respond, &game, &map]
+			{
+				respond(game.GetMapState(map));
+			});
+	}
+
+	//Large files skip the cache and go from the page cache straight to the socket.
+	//Single byte ranges are supported, so interrupted downloads can be resumed
+	template <typename Send>
+	void SendLargeFile(Send&& send, const auto& request, const auto& text_response, const auto& sendfile_response,
+		beast::file&& file, std::uint64_t size, const fs::path& path, std::string_view content_type)
+	{
+		std::error_code ec;
+		auto write_time = std::chrono::file_clock::to_sys(fs::last_write_time(path, ec));
+		std::time_t modified = std::chrono::system_clock::to_time_t(std::chrono::time_point_cast<std::chrono::system_clock::duration>(write_time));
+
+		std::string last_modified = FormatHttpDate(modified);
+		std::string etag = MakeETag(std::to_string(size) + "-" + std::to_string(modified));
+
+		const auto set_validators = [&etag, &last_modified](SendfileResponse& response)
+			{
+				response.header.set(http::field::etag, etag);
+				response.header.set(http::field::last_modified, last_modified);
+				response.header.set(http::field::accept_ranges, "bytes"sv);
+			};
+
+		if (auto if_none_match = request.find(http::field::if_none_match); if_none_match != request.end() && ETagMatches(if_none_match->value(), etag))
+		{
+			SendfileResponse response{ sendfile_response(http::status::not_modified, std::move(file), ByteRange{ 0, 0 }, content_type) };
+			set_validators(response);
+
+			send(response);
+			return;
+		}
+
+		ByteRange range{ 0, size };
+		http::status status = http::status::ok;
+
+		if (auto range_header = request.find(http::field::range); range_header != request.end())
+		{
+			//If-Range tells us to send the whole file if it has changed since the client got the first part
+			auto if_range = request.find(http::field::if_range);
+			bool same_file = if_range == request.end() || if_range->value() == etag || if_range->value() == last_modified;
+
+			switch (same_file ? ParseRange(range_header->value(), size, range) : RangeResult::FULL)
+			{
+			case RangeResult::PARTIAL:
+				status = http::status::partial_content;
+				break;
+
+			case RangeResult::UNSATISFIABLE:
+			{
+				StringResponse str_response{ text_response(http::status::range_not_satisfiable, { "" }, ContentType::TEXT_TXT) };
+				str_response.set(http::field::content_range, "bytes */" + std::to_string(size));
+
+				send(str_response);
+				return;
+			}
+
+			case RangeResult::FULL:
+				range = { 0, size };
+				break;
+			}
 		}
-		else
+
+		SendfileResponse response{ sendfile_response(status, std::move(file), range, content_type) };
+		set_validators(response);
+
+		if (status == http::status::partial_content)
 		{
-			std::string type{ content_type }; // :(
-			logger_data.emplace("content_type", type);
+			response.header.set(http::field::content_range, "bytes " + std::to_string(range.offset) + "-" + std::to_string(range.offset + range.length - 1) + "/" + std::to_string(size));
 		}
 
-		BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "response sent"sv;
+		send(response);
 	}
 
 	template <typename Send>
-	void HandleRequestFile(Send&& send, model::Game& game, fs::path& requested_path,
-		const auto& text_response, const auto& file_response)
+	void HandleRequestFile(Send&& send, model::Game& game, fs::path& requested_path, const auto& request,
+		const auto& text_response, const auto& file_response, const auto& sendfile_response, std::uintmax_t sendfile_threshold)
 	{
 		if (!fs::exists(requested_path))
 		{
@@ -122,6 +362,13 @@ namespace http_handler
 				BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "error"sv;
 				return;
 			}
+
+			if (file.size() > sendfile_threshold)
+			{
+				SendLargeFile(send, request, text_response, sendfile_response, std::move(file.file()), file.size(), requested_path, GetContentType(extension));
+				return;
+			}
+
 			send(file_response(http::status::ok, { file }, GetContentType(extension)));
 			return;
 		}
@@ -137,502 +384,429 @@ namespace http_handler
 	}
 
 	template <typename Send>
-	void HandleRequestAPI(Send&& send, model::Game& game, std::string_view target, const auto& text_response,
-		const auto& request, bool rest_api_ticks, savesystem::SaveManager& save_manager)
+	void HandleRequestAPI(Send&& send, model::Game& game, model::GameExecutor& executor, std::string_view target, const auto& text_response,
+		const auto& shared_response, const auto& request, bool rest_api_ticks, savesystem::SaveManager& save_manager,
+		const MapsCache& maps_cache)
 	{
-		std::string_view req_type = request.method_string();
+		const RouteMatch match = API_ROUTER.Match(target, request.method());
 
-		if (target == "/api/v1/maps"sv || target == "/api/v1/maps/"sv)
+		if (match.route == nullptr)
 		{
-			if (req_type != "GET"sv && req_type != "HEAD"sv)
-			{
-				send(text_response(http::status::method_not_allowed, { "Invalid method" }, ContentType::APPLICATION_JSON));
-				return;
-			}
-			json::array response;
-			//Inserting Map Data Into JSON Array
-			PackMaps(response, game);
+			//Throwing error when URL starts with /api/ but doesn't correlate to any of the commands
+			json::object response;
+
+			response.emplace("request", target);
+			response.emplace("code", "badRequest");
+			response.emplace("message", "Bad request");
 
-			StringResponse str_response{ text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+			send(text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON));
+			return;
+		}
+
+		if (!match.method_allowed)
+		{
+			//Allow goes out with 405 only, successful answers don't carry it
+			StringResponse str_response{ text_response(http::status::method_not_allowed, { std::string(MethodNotAllowedBody(match.route->methods)) },
+				ContentType::APPLICATION_JSON) };
 			str_response.set(http::field::cache_control, "no-cache");
-			str_response.set(http::field::allow, "GET, HEAD");
+			str_response.set(http::field::allow, AllowedMethods(match.route->methods));
 
 			send(str_response);
 			return;
 		}
 
-		if (target == "/api/v1/game/tick"sv || target == "/api/v1/game/tick/"sv)
+		switch (match.route->endpoint)
 		{
-			json::object response;
-			http::status response_status;
-			bool allow_post = false;
+		case Endpoint::MAPS:
+		{
+			SendCachedBody(send, request, shared_response, maps_cache.GetMapList(), ContentType::APPLICATION_JSON);
+			return;
+		}
 
-			if (req_type != "POST"sv)
-			{
-				response.emplace("code", "invalidMethod");
-				response.emplace("message", "Only POST method is expected");
-				response_status = http::status::method_not_allowed;
+		case Endpoint::MAP:
+		{
+			const CachedBody* cached = maps_cache.FindMap(std::string(match.param));
 
-				allow_post = true;
-			}
-			else
+			if (cached != nullptr)
 			{
-				if (rest_api_ticks)
-				{
-					try
-					{
-						auto value = json::parse(request.body());
-						int ticks = 0;
-						ticks = value.as_object().at("timeDelta").as_int64();
-
-						//Bad request error if player name is invalid
-						if (ticks == 0)
-						{
-							response.emplace("code", "invalidArgument");
-							response.emplace("message", "Failed to parse tick request JSON");
-
-							response_status = http::status::bad_request;
-						}
-						else
-						{
-							game.ServerTick(ticks);
-							save_manager.Listen(ticks);
-
-							response_status = http::status::ok;
-						}
-					}
-					catch (std::exception& ex)
-					{
-						response.emplace("code", "invalidArgument");
-						response.emplace("message", "Failed to parse tick request JSON");
-
-						response_status = http::status::bad_request;
-					}
-				}
-				else
-				{
-					response.emplace("code", "invalidArgument");
-					response.emplace("message", "Invalid endpoint");
-
-					response_status = http::status::bad_request;
-				}
+				SendCachedBody(send, request, shared_response, *cached, ContentType::APPLICATION_JSON);
+				return;
 			}
 
-			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
-			str_response.set(http::field::cache_control, "no-cache");
+			//Throwing error if requested map isn't found
+			json::object err_responce;
 
-			if (allow_post)
-			{
-				str_response.set(http::field::allow, "POST"sv);
-			}
+			err_responce.emplace("code", "mapNotFound");
+			err_responce.emplace("message", "Map not found");
 
-			send(str_response);
+			StringResponse err_str_response{ text_response(http::status::not_found, { json::serialize(err_responce) }, ContentType::APPLICATION_JSON) };
+
+			send(err_str_response);
 			return;
 		}
 
-		if (target == "/api/v1/game/join"sv || target == "/api/v1/game/join/"sv)
+		case Endpoint::TICK:
 		{
 			json::object response;
 			http::status response_status;
 
-			bool allow_post = false;
-
-			if (req_type != "POST"sv)
-			{
-				response.emplace("code", "invalidMethod");
-				response.emplace("message", "Only POST method is expected");
-
-				response_status = http::status::method_not_allowed;
-
-				allow_post = true;
-			}
-			else
+			if (rest_api_ticks)
 			{
 				try
 				{
 					auto value = json::parse(request.body());
-
-					std::string username{ value.as_object().at("userName").as_string() };
-					std::string map_id{ value.as_object().at("mapId").as_string() };
-
-					using Id = util::Tagged<std::string, model::Map>;
-					Id id{ map_id };
-
-					const model::Map* maptr = game.FindMap(id);
+					int ticks = 0;
+					ticks = value.as_object().at("timeDelta").as_int64();
 
 					//Bad request error if player name is invalid
-					if (username.empty())
+					if (ticks == 0)
 					{
 						response.emplace("code", "invalidArgument");
-						response.emplace("message", "Invalid name");
+						response.emplace("message", "Failed to parse tick request JSON");
 
 						response_status = http::status::bad_request;
 					}
 					else
 					{
-						//Not found error if requested map doesn't exist
-						if (maptr == nullptr)
-						{
-							response.emplace("code", "mapNotFound");
-							response.emplace("message", "Map not found");
-
-							response_status = http::status::not_found;
-						}
-						else
-						{
-							//Everything is okay here. Really.
-							std::string token = game.SpawnPlayer(username, maptr);
+						//Answering once every map has been ticked, and saved if it was time to
+						executor.Tick(ticks, [send, text_response, ticks, &save_manager, &executor]
+							{
+								save_manager.Listen(ticks, executor, [send, text_response]
+									{
+										StringResponse str_response{ text_response(http::status::ok, { json::serialize(json::object{}) }, ContentType::APPLICATION_JSON) };
+										str_response.set(http::field::cache_control, "no-cache");
 
-							response.emplace("authToken", token);
-							response.emplace("playerId", game.FindPlayerByToken(token)->GetId());
+										send(str_response);
+									});
+							});
 
-							response_status = http::status::ok;
-						}
+						return;
 					}
 				}
-				catch (std::exception ex)
+				catch (std::exception& ex)
 				{
 					response.emplace("code", "invalidArgument");
-					response.emplace("message", "Join game request parse error");
+					response.emplace("message", "Failed to parse tick request JSON");
 
 					response_status = http::status::bad_request;
 				}
 			}
+			else
+			{
+				response.emplace("code", "invalidArgument");
+				response.emplace("message", "Invalid endpoint");
+
+				response_status = http::status::bad_request;
+			}
 
 			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
 			str_response.set(http::field::cache_control, "no-cache");
 
-			if (allow_post)
-			{
-				str_response.set(http::field::allow, "POST"sv);
-			}
-
 			send(str_response);
 			return;
 		}
 
-		if (target.size() >= 20)
+		case Endpoint::JOIN:
 		{
+			json::object response;
+			http::status response_status;
 
-			if (std::string_view(target.begin(), target.begin() + 20) == "/api/v1/game/records"sv)
+			try
 			{
-				json::array response;
-				http::status response_status;
-
-				db::ConnectionPool::ConnectionWrapper wrap = game.GetPool().GetConnection();
-				pqxx::read_transaction read_t{ *wrap };
+				auto value = json::parse(request.body());
 
-				std::string query_text = "SELECT id, name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name;";
+				std::string username{ value.as_object().at("userName").as_string() };
+				std::string map_id{ value.as_object().at("mapId").as_string() };
 
-				int max_iterations = 100;
-				int starting_point = 0; 
+				using Id = util::Tagged<std::string, model::Map>;
+				Id id{ map_id };
 
-				auto iter = std::find(target.begin(), target.end(), '?');
-				auto iter_sec = std::find(target.begin(), target.end(), '&');
+				const model::Map* maptr = game.FindMap(id);
 
-				if (iter != target.end())
+				//Bad request error if player name is invalid
+				if (username.empty())
 				{
-					if (std::string_view(iter + 1, iter + 7) == "start="sv)
-					{
-						std::string tmp = "";
-
-						for (char c : std::string_view(iter + 7, iter_sec))
-						{
-							tmp.push_back(c);
-						}
-
-						starting_point = std::stoi(tmp);
-					}
-
-					if (std::string_view(iter_sec + 1, iter_sec + 10) == "maxItems="sv)
-					{
-						std::string tmp = "";
-
-						for (char c : std::string_view(iter_sec + 10, target.end()))
-						{
-							tmp.push_back(c);
-						}
-
-						max_iterations = std::stoi(tmp);
-					}
-				}
-
-				size_t current = 0;
+					response.emplace("code", "invalidArgument");
+					response.emplace("message", "Invalid name");
 
-				if (max_iterations > 100)
-				{
 					response_status = http::status::bad_request;
-					StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
-					str_response.set(http::field::cache_control, "no-cache");
-
-					send(str_response);
-					return;
 				}
-
-				for (auto [id, name, score, play_time_ms] : read_t.query<std::string, std::string, int, int>(query_text))
+				else
 				{
-					if (starting_point > 0)
+					//Not found error if requested map doesn't exist
+					if (maptr == nullptr)
 					{
-						--starting_point;
-						continue;
+						response.emplace("code", "mapNotFound");
+						response.emplace("message", "Map not found");
+
+						response_status = http::status::not_found;
 					}
 					else
 					{
-						if (current < max_iterations)
-						{
-							++current;
-
-							json::object player_data;
-
-							player_data.emplace("name", name);
-							player_data.emplace("score", score);
-							player_data.emplace("playTime", (static_cast<double>(play_time_ms) / 1000));
-
-							response.push_back(player_data);
-						}
-						else
-						{
-							break;
-						}
-					}
-				}
-
-				response_status = http::status::ok;
-				StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
-				str_response.set(http::field::cache_control, "no-cache");
-
-				send(str_response);
-				return;
-			}
-		}
-
-		if (target == "/api/v1/game/players"sv || target == "/api/v1/game/players/"sv)
-		{
-			bool allow_get_head = false;
-			json::object response;
-			http::status response_status;
-
-			if (req_type != "GET"sv && req_type != "HEAD"sv)
-			{
-				response.emplace("code", "invalidMethod");
-				response.emplace("message", "Invalid method");
-
-				response_status = http::status::method_not_allowed;
-
-				allow_get_head = true;
-			}
-			else
-			{
-				std::string token;
-
-				try
-				{
-					auto auth = request.find(http::field::authorization);
-					std::string auth_str = std::string(auth->value());
+						//Everything is okay here. Really.
+						//The new player goes into the map's list, so the rest happens on the map's strand
+						executor.Run(*maptr, [send, text_response, &game, &executor, username = std::move(username), maptr]
+							{
+								model::Player* player = game.SpawnPlayer(username, maptr);
+								executor.RefreshMapState(*maptr);
 
-					assert(auth_str.size() == 39);
-					token = auth_str.substr(7, 32);
-					assert(token.size() == 32);
-				}
-				catch (std::exception ex)
-				{
-					response.emplace("code", "invalidToken");
-					response.emplace("message", "Authorization header is missing");
+								json::object response;
 
-					response_status = http::status::unauthorized;
-				}
-
-				if (token.size() == 32)
-				{
-					model::Player* player_ptr = game.FindPlayerByToken(token);
-					if (player_ptr == nullptr)
-					{
-						response.emplace("code", "unknownToken");
-						response.emplace("message", "Player token has not been found");
+								response.emplace("authToken", model::FormatToken(player->GetToken()));
+								response.emplace("playerId", player->GetId());
 
-						response_status = http::status::unauthorized;
-					}
-					else
-					{
-						for (model::Player* player : game.GetPlayerList(*(player_ptr->GetCurrentMap()->GetId())))
-						{
-							json::object entry;
+								StringResponse str_response{ text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+								str_response.set(http::field::cache_control, "no-cache");
 
-							entry.emplace("name", player->GetName());
+								send(str_response);
+							});
 
-							response.emplace(std::to_string(static_cast<int>(player->GetId())), entry);
-						}
-						response_status = http::status::ok;
+						return;
 					}
 				}
-				else
-				{
-					//For some reason it doesn't work without it..
-					response.emplace("code", "invalidToken");
-					response.emplace("message", "Authorization header is required");
+			}
+			catch (std::exception ex)
+			{
+				response.emplace("code", "invalidArgument");
+				response.emplace("message", "Join game request parse error");
 
-					response_status = http::status::unauthorized;
-				}
+				response_status = http::status::bad_request;
 			}
 
 			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
 			str_response.set(http::field::cache_control, "no-cache");
 
-			if (allow_get_head)
-			{
-				str_response.set(http::field::allow, "GET, HEAD"sv);
-			}
-
 			send(str_response);
 			return;
 		}
 
-		if (target == "/api/v1/game/state"sv || target == "/api/v1/game/state/"sv)
+		case Endpoint::RECORDS:
 		{
-			bool allow_get_head = false;
-			json::object response;
+			json::array response;
 			http::status response_status;
 
-			if (req_type != "GET"sv && req_type != "HEAD"sv)
-			{
-				response.emplace("code", "invalidMethod");
-				response.emplace("message", "Invalid method");
+			int max_iterations = 100;
+			int starting_point = 0;
 
-				response_status = http::status::method_not_allowed;
+			if (!ReadQueryParam(match.query, "start"sv, starting_point) || !ReadQueryParam(match.query, "maxItems"sv, max_iterations)
+				|| starting_point < 0 || max_iterations < 0 || max_iterations > 100)
+			{
+				response_status = http::status::bad_request;
+				StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+				str_response.set(http::field::cache_control, "no-cache");
 
-				allow_get_head = true;
+				send(str_response);
+				return;
 			}
-			else
-			{
-				std::string token;
 
-				try
+			const auto send_records = [send, text_response](const std::vector<db::Record>& records)
 				{
-					auto auth = request.find(http::field::authorization);
-					std::string auth_str = std::string(auth->value());
-					assert(auth_str.size() == 39);
-					token = auth_str.substr(7, 32);
-					assert(token.size() == 32);
-				}
-				catch (std::exception ex)
-				{
-					response.emplace("code", "invalidToken");
-					response.emplace("message", "Authorization header is required");
+					json::array response;
 
-					response_status = http::status::unauthorized;
-				}
-
-				if (token.size() == 32)
-				{
-					model::Player* player_ptr = game.FindPlayerByToken(token);
-					if (player_ptr == nullptr)
+					for (const db::Record& record : records)
 					{
-						response.emplace("code", "unknownToken");
-						response.emplace("message", "Player token has not been found");
+						json::object player_data;
+
+						player_data.emplace("name", record.name);
+						player_data.emplace("score", record.score);
+						player_data.emplace("playTime", (static_cast<double>(record.play_time_ms) / 1000));
 
-						response_status = http::status::unauthorized;
+						response.push_back(player_data);
 					}
-					else
-					{
-						json::object player_data;
 
-						for (model::Player* player : game.GetPlayerList(*(player_ptr->GetCurrentMap()->GetId())))
-						{
-							json::object entry;
-							model::Coordinates pos = player->GetPos();
-							json::array pos_arr;
+					StringResponse str_response{ text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+					str_response.set(http::field::cache_control, "no-cache");
 
-							pos_arr.push_back(pos.x);
-							pos_arr.push_back(pos.y);
+					send(str_response);
+				};
 
-							entry.emplace("pos", pos_arr);
+			//Pages within the top kept in memory never reach the database
+			if (db::Leaderboard* leaderboard = game.GetLeaderboard())
+			{
+				if (std::optional<std::vector<db::Record>> records = leaderboard->GetRange(starting_point, max_iterations))
+				{
+					send_records(*records);
+					return;
+				}
+			}
 
-							model::Velocity vel = player->GetVel();
+			ExecuteQuery(game, [starting_point, max_iterations](pqxx::connection& connection)
+				{
+					return db::Leaderboard::QueryRange(connection, starting_point, max_iterations);
+				},
+				[send, text_response, send_records](std::exception_ptr error, std::vector<db::Record> records)
+				{
+					if (error)
+					{
+						SendDatabaseError(send, text_response, error);
+						return;
+					}
 
-							json::array vel_arr;
+					send_records(records);
+				});
 
-							vel_arr.push_back(vel.x);
-							vel_arr.push_back(vel.y);
+			return;
+		}
 
-							entry.emplace("speed", vel_arr);
-							entry.emplace("dir", std::string{ static_cast<char>(player->GetDir()) });
+		case Endpoint::RECORD_RANK:
+		{
+			json::object response;
 
-							json::array bag_contents;
+			std::string name;
 
-							for (const model::Item& item : player->PeekInTheBag())
-							{
-								json::object item_data;
+			if (!ReadQueryParam(match.query, "name"sv, name) || name.empty())
+			{
+				response.emplace("code", "invalidArgument");
+				response.emplace("message", "Player name is missing");
 
-								item_data.emplace("id", item.id);
-								item_data.emplace("type", item.type);
+				StringResponse str_response{ text_response(http::status::bad_request, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+				str_response.set(http::field::cache_control, "no-cache");
 
-								bag_contents.push_back(item_data);
-							}
+				send(str_response);
+				return;
+			}
 
-							entry.emplace("bag", bag_contents);
+			const auto send_rank = [send, text_response](const std::optional<db::RankedRecord>& ranked)
+				{
+					json::object response;
+					http::status response_status;
 
-							entry.emplace("score", player->GetScore());
+					if (ranked)
+					{
+						response.emplace("name", ranked->record.name);
+						response.emplace("rank", ranked->rank);
+						response.emplace("score", ranked->record.score);
+						response.emplace("playTime", (static_cast<double>(ranked->record.play_time_ms) / 1000));
 
-							player_data.emplace(std::to_string(static_cast<int>(player->GetId())), entry);
-						}
+						response_status = http::status::ok;
+					}
+					else
+					{
+						response.emplace("code", "recordNotFound");
+						response.emplace("message", "Player has no record");
 
-						response.emplace("players", player_data);
+						response_status = http::status::not_found;
+					}
 
-						json::object loot_data;
+					StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+					str_response.set(http::field::cache_control, "no-cache");
 
-						const std::deque<model::Item>& items = player_ptr->GetCurrentMap()->GetItemList();
+					send(str_response);
+				};
 
-						for (size_t i = 0; i < items.size(); ++i)
-						{
-							const model::Item& obj = items[i];
+			//A player missing from memory may still be in the database below the top
+			if (db::Leaderboard* leaderboard = game.GetLeaderboard())
+			{
+				std::optional<db::RankedRecord> ranked = leaderboard->FindRank(name);
 
-							json::object item_data;
+				if (ranked || leaderboard->IsComplete())
+				{
+					send_rank(ranked);
+					return;
+				}
+			}
 
-							item_data.emplace("type", obj.type);
+			ExecuteQuery(game, [name](pqxx::connection& connection)
+				{
+					return db::Leaderboard::QueryRank(connection, name);
+				},
+				[send, text_response, send_rank](std::exception_ptr error, std::optional<db::RankedRecord> ranked)
+				{
+					if (error)
+					{
+						SendDatabaseError(send, text_response, error);
+						return;
+					}
 
-							json::array position;
+					send_rank(ranked);
+				});
 
-							position.push_back(obj.pos.x);
-							position.push_back(obj.pos.y);
+			return;
+		}
 
-							item_data.emplace("pos", position);
+		case Endpoint::PLAYERS:
+		{
+			json::object response;
+			http::status response_status;
 
-							loot_data.emplace(std::to_string(i), item_data);
-						}
+			std::optional<model::Token> token = GetAuthToken(request);
 
-						response.emplace("lostObjects", loot_data);
+			if (token)
+			{
+				std::optional<model::PlayerRef> player_ref = game.FindPlayerByToken(*token);
+				if (!player_ref)
+				{
+					response.emplace("code", "unknownToken");
+					response.emplace("message", "Player token has not been found");
 
-						response_status = http::status::ok;
-					}
+					response_status = http::status::unauthorized;
 				}
 				else
 				{
-					//For some reason it doesn't work without it..
-					response.emplace("code", "invalidToken");
-					response.emplace("message", "Authorization header is required");
-					response_status = http::status::unauthorized;
+					SendMapSnapshot(send, shared_response, game, executor, *player_ref->map, &model::MapSnapshot::players, true);
+					return;
 				}
 			}
+			else
+			{
+				//For some reason it doesn't work without it..
+				response.emplace("code", "invalidToken");
+				response.emplace("message", "Authorization header is required");
+
+				response_status = http::status::unauthorized;
+			}
 
 			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
 			str_response.set(http::field::cache_control, "no-cache");
 
-			if (allow_get_head)
+			send(str_response);
+			return;
+		}
+
+		case Endpoint::STATE:
+		{
+			json::object response;
+			http::status response_status;
+
+			std::optional<model::Token> token = GetAuthToken(request);
+
+			if (token)
+			{
+				std::optional<model::PlayerRef> player_ref = game.FindPlayerByToken(*token);
+				if (!player_ref)
+				{
+					response.emplace("code", "unknownToken");
+					response.emplace("message", "Player token has not been found");
+
+					response_status = http::status::unauthorized;
+				}
+				else
+				{
+					//The body is shared by every player on the map until the next tick
+					SendMapSnapshot(send, shared_response, game, executor, *player_ref->map, &model::MapSnapshot::state, false);
+					return;
+				}
+			}
+			else
 			{
-				str_response.set(http::field::allow, "GET, HEAD"sv);
+				//For some reason it doesn't work without it..
+				response.emplace("code", "invalidToken");
+				response.emplace("message", "Authorization header is required");
+				response_status = http::status::unauthorized;
 			}
 
+			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+			str_response.set(http::field::cache_control, "no-cache");
+
 			send(str_response);
 			return;
 		}
 
-		if (target == "/api/v1/game/player/action"sv || target == "/api/v1/game/player/action/"sv)
+		case Endpoint::ACTION:
 		{
 			json::object response;
 			http::status response_status;
 
-			bool allow_post = false;
-
 			bool valid_content_type = true;
 
 			try
@@ -659,266 +833,182 @@ namespace http_handler
 				response_status = http::status::bad_request;
 			}
 
-			if (req_type != "POST"sv)
+			if (valid_content_type)
 			{
-				response.emplace("code", "invalidMethod");
-				response.emplace("message", "Invalid method");
+				std::optional<model::Token> token = GetAuthToken(request);
 
-				response_status = http::status::method_not_allowed;
-
-				allow_post = true;
-			}
-			else
-			{
-				if (valid_content_type)
+				if (token)
 				{
-					std::string token;
-
 					try
 					{
-						auto auth = request.find(http::field::authorization);
-						std::string auth_str = std::string(auth->value());
+						bool failed = false;
+						auto value = json::parse(request.body());
 
-						assert(auth_str.size() == 39);
-						token = auth_str.substr(7, 32);
-						assert(token.size() == 32);
-					}
-					catch (std::exception ex)
-					{
-						response.emplace("code", "invalidToken");
-						response.emplace("message", "Authorization header is required");
+						if (!value.as_object().contains("move"))
+						{
+							failed = true;
+						}
 
-						response_status = http::status::unauthorized;
-					}
+						std::string user_input;
 
-					if (token.size() == 32)
-					{
-						try
+						if (!failed)
 						{
-							bool failed = false;
-							auto value = json::parse(request.body());
+							user_input = value.as_object().at("move").as_string();
+						}
 
-							if (!value.as_object().contains("move"))
+						std::optional<model::PlayerRef> player_ref = game.FindPlayerByToken(*token);
+
+						if (player_ref)
+						{
+							if (failed)
 							{
-								failed = true;
+								response.emplace("code", "invalidArgument");
+								response.emplace("message", "Failed to parse action");
+
+								response_status = http::status::bad_request;
 							}
+							else
+							{
+								//The dog belongs to the map's strand, so it is steered from there
+								executor.Run(*player_ref->map, [send, text_response, &game, &executor, player_ref = *player_ref, user_input = std::move(user_input)]
+									{
+										model::Player* player = game.FindPlayer(player_ref);
 
-							std::string user_input;
+										//Retired while the action was on its way
+										if (player == nullptr)
+										{
+											json::object response{ { "code", "unknownToken" }, { "message", "Player token has not been found" } };
 
-							if (!failed)
-							{
-								user_input = value.as_object().at("move").as_string();
-							}
+											StringResponse str_response{ text_response(http::status::unauthorized, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
+											str_response.set(http::field::cache_control, "no-cache");
 
-							model::Player* player = game.FindPlayerByToken(token);
+											send(str_response);
+											return;
+										}
 
-							if (player != nullptr)
-							{
-								if (failed)
-								{
-									response.emplace("code", "invalidArgument");
-									response.emplace("message", "Failed to parse action");
-
-									response_status = http::status::bad_request;
-								}
-								else
-								{
-									if (user_input.empty())
-									{
-										player->SetVel(0, 0);
-									}
-									else
-									{
-										char input_char = user_input[0];
-										switch (input_char)
+										if (user_input.empty())
+										{
+											player->SetVel(0, 0);
+										}
+										else
 										{
-										case 'U':
-											player->SetVel(0, -1);
-											player->SetDir(model::Direction::NORTH);
-											break;
-
-										case 'D':
-											player->SetVel(0, 1);
-											player->SetDir(model::Direction::SOUTH);
-											break;
-
-										case 'L':
-											player->SetVel(-1, 0);
-											player->SetDir(model::Direction::WEST);
-											break;
-
-										case 'R':
-											player->SetVel(1, 0);
-											player->SetDir(model::Direction::EAST);
-											break;
-
-										default:
-											failed = true;
-											break;
+											char input_char = user_input[0];
+											switch (input_char)
+											{
+											case 'U':
+												player->SetVel(0, -1);
+												player->SetDir(model::Direction::NORTH);
+												break;
+
+											case 'D':
+												player->SetVel(0, 1);
+												player->SetDir(model::Direction::SOUTH);
+												break;
+
+											case 'L':
+												player->SetVel(-1, 0);
+												player->SetDir(model::Direction::WEST);
+												break;
+
+											case 'R':
+												player->SetVel(1, 0);
+												player->SetDir(model::Direction::EAST);
+												break;
+
+											default:
+												//Unknown moves are ignored
+												break;
+											}
 										}
-									}
 
-									response_status = http::status::ok;
-								}
-							}
-							else
-							{
-								response.emplace("code", "unknownToken");
-								response.emplace("message", "Player token has not been found");
+										//Velocity is a part of the state, readers shouldn't wait for the next tick to see it
+										executor.RefreshMapState(*player->GetCurrentMap());
+
+										StringResponse str_response{ text_response(http::status::ok, { json::serialize(json::object{}) }, ContentType::APPLICATION_JSON) };
+										str_response.set(http::field::cache_control, "no-cache");
+
+										send(str_response);
+									});
 
-								response_status = http::status::unauthorized;
+								return;
 							}
 						}
-						catch (std::exception ex)
+						else
 						{
-							response.emplace("code", "invalidArgument");
-							response.emplace("message", "Failed to parse action");
+							response.emplace("code", "unknownToken");
+							response.emplace("message", "Player token has not been found");
 
-							response_status = http::status::bad_request;
+							response_status = http::status::unauthorized;
 						}
 					}
-					else
+					catch (std::exception ex)
 					{
-						//For some reason it doesn't work without it..
-						response.emplace("code", "invalidToken");
-						response.emplace("message", "Authorization header is required");
+						response.emplace("code", "invalidArgument");
+						response.emplace("message", "Failed to parse action");
 
-						response_status = http::status::unauthorized;
+						response_status = http::status::bad_request;
 					}
 				}
+				else
+				{
+					//For some reason it doesn't work without it..
+					response.emplace("code", "invalidToken");
+					response.emplace("message", "Authorization header is required");
+
+					response_status = http::status::unauthorized;
+				}
 			}
 
 			StringResponse str_response{ text_response(response_status, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
 			str_response.set(http::field::cache_control, "no-cache");
 
-			if (allow_post)
-			{
-				str_response.set(http::field::allow, "POST"sv);
-			}
-
 			send(str_response);
 			return;
 		}
-
-		if (target.size() >= 13)
-		{
-			if (std::string_view(target.begin(), target.begin() + 13) == "/api/v1/maps/"sv)
-			{
-				//JSON object with map data
-				json::object response;
-
-				if (req_type != "GET"sv && req_type != "HEAD"sv)
-				{
-					response.emplace("code", "invalidMethod");
-					response.emplace("message", "Invalid method");
-
-					StringResponse str_response{ text_response(http::status::method_not_allowed, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
-					str_response.set(http::field::cache_control, "no-cache");
-
-					str_response.set(http::field::allow, "GET, HEAD"sv);
-					send(str_response);
-					return;
-				}
-				else
-				{
-					using Id = util::Tagged<std::string, model::Map>;
-					Id id{ std::string(target.begin() + 13, target.end()) };
-
-					const model::Map* maptr = game.FindMap(id);
-
-					if (maptr != nullptr)
-					{
-
-
-						//Initializing object using map id and name
-						response.emplace("id", *maptr->GetId());
-						response.emplace("name", maptr->GetName());
-
-						//Inserting Roads
-						json::array roads;
-						PackRoads(roads, maptr);
-
-						response.emplace("roads", std::move(roads));
-
-						//Inserting Buildings
-						json::array buildings;
-						PackBuildings(buildings, maptr);
-
-						response.emplace("buildings", std::move(buildings));
-
-						//Inserting Offices
-						json::array offices;
-						PackOffices(offices, maptr);
-
-						response.emplace("offices", std::move(offices));
-
-						//Appending loot table
-
-						response.emplace("lootTypes", game.GetLootTable(*id));
-
-						//Printing response
-						StringResponse str_response{ text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON) };
-
-						send(str_response);
-						return;
-					}
-					else
-					{
-						//Throwing error if requested map isn't found
-						json::object err_responce;
-
-						err_responce.emplace("code", "mapNotFound");
-						err_responce.emplace("message", "Map not found");
-
-						StringResponse err_str_response{ text_response(http::status::not_found, { json::serialize(err_responce) }, ContentType::APPLICATION_JSON) };
-
-						send(err_str_response);
-						return;
-					}
-				}
-			}
-		}
-
-
-
-		//Throwing error when URL starts with /api/ but doesn't correlate to any of the commands
-		json::object response;
-
-		std::string body_r = "";
-
-		for (char c : target)
-		{
-			body_r.push_back(c);
 		}
-
-		response.emplace("request", body_r);
-		response.emplace("code", "badRequest");
-		response.emplace("message", "Bad request");
-
-
-		send(text_response(http::status::ok, { json::serialize(response) }, ContentType::APPLICATION_JSON));
-		return;
 	}
 
 	template <typename Send>
-	void HandleRequest(auto&& req, model::Game& game, const fs::path& static_path, Send&& send, bool rest_api_ticks, savesystem::SaveManager& save_manager)
+	void HandleRequest(auto&& req, model::Game& game, model::GameExecutor& executor, const fs::path& static_path, Send&& send, bool rest_api_ticks,
+		savesystem::SaveManager& save_manager, const MapsCache& maps_cache, const StaticCache& static_cache, std::uintmax_t sendfile_threshold)
 	{
 		using std::chrono::duration_cast;
 		using std::chrono::microseconds;
 
 		std::chrono::system_clock::time_point request_start = std::chrono::system_clock::now();
 
-		const auto text_response = [&req, request_start](http::status status, std::string_view body, std::string_view content_type = ContentType::APPLICATION_JSON)
+		//Responses are copied into the tasks that run on map strands, so they must not refer to the request
+		const unsigned version = req.version();
+		const bool keep_alive = req.keep_alive();
+		const bool header_only = req.method() == http::verb::head;
+
+		const auto text_response = [version, keep_alive, request_start](http::status status, std::string_view body, std::string_view content_type = ContentType::APPLICATION_JSON)
 			{
-				StringResponse response{ MakeStringResponse(status, body, req.version(), req.keep_alive(), content_type) };
+				StringResponse response{ MakeStringResponse(status, body, version, keep_alive, content_type) };
 				std::chrono::system_clock::time_point request_end = std::chrono::system_clock::now();
 				LogResponse(duration_cast<std::chrono::milliseconds>(request_end - request_start).count(), static_cast<int>(status), content_type);
 				return response;
 			};
 
-		const auto file_response = [&req, request_start](http::status status, http::file_body::value_type& body, std::string_view content_type = ContentType::APPLICATION_JSON)
+		const auto file_response = [version, keep_alive, request_start](http::status status, http::file_body::value_type& body, std::string_view content_type = ContentType::APPLICATION_JSON)
 			{
-				FileResponse response{ MakeResponse(status, body, req.version(), req.keep_alive(), content_type) };
+				FileResponse response{ MakeResponse(status, body, version, keep_alive, content_type) };
+				std::chrono::system_clock::time_point request_end = std::chrono::system_clock::now();
+				LogResponse(duration_cast<std::chrono::milliseconds>(request_end - request_start).count(), static_cast<int>(status), content_type);
+				return response;
+			};
+
+		const auto shared_response = [version, keep_alive, request_start](http::status status, http_server::SharedStringBody::value_type body, std::string_view content_type = ContentType::APPLICATION_JSON)
+			{
+				SharedResponse response{ MakeSharedResponse(status, std::move(body), version, keep_alive, content_type) };
+				std::chrono::system_clock::time_point request_end = std::chrono::system_clock::now();
+				LogResponse(duration_cast<std::chrono::milliseconds>(request_end - request_start).count(), static_cast<int>(status), content_type);
+				return response;
+			};
+
+		const auto sendfile_response = [version, keep_alive, header_only, request_start](http::status status, beast::file&& file, ByteRange range, std::string_view content_type)
+			{
+				SendfileResponse response{ MakeSendfileResponse(status, std::move(file), range, version, keep_alive, header_only, content_type) };
 				std::chrono::system_clock::time_point request_end = std::chrono::system_clock::now();
 				LogResponse(duration_cast<std::chrono::milliseconds>(request_end - request_start).count(), static_cast<int>(status), content_type);
 				return response;
@@ -926,29 +1016,42 @@ namespace http_handler
 
 		std::string_view req_type = req.method_string();
 		std::string_view target = req.target();
-		size_t size = target.size();
 
 		//Checking if current request is an API request, then handling it
-		if (size >= 4)
+		if (target == "/api"sv || target.starts_with("/api/"sv) || target.starts_with("/api?"sv))
 		{
-			if (std::string_view(target.begin(), target.begin() + 5) == "/api/"sv || std::string_view(target.begin(), target.begin() + 4) == "/api"sv)
-			{
-				HandleRequestAPI(send, game, target, text_response, req, rest_api_ticks, save_manager);
-				return;
-			}
+			HandleRequestAPI(send, game, executor, target, text_response, shared_response, req, rest_api_ticks, save_manager, maps_cache);
+			return;
 		}
 
 		if (req_type != "GET"sv && req_type != "HEAD"sv)
 		{
-			send(text_response(http::status::method_not_allowed, { "Invalid method" }, ContentType::APPLICATION_JSON));
+			StringResponse str_response{ text_response(http::status::method_not_allowed, { "Invalid method" }, ContentType::APPLICATION_JSON) };
+			str_response.set(http::field::allow, AllowedMethods(method::GET | method::HEAD));
+
+			send(str_response);
 			return;
 		}
 
-		std::string_view target_but_without_the_slash{ target.begin() + 1, target.end() };
-
-		fs::path requested_path = static_path / target_but_without_the_slash;
+		std::optional<std::string> static_key = NormalizeStaticPath(target);
 
 		//Security checks
+		if (!static_key)
+		{
+			send(text_response(http::status::bad_request, { "Masterhack Denied. Root remains secure and lives to be breached another day.." }, ContentType::TEXT_TXT));
+			return;
+		}
+
+		//Most of the requests end here, without touching the disk
+		if (std::shared_ptr<const StaticAsset> asset = static_cache.Find(*static_key))
+		{
+			SendCachedBody(send, req, shared_response, asset->body, asset->content_type, asset->last_modified);
+			return;
+		}
+
+		fs::path requested_path = static_path / fs::path(*static_key);
+
+		//Symlinks and files that are too big for the cache still have to be checked
 		if (!IsSubPath(requested_path, static_path))
 		{
 			send(text_response(http::status::bad_request, { "Masterhack Denied. Root remains secure and lives to be breached another day.." }, ContentType::TEXT_TXT));
@@ -956,18 +1059,23 @@ namespace http_handler
 		}
 
 		//Handle file if it's within bounds and is safe
-		HandleRequestFile(send, game, requested_path, text_response, file_response);
+		HandleRequestFile(send, game, requested_path, req, text_response, file_response, sendfile_response, sendfile_threshold);
 
 		return; //In case I ever decide to add something to the code and forget to add return;
 	}
 	class RequestHandler
 	{
 	public:
-		explicit RequestHandler(const fs::path& static_path, model::Game& game, bool rest_api_ticks, savesystem::SaveManager& save_manager)
+		explicit RequestHandler(const fs::path& static_path, model::Game& game, model::GameExecutor& executor, bool rest_api_ticks,
+			savesystem::SaveManager& save_manager, std::uintmax_t sendfile_threshold = DEFAULT_SENDFILE_THRESHOLD)
 			: static_path_{ static_path },
 			game_{ game },
+			executor_{ executor },
 			rest_api_ticks_(rest_api_ticks),
-			save_manager_(save_manager)
+			save_manager_(save_manager),
+			maps_cache_(game),
+			static_cache_(static_path, sendfile_threshold),
+			sendfile_threshold_(sendfile_threshold)
 		{}
 
 		RequestHandler(const RequestHandler&) = delete;
@@ -978,13 +1086,23 @@ namespace http_handler
 		void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send)
 		{
 			// Обработать запрос request и отправить ответ, используя send
-			HandleRequest(req, game_, static_path_, send, rest_api_ticks_, save_manager_);
+			HandleRequest(req, game_, executor_, static_path_, send, rest_api_ticks_, save_manager_, maps_cache_, static_cache_, sendfile_threshold_);
+		}
+
+		//Reloads static files when they change on disk
+		void WatchStaticFiles(net::io_context& ioc)
+		{
+			static_cache_.Watch(ioc);
 		}
 
 	private:
 		const fs::path static_path_;
 		model::Game& game_;
+		model::GameExecutor& executor_;
 		bool rest_api_ticks_;
 		savesystem::SaveManager& save_manager_;
+		const MapsCache maps_cache_;
+		StaticCache static_cache_;
+		std::uintmax_t sendfile_threshold_;
 	};
 }  // namespace http_handler
\ No newline at end of file
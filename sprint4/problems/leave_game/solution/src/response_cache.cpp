@@ -0,0 +1,207 @@
+#include "response_cache.h"
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+
+namespace http_handler
+{
+	namespace
+	{
+		std::string_view Trim(std::string_view str)
+		{
+			while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+			{
+				str.remove_prefix(1);
+			}
+
+			while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+			{
+				str.remove_suffix(1);
+			}
+
+			return str;
+		}
+
+		bool EqualsIgnoreCase(std::string_view l, std::string_view r)
+		{
+			return std::equal(l.begin(), l.end(), r.begin(), r.end(), [](unsigned char a, unsigned char b)
+				{
+					return std::tolower(a) == std::tolower(b);
+				});
+		}
+
+		std::optional<std::time_t> ParseHttpDate(std::string_view date)
+		{
+			std::string str{ Trim(date) };
+			std::tm tm{};
+
+			const char* end = strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+			if (end == nullptr || *end != '\0')
+			{
+				return std::nullopt;
+			}
+
+			return timegm(&tm);
+		}
+
+		//Calls fn for every comma separated element of a header value
+		template <typename Fn>
+		bool AnyListElement(std::string_view list, Fn&& fn)
+		{
+			while (!list.empty())
+			{
+				size_t comma = list.find(',');
+				std::string_view element = Trim(list.substr(0, comma));
+
+				if (!element.empty() && fn(element))
+				{
+					return true;
+				}
+
+				if (comma == std::string_view::npos)
+				{
+					break;
+				}
+
+				list.remove_prefix(comma + 1);
+			}
+
+			return false;
+		}
+	}
+
+	CachedBody MakeCachedBody(std::string body, bool compress)
+	{
+		CachedBody result;
+
+		result.etag = MakeETag(body);
+
+		if (compress)
+		{
+			std::string gzipped = GzipCompress(body);
+
+			//Already compressed formats barely shrink, serving them as is saves a header and a decompression
+			if (gzipped.size() < body.size() / 10 * 9)
+			{
+				result.gzip_etag = MakeETag(gzipped);
+				result.gzipped = std::make_shared<const std::string>(std::move(gzipped));
+			}
+		}
+
+		result.plain = std::make_shared<const std::string>(std::move(body));
+
+		return result;
+	}
+
+	std::string GzipCompress(std::string_view data)
+	{
+		namespace io = boost::iostreams;
+
+		std::string result;
+		{
+			io::filtering_ostream stream;
+			stream.push(io::gzip_compressor(io::gzip_params(io::gzip::best_compression)));
+			stream.push(io::back_inserter(result));
+
+			stream.write(data.data(), data.size());
+		} //Compressor writes the trailer when the stream is destroyed
+
+		return result;
+	}
+
+	std::string MakeETag(std::string_view data)
+	{
+		//FNV-1a, we only need it to change whenever the contents change
+		std::uint64_t hash = 14695981039346656037ull;
+
+		for (unsigned char c : data)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+
+		constexpr char hex_chars[] = "0123456789abcdef";
+
+		std::string etag(18, '"');
+
+		for (int i = 16; i > 0; --i)
+		{
+			etag[i] = hex_chars[hash & 0xF];
+			hash >>= 4;
+		}
+
+		return etag;
+	}
+
+	bool ETagMatches(std::string_view if_none_match, std::string_view etag)
+	{
+		if (Trim(if_none_match) == "*")
+		{
+			return true;
+		}
+
+		return AnyListElement(if_none_match, [etag](std::string_view candidate)
+			{
+				if (candidate.starts_with("W/"))
+				{
+					candidate.remove_prefix(2);
+				}
+
+				return candidate == etag;
+			});
+	}
+
+	bool AcceptsGzip(std::string_view accept_encoding)
+	{
+		return AnyListElement(accept_encoding, [](std::string_view coding)
+			{
+				std::string_view params;
+
+				if (size_t semicolon = coding.find(';'); semicolon != std::string_view::npos)
+				{
+					params = Trim(coding.substr(semicolon + 1));
+					coding = Trim(coding.substr(0, semicolon));
+				}
+
+				if (!EqualsIgnoreCase(coding, "gzip") && !EqualsIgnoreCase(coding, "x-gzip") && coding != "*")
+				{
+					return false;
+				}
+
+				//"gzip;q=0" means the client refuses it
+				if (params.starts_with("q=") || params.starts_with("Q="))
+				{
+					params.remove_prefix(2);
+					return !params.empty() && params.find_first_not_of("0.") != std::string_view::npos;
+				}
+
+				return true;
+			});
+	}
+
+	std::string FormatHttpDate(std::time_t time)
+	{
+		std::tm tm{};
+		gmtime_r(&time, &tm);
+
+		char buffer[32];
+		size_t size = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+		return { buffer, size };
+	}
+
+	bool NotModifiedSince(std::string_view if_modified_since, std::string_view last_modified)
+	{
+		auto since = ParseHttpDate(if_modified_since);
+		auto modified = ParseHttpDate(last_modified);
+
+		return since && modified && *modified <= *since;
+	}
+}
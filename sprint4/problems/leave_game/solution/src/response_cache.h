@@ -0,0 +1,44 @@
+#pragma once
+
+#include <ctime>
+#include <string>
+#include <string_view>
+
+#include "http_server.h"
+
+namespace http_handler
+{
+	using SharedBuffer = http_server::SharedStringBody::value_type;
+
+	//Response body that never changes while it is cached.
+	//Both variants are prepared once and then shared between all responses
+	struct CachedBody
+	{
+		SharedBuffer plain;
+		//nullptr if compression doesn't pay off (images, archives, tiny bodies)
+		SharedBuffer gzipped;
+
+		//Strong validators, the gzipped variant is a different representation so it gets its own tag
+		std::string etag;
+		std::string gzip_etag;
+	};
+
+	CachedBody MakeCachedBody(std::string body, bool compress = true);
+
+	std::string GzipCompress(std::string_view data);
+
+	//Returns a quoted strong ETag built from the body contents
+	std::string MakeETag(std::string_view data);
+
+	//Checks If-None-Match header value against the given ETag (weak comparison, as RFC 9110 requires)
+	bool ETagMatches(std::string_view if_none_match, std::string_view etag);
+
+	//Checks if Accept-Encoding allows gzip
+	bool AcceptsGzip(std::string_view accept_encoding);
+
+	//Formats time as an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT"
+	std::string FormatHttpDate(std::time_t time);
+
+	//Checks If-Modified-Since header value against Last-Modified of the resource
+	bool NotModifiedSince(std::string_view if_modified_since, std::string_view last_modified);
+}
@@ -0,0 +1,219 @@
+#include "retirement_writer.h"
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+
+namespace db
+{
+	RetirementWriter::RetirementWriter(BatchSink sink)
+		:sink_(std::move(sink)) {}
+
+	RetirementWriter::RetirementWriter(ConnectionPool& pool)
+		:RetirementWriter([&pool](std::span<const RetiredRow> rows) { InsertBatch(pool, rows); }) {}
+
+	RetirementWriter::~RetirementWriter()
+	{
+		Stop();
+	}
+
+	void RetirementWriter::Start()
+	{
+		if (running_.exchange(true))
+		{
+			return;
+		}
+
+		worker_ = std::jthread([this](std::stop_token stop)
+			{
+				Run(stop);
+			});
+	}
+
+	void RetirementWriter::Stop()
+	{
+		if (running_.exchange(false))
+		{
+			worker_.request_stop();
+			worker_.join();
+		}
+
+		Collect();
+
+		while (!pending_.empty())
+		{
+			int attempt = 0;
+			std::chrono::milliseconds pause = MIN_RETRY_PAUSE;
+
+			while (!WritePending() && ++attempt < FINAL_ATTEMPTS)
+			{
+				++retries_;
+
+				//A database that blinked at shutdown gets a moment to come back
+				std::this_thread::sleep_for(pause);
+				pause = std::min(pause * 2, MAX_FINAL_PAUSE);
+			}
+
+			if (attempt == FINAL_ATTEMPTS)
+			{
+				//The batch that keeps failing is dropped, the rest may still get through
+				size_t count = std::min(pending_.size(), MAX_BATCH);
+
+				lost_ += count;
+				pending_.erase(pending_.begin(), pending_.begin() + count);
+			}
+		}
+	}
+
+	void RetirementWriter::Push(RetiredPlayer player)
+	{
+		++queued_;
+
+		if (queue_.TryPush(player))
+		{
+			return;
+		}
+
+		//The writer fell behind, a short lock beats waiting for the database
+		++overflowed_;
+
+		std::lock_guard lock{ overflow_mutex_ };
+		overflow_.push_back(std::move(player));
+	}
+
+	RetirementWriter::Metrics RetirementWriter::GetMetrics() const
+	{
+		Metrics metrics;
+
+		metrics.queued = queued_.load();
+		metrics.written = written_.load();
+		metrics.batches = batches_.load();
+		metrics.retries = retries_.load();
+		metrics.overflowed = overflowed_.load();
+		metrics.lost = lost_.load();
+		metrics.backlog = metrics.queued - metrics.written - metrics.lost;
+
+		return metrics;
+	}
+
+	void RetirementWriter::InsertBatch(ConnectionPool& pool, std::span<const RetiredRow> rows)
+	{
+		if (rows.empty())
+		{
+			return;
+		}
+
+		ConnectionPool::ConnectionWrapper wrap = pool.GetConnection();
+		pqxx::work work{ *wrap };
+
+		std::string query = "INSERT INTO retired_players (id, name, score, play_time_ms) VALUES ";
+
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			const RetiredRow& row = rows[i];
+
+			query += i == 0 ? "(" : ", (";
+			query += work.quote(row.id);
+			query += ", ";
+			query += work.quote(row.player.name);
+			query += ", ";
+			query += std::to_string(row.player.score);
+			query += ", ";
+			query += std::to_string(row.player.play_time_ms);
+			query += ")";
+		}
+
+		//A retried batch may have made it the first time round
+		query += " ON CONFLICT (id) DO UPDATE SET name = EXCLUDED.name, score = EXCLUDED.score, play_time_ms = EXCLUDED.play_time_ms;";
+
+		work.exec(query);
+		work.commit();
+	}
+
+	void RetirementWriter::Run(std::stop_token stop)
+	{
+		std::mutex wait_mutex;
+		std::condition_variable_any wakeup;
+
+		std::chrono::milliseconds pause = FLUSH_INTERVAL;
+
+		while (!stop.stop_requested())
+		{
+			Collect();
+
+			if (WritePending())
+			{
+				pause = FLUSH_INTERVAL;
+			}
+			else
+			{
+				++retries_;
+				pause = std::clamp(pause * 2, MIN_RETRY_PAUSE, MAX_RETRY_PAUSE);
+			}
+
+			std::unique_lock lock{ wait_mutex };
+			wakeup.wait_for(lock, stop, pause, []
+				{
+					return false;
+				});
+		}
+	}
+
+	void RetirementWriter::Collect()
+	{
+		//Stop runs this on the calling thread once the worker is gone
+		thread_local boost::uuids::random_generator generator;
+
+		auto add = [this](RetiredPlayer&& player)
+		{
+			pending_.push_back({ to_string(generator()), std::move(player) });
+		};
+
+		while (std::optional<RetiredPlayer> player = queue_.TryPop())
+		{
+			add(std::move(*player));
+		}
+
+		{
+			std::lock_guard lock{ overflow_mutex_ };
+			taken_overflow_.swap(overflow_);
+		}
+
+		for (RetiredPlayer& player : taken_overflow_)
+		{
+			add(std::move(player));
+		}
+
+		taken_overflow_.clear();
+	}
+
+	bool RetirementWriter::WritePending()
+	{
+		size_t done = 0;
+
+		while (done < pending_.size())
+		{
+			size_t count = std::min(pending_.size() - done, MAX_BATCH);
+
+			try
+			{
+				sink_(std::span<const RetiredRow>{ pending_.data() + done, count });
+			}
+			catch (const std::exception&)
+			{
+				pending_.erase(pending_.begin(), pending_.begin() + done);
+				return false;
+			}
+
+			done += count;
+
+			written_ += count;
+			++batches_;
+		}
+
+		pending_.clear();
+		return true;
+	}
+}
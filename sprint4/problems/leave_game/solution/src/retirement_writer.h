@@ -0,0 +1,122 @@
+#pragma once
+
+#include "DB_manager.h"
+#include "bounded_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace db
+{
+	struct RetiredPlayer
+	{
+		std::string name;
+		std::int64_t score = 0;
+		std::int64_t play_time_ms = 0;
+	};
+
+	//Retired player with the id of its row, kept across retries so a batch written twice stays one row each
+	struct RetiredRow
+	{
+		std::string id;
+		RetiredPlayer player;
+	};
+
+	//Write-behind for retired players. Ticks only move a record into a lock-free queue, a background
+	//thread takes whatever piled up and writes it in multi-row batches. A failed batch is retried with
+	//a growing pause, records keep queueing meanwhile. Stop writes out what is left
+	class RetirementWriter
+	{
+	public:
+		static constexpr std::size_t QUEUE_CAPACITY = 4096;
+		static constexpr std::size_t MAX_BATCH = 500;
+		static constexpr std::chrono::milliseconds FLUSH_INTERVAL{ 20 };
+		static constexpr std::chrono::milliseconds MIN_RETRY_PAUSE{ 50 };
+		static constexpr std::chrono::milliseconds MAX_RETRY_PAUSE{ 5000 };
+
+		//Tries per batch once stopping, there is nobody left to wait for a database that's down
+		static constexpr int FINAL_ATTEMPTS = 3;
+
+		//Pauses between them start at MIN_RETRY_PAUSE and double up to this, shutdown shouldn't hang
+		static constexpr std::chrono::milliseconds MAX_FINAL_PAUSE{ 200 };
+
+		//Writes one batch, throws on failure
+		using BatchSink = std::function<void(std::span<const RetiredRow>)>;
+
+		struct Metrics
+		{
+			std::uint64_t queued = 0;
+			std::uint64_t written = 0;
+			std::uint64_t batches = 0;
+			std::uint64_t retries = 0;
+
+			//Pushed while the queue was full, they took the slow path under a lock
+			std::uint64_t overflowed = 0;
+
+			//Given up on at shutdown
+			std::uint64_t lost = 0;
+
+			//Waiting to be written
+			std::uint64_t backlog = 0;
+		};
+
+		explicit RetirementWriter(BatchSink sink);
+
+		//Batches go to retired_players in one INSERT each
+		explicit RetirementWriter(ConnectionPool& pool);
+
+		~RetirementWriter();
+
+		RetirementWriter(const RetirementWriter&) = delete;
+		RetirementWriter& operator=(const RetirementWriter&) = delete;
+
+		void Start();
+
+		//Writes out whatever is left and stops the background thread
+		void Stop();
+
+		//Safe from any thread, never waits for the database
+		void Push(RetiredPlayer player);
+
+		Metrics GetMetrics() const;
+
+		static void InsertBatch(ConnectionPool& pool, std::span<const RetiredRow> rows);
+
+	private:
+		void Run(std::stop_token stop);
+
+		//Moves everything queued so far to pending_
+		void Collect();
+
+		//Writes pending_ batch after batch. Returns false once a batch fails
+		bool WritePending();
+
+		BatchSink sink_;
+
+		util::BoundedQueue<RetiredPlayer> queue_{ QUEUE_CAPACITY };
+
+		std::mutex overflow_mutex_;
+		std::vector<RetiredPlayer> overflow_;
+
+		std::atomic<std::uint64_t> queued_ = 0;
+		std::atomic<std::uint64_t> written_ = 0;
+		std::atomic<std::uint64_t> batches_ = 0;
+		std::atomic<std::uint64_t> retries_ = 0;
+		std::atomic<std::uint64_t> overflowed_ = 0;
+		std::atomic<std::uint64_t> lost_ = 0;
+
+		//Used by the background thread only
+		std::vector<RetiredRow> pending_;
+		std::vector<RetiredPlayer> taken_overflow_;
+
+		std::atomic<bool> running_ = false;
+		std::jthread worker_;
+	};
+}
@@ -7,9 +7,13 @@
 #include <iostream>
 #include <filesystem>
 #include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include "model.h"
 #include "model_serialization.h"
+#include "game_executor.h"
 
 using namespace model;
 using namespace std::literals;
@@ -30,6 +34,17 @@ namespace
 
 namespace savesystem
 {
+	//Everything a save file holds about one map, copied on the map's strand
+	struct MapRecord
+	{
+		std::string map_id;
+		std::deque<model::Item> items;
+
+		std::vector<serialization::DogRepr> dogs;
+		std::vector<serialization::PlayerRepr> players;
+		std::vector<std::string> tokens;
+	};
+
 	class SaveManager
 	{
 	public:
@@ -39,16 +54,31 @@ namespace savesystem
 			save_period_(save_period),
 			game_(game) {}
 
-		void Listen(int ms)
+		//Called after every tick. Once the save period has passed the state is saved before done is called
+		void Listen(int ms, model::GameExecutor& executor, model::GameExecutor::Done done = {})
 		{
-			if (save_period_ < 0)
-				return;
+			bool save_now = false;
+
+			if (save_period_ >= 0)
+			{
+				std::lock_guard lock{ mutex_ };
 
-			ms_since_last_call += ms;
+				ms_since_last_call += ms;
 
-			if (ms_since_last_call >= save_period_)
+				if (ms_since_last_call >= save_period_)
+				{
+					ms_since_last_call = 0;
+					save_now = true;
+				}
+			}
+
+			if (save_now)
 			{
-				SaveState();
+				SaveState(executor, std::move(done));
+			}
+			else if (done)
+			{
+				done();
 			}
 		}
 
@@ -88,23 +118,83 @@ namespace savesystem
 
 					model::Players& player_manager = game_.GetPlayerManager();
 
-					auto restored_dog = dog_repr.Restore(game_);
-					model::Dog* pup = player_manager.InsertDog(restored_dog);
+					model::Dog pup = dog_repr.Restore(game_);
 
 					input_archive >> player_repr;
 
 					std::string token;
 					input_archive >> token;
 
-					model::Player restored_player = player_repr.Restore(game_, pup, player_manager);
-
-					player_manager.InsertPlayer(restored_player, token, map_id);
+					//Old saves may hold "InvalidToken", such players get a new one
+					player_manager.InsertPlayer(player_repr.Restore(game_, pup, player_manager), model::ParseToken(token), map_id);
 				}
 			}
 		}
 
+		//Only for the moments when nothing else touches the game: startup and shutdown
 		void SaveState()
 		{
+			std::vector<MapRecord> records;
+
+			for (const model::Map& map : game_.GetMaps())
+			{
+				records.push_back(RecordMap(map));
+			}
+
+			WriteState(records);
+		}
+
+		//Every map is copied on its own strand while the others keep running, then the file is written at once
+		void SaveState(model::GameExecutor& executor, model::GameExecutor::Done done = {})
+		{
+			auto records = std::make_shared<std::vector<MapRecord>>(game_.GetMaps().size());
+
+			executor.ForEachMap([this, records](size_t index, const model::Map& map)
+				{
+					(*records)[index] = RecordMap(map);
+				},
+				[this, records, done = std::move(done)]
+				{
+					try
+					{
+						WriteState(*records);
+					}
+					catch (const std::exception& ex)
+					{
+						//The next tick waits for done, a failed save must not stop the game
+						json::object logger_data{ {"code", "saveError"}, {"exception", ex.what()} };
+						BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "error"sv;
+					}
+
+					if (done)
+					{
+						done();
+					}
+				});
+		}
+
+	private:
+
+		MapRecord RecordMap(const model::Map& map) const
+		{
+			const util::SlotMap<model::Item>& items = map.GetItemList();
+			MapRecord record{ *map.GetId(), { items.begin(), items.end() } };
+
+			for (const Player& player : game_.GetPlayerList(record.map_id))
+			{
+				record.dogs.emplace_back(*player.GetDog());
+				record.players.emplace_back(player);
+				record.tokens.push_back(model::FormatToken(player.GetToken()));
+			}
+
+			return record;
+		}
+
+		void WriteState(const std::vector<MapRecord>& records)
+		{
+			//Autosaves of overlapping ticks must not write the file at the same time
+			std::lock_guard lock{ file_mutex_ };
+
 			//std::filesystem::path temp_path = filepath_;
 
 			//std::string temp_name = " ";
@@ -116,68 +206,44 @@ namespace savesystem
 			std::ofstream stream{ filepath_ };
 			OutputArchive output_archive{ stream };
 
-			const std::vector<model::Map>& maps = game_.GetMaps();
-			const Players& player_manager = game_.GetPlayerManager();
-
 			//Steps to save a game state:
 
 			//1. Save the total amount of maps
-			output_archive << maps.size();
+			output_archive << records.size();
 			
 			//2. For each map we save it's ID, list of items and player data
-			for (const model::Map& map : maps)
+			for (const MapRecord& record : records)
 			{
-				model::Map::Id map_id = map.GetId();
-
 				//3. Storing the map ID and item list
-				output_archive << *map_id << map.GetItemList();
+				output_archive << record.map_id << record.items;
 
-				//4. Getting the list of active player
-				const std::deque<Player*> players = game_.GetPlayerList(*map_id);
-
-				//5. Storing the player count
-				output_archive << players.size();
+				//4. Storing the player count
+				output_archive << record.players.size();
 
 				//For each player we have to save the dog first, so we can point to it later
-				for (const Player* player : game_.GetPlayerList(*map_id))
+				for (size_t i = 0; i < record.players.size(); ++i)
 				{
-					const Dog* dog = player->GetDog();
-
-					serialization::DogRepr dog_repr{ *dog };
-					serialization::PlayerRepr player_repr{ *player };
-
-					//6. Saving the dog and player
-					output_archive << dog_repr << player_repr;
+					//5. Saving the dog and player
+					output_archive << record.dogs[i] << record.players[i];
 
-					//7. Storing the token
-					std::string token = "InvalidToken";
-
-					for (const auto& entry : player_manager.GetTokenToPlayerTable())
-					{
-						if (entry.second == player)
-						{
-							token = entry.first;
-							break;
-						}
-					}
-
-					output_archive << token;
+					//6. Storing the token
+					output_archive << record.tokens[i];
 				}
 			}
 			stream.close();
 
-			//8. Rename the savefile
+			//7. Rename the savefile
 			//remove(filepath_);
 			//std::filesystem::rename(temp_path, filepath_);
 		}
 
-	private:
-
 		model::Game& game_;
 
 		std::filesystem::path filepath_;
 		int save_period_;
 
+		std::mutex mutex_;
+		std::mutex file_mutex_;
 		int ms_since_last_call = 0;
 	};
 }
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+	//Handle of a SlotMap element. A default constructed key never finds anything
+	struct SlotKey
+	{
+		std::uint32_t index = 0;
+		std::uint32_t generation = 0;
+
+		bool operator==(const SlotKey&) const = default;
+	};
+
+	//Container with stable keys for elements that come and go. The elements themselves are kept packed
+	//in one vector, so going over them is a plain array walk. Keys point into a table of slots whose
+	//generation changes on every erase, so a key of an erased element finds nothing even after its slot
+	//is reused. Insert and erase are O(1): the last element moves into the hole left by an erased one.
+	//Pointers and positions are only good until the next insert or erase, keys for as long as the element lives
+	template <typename T>
+	class SlotMap
+	{
+	public:
+		using Key = SlotKey;
+		using iterator = typename std::vector<T>::iterator;
+		using const_iterator = typename std::vector<T>::const_iterator;
+
+		template <typename... Args>
+		Key Emplace(Args&&... args)
+		{
+			std::uint32_t index;
+
+			if (free_head_ != NO_SLOT)
+			{
+				index = free_head_;
+				free_head_ = slots_[index].target;
+			}
+			else
+			{
+				index = static_cast<std::uint32_t>(slots_.size());
+				slots_.push_back({ 1, 0 });
+			}
+
+			values_.emplace_back(std::forward<Args>(args)...);
+			owners_.push_back(index);
+
+			slots_[index].target = static_cast<std::uint32_t>(values_.size() - 1);
+
+			return { index, slots_[index].generation };
+		}
+
+		Key Insert(T value)
+		{
+			return Emplace(std::move(value));
+		}
+
+		//Returns false if the key was not alive
+		bool Erase(Key key)
+		{
+			if (!Contains(key))
+			{
+				return false;
+			}
+
+			EraseAt(slots_[key.index].target);
+			return true;
+		}
+
+		//Erases the element at the position, the last one takes its place
+		void EraseAt(std::size_t pos)
+		{
+			const std::uint32_t index = owners_[pos];
+
+			if (pos + 1 != values_.size())
+			{
+				values_[pos] = std::move(values_.back());
+				owners_[pos] = owners_.back();
+				slots_[owners_[pos]].target = static_cast<std::uint32_t>(pos);
+			}
+
+			values_.pop_back();
+			owners_.pop_back();
+
+			Slot& slot = slots_[index];
+
+			++slot.generation;
+			slot.target = free_head_;
+			free_head_ = index;
+		}
+
+		bool Contains(Key key) const
+		{
+			return key.index < slots_.size() && slots_[key.index].generation == key.generation;
+		}
+
+		T* Find(Key key)
+		{
+			return Contains(key) ? &values_[slots_[key.index].target] : nullptr;
+		}
+
+		const T* Find(Key key) const
+		{
+			return Contains(key) ? &values_[slots_[key.index].target] : nullptr;
+		}
+
+		//Position of a live element in the packed order
+		std::size_t PositionOf(Key key) const
+		{
+			return slots_[key.index].target;
+		}
+
+		Key KeyAt(std::size_t pos) const
+		{
+			return { owners_[pos], slots_[owners_[pos]].generation };
+		}
+
+		T& operator[](std::size_t pos)
+		{
+			return values_[pos];
+		}
+
+		const T& operator[](std::size_t pos) const
+		{
+			return values_[pos];
+		}
+
+		std::size_t Size() const
+		{
+			return values_.size();
+		}
+
+		bool Empty() const
+		{
+			return values_.empty();
+		}
+
+		//Every key handed out so far stops finding anything, the slots are kept for reuse
+		void Clear()
+		{
+			while (!values_.empty())
+			{
+				EraseAt(values_.size() - 1);
+			}
+		}
+
+		void Reserve(std::size_t size)
+		{
+			values_.reserve(size);
+			owners_.reserve(size);
+			slots_.reserve(size);
+		}
+
+		iterator begin()
+		{
+			return values_.begin();
+		}
+
+		iterator end()
+		{
+			return values_.end();
+		}
+
+		const_iterator begin() const
+		{
+			return values_.begin();
+		}
+
+		const_iterator end() const
+		{
+			return values_.end();
+		}
+
+	private:
+		static constexpr std::uint32_t NO_SLOT = ~std::uint32_t{ 0 };
+
+		struct Slot
+		{
+			//Starts at 1, so default keys never match
+			std::uint32_t generation;
+
+			//Position of the element while the slot is taken, the next free slot otherwise
+			std::uint32_t target;
+		};
+
+		std::vector<T> values_;
+
+		//Slot of every element, by position
+		std::vector<std::uint32_t> owners_;
+
+		std::vector<Slot> slots_;
+		std::uint32_t free_head_ = NO_SLOT;
+	};
+}
@@ -0,0 +1,34 @@
+#include "state_snapshot.h"
+
+#include <utility>
+
+namespace model
+{
+	void StateSnapshots::AddMap()
+	{
+		slots_.emplace_back();
+		changed_.push_back(false);
+	}
+
+	StateSnapshots::Snapshot StateSnapshots::Get(std::size_t map_index) const
+	{
+		return slots_[map_index].load(std::memory_order_acquire);
+	}
+
+	void StateSnapshots::Publish(std::size_t map_index, Snapshot snapshot)
+	{
+		//Old snapshot is released here unless a reader still holds it
+		slots_[map_index].store(std::move(snapshot), std::memory_order_release);
+		changed_[map_index] = false;
+	}
+
+	void StateSnapshots::Invalidate(std::size_t map_index)
+	{
+		Publish(map_index, nullptr);
+	}
+
+	bool StateSnapshots::MarkChanged(std::size_t map_index)
+	{
+		return !std::exchange(changed_[map_index], true);
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace model
+{
+	//Read-only view of a map, built on the map's strand. Published snapshots are never modified,
+	//so every reader shares the same buffers
+	struct MapSnapshot
+	{
+		using Body = std::shared_ptr<const std::string>;
+
+		//Body of /game/state
+		Body state;
+
+		//Body of /game/players
+		Body players;
+	};
+
+	//One slot per map. Readers take the latest snapshot with a single atomic load and never see half
+	//of one. std::atomic<std::shared_ptr> isn't lock-free in libstdc++: a load or a store holds a spin
+	//bit in the slot while it copies the pointer and bumps the count, so readers may spin for that long,
+	//but never for a tick or a rebuild. A replaced snapshot is freed by whoever drops it last
+	class StateSnapshots
+	{
+	public:
+		using Snapshot = std::shared_ptr<const MapSnapshot>;
+
+		//Slots are created while loading maps, before any reader or writer starts
+		void AddMap();
+
+		//Returns nullptr if nothing has been published since the map was last empty
+		Snapshot Get(std::size_t map_index) const;
+
+		void Publish(std::size_t map_index, Snapshot snapshot);
+
+		//Called when the last player leaves, nobody polls an empty map
+		void Invalidate(std::size_t map_index);
+
+		//Called on the map's strand when the state changes outside of a tick (joins, player actions).
+		//The published snapshot stays readable. Returns true only for the first change since the last
+		//publish, so a burst of changes schedules a single rebuild
+		bool MarkChanged(std::size_t map_index);
+
+	private:
+		//Deque never moves its elements, atomics can't be moved
+		std::deque<std::atomic<Snapshot>> slots_;
+
+		//Only touched on the map's strand
+		std::deque<bool> changed_;
+	};
+}
@@ -0,0 +1,367 @@
+#include "static_cache.h"
+#include "content_type.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+namespace http_handler
+{
+	namespace
+	{
+		int HexValue(char c)
+		{
+			if (c >= '0' && c <= '9')
+			{
+				return c - '0';
+			}
+
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+			if (c >= 'a' && c <= 'f')
+			{
+				return c - 'a' + 10;
+			}
+
+			return -1;
+		}
+
+		void LogStaticError(std::string_view code, const std::string& message)
+		{
+			json::object logger_data{ {"code", code}, {"exception", message} };
+			BOOST_LOG_TRIVIAL(info) << logging::add_value(timestamp, pt::microsec_clock::local_time()) << logging::add_value(additional_data, logger_data) << "error"sv;
+		}
+	}
+
+	std::optional<std::string> NormalizeStaticPath(std::string_view target)
+	{
+		//Query and fragment have nothing to do with the file, load_simulator.html relies on that
+		target = target.substr(0, target.find_first_of("?#"));
+
+		std::string decoded;
+		decoded.reserve(target.size());
+
+		for (size_t i = 0; i < target.size(); ++i)
+		{
+			if (target[i] != '%')
+			{
+				decoded.push_back(target[i]);
+				continue;
+			}
+
+			if (i + 2 >= target.size())
+			{
+				return std::nullopt;
+			}
+
+			int high = HexValue(target[i + 1]);
+			int low = HexValue(target[i + 2]);
+
+			if (high < 0 || low < 0 || (high == 0 && low == 0))
+			{
+				return std::nullopt;
+			}
+
+			decoded.push_back(static_cast<char>(high * 16 + low));
+			i += 2;
+		}
+
+		std::vector<std::string_view> segments;
+		std::string_view rest = decoded;
+		bool is_directory = true;
+
+		while (!rest.empty())
+		{
+			size_t slash = rest.find('/');
+			std::string_view segment = rest.substr(0, slash);
+			rest = slash == std::string_view::npos ? std::string_view{} : rest.substr(slash + 1);
+
+			//Trailing slash (or a path ending with a dot segment) points to a directory
+			is_directory = slash != std::string_view::npos || segment == "." || segment == "..";
+
+			if (segment.empty() || segment == ".")
+			{
+				continue;
+			}
+
+			if (segment == "..")
+			{
+				if (segments.empty())
+				{
+					return std::nullopt;
+				}
+
+				segments.pop_back();
+				continue;
+			}
+
+			segments.push_back(segment);
+		}
+
+		std::string result;
+
+		for (std::string_view segment : segments)
+		{
+			result.append(segment);
+			result.push_back('/');
+		}
+
+		if (is_directory)
+		{
+			result.append("index.html");
+		}
+		else
+		{
+			result.pop_back();
+		}
+
+		return result;
+	}
+
+	StaticCache::StaticCache(const fs::path& root, std::uintmax_t max_file_size)
+		: root_(fs::weakly_canonical(root)),
+		max_file_size_(max_file_size)
+	{
+		LoadDirectory(root_);
+	}
+
+	std::shared_ptr<const StaticAsset> StaticCache::Find(const std::string& key) const
+	{
+		std::shared_lock lock{ mutex_ };
+
+		if (auto iter = assets_.find(key); iter != assets_.end())
+		{
+			return iter->second;
+		}
+
+		//Directory requested without the trailing slash
+		if (auto iter = assets_.find(key + "/index.html"); iter != assets_.end())
+		{
+			return iter->second;
+		}
+
+		return nullptr;
+	}
+
+	void StaticCache::LoadDirectory(const fs::path& dir)
+	{
+		std::error_code ec;
+
+		for (auto iter = fs::recursive_directory_iterator(dir, ec); !ec && iter != fs::recursive_directory_iterator(); iter.increment(ec))
+		{
+			LoadFile(iter->path());
+		}
+
+		if (ec)
+		{
+			LogStaticError("dirCheckError"sv, ec.message());
+		}
+	}
+
+	void StaticCache::LoadFile(const fs::path& file)
+	{
+		std::error_code ec;
+
+		//Symlinks are left to the disk path, it checks where they point to
+		if (!fs::is_regular_file(fs::symlink_status(file, ec)))
+		{
+			return;
+		}
+
+		std::uintmax_t size = fs::file_size(file, ec);
+		fs::file_time_type write_time = fs::last_write_time(file, ec);
+
+		if (ec || size > max_file_size_)
+		{
+			Forget(file);
+			return;
+		}
+
+		std::string contents(size, '\0');
+		std::ifstream stream(file, std::ios::binary);
+
+		if (!stream.read(contents.data(), contents.size()))
+		{
+			LogStaticError("fileLoadingError"sv, file.string());
+			Forget(file);
+			return;
+		}
+
+		std::string extension = file.extension().string();
+
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+			{
+				return std::tolower(c);
+			});
+
+		auto asset = std::make_shared<StaticAsset>();
+		asset->body = MakeCachedBody(std::move(contents));
+		asset->content_type = GetContentType(extension);
+
+		auto system_time = std::chrono::file_clock::to_sys(write_time);
+		asset->last_modified = FormatHttpDate(std::chrono::system_clock::to_time_t(std::chrono::time_point_cast<std::chrono::system_clock::duration>(system_time)));
+
+		std::string key = MakeKey(file);
+
+		std::unique_lock lock{ mutex_ };
+		assets_[std::move(key)] = std::move(asset);
+	}
+
+	void StaticCache::Forget(const fs::path& path)
+	{
+		std::string key = MakeKey(path);
+		std::string prefix = key + "/";
+
+		std::unique_lock lock{ mutex_ };
+
+		if (path == root_)
+		{
+			assets_.clear();
+			return;
+		}
+
+		std::erase_if(assets_, [&key, &prefix](const auto& entry)
+			{
+				return entry.first == key || entry.first.starts_with(prefix);
+			});
+	}
+
+	std::string StaticCache::MakeKey(const fs::path& path) const
+	{
+		return path.lexically_relative(root_).generic_string();
+	}
+
+#ifdef __linux__
+
+	namespace
+	{
+		constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+	}
+
+	void StaticCache::Watch(net::io_context& ioc)
+	{
+		inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+		if (inotify_fd_ < 0)
+		{
+			LogStaticError("inotifyError"sv, std::strerror(errno));
+			return;
+		}
+
+		inotify_stream_ = std::make_unique<net::posix::stream_descriptor>(ioc, inotify_fd_);
+
+		AddWatch(root_);
+
+		std::error_code ec;
+
+		for (auto iter = fs::recursive_directory_iterator(root_, ec); !ec && iter != fs::recursive_directory_iterator(); iter.increment(ec))
+		{
+			if (iter->is_directory(ec))
+			{
+				AddWatch(iter->path());
+			}
+		}
+
+		ReadEvents();
+	}
+
+	void StaticCache::AddWatch(const fs::path& dir)
+	{
+		int wd = inotify_add_watch(inotify_fd_, dir.c_str(), WATCH_MASK);
+
+		if (wd < 0)
+		{
+			LogStaticError("inotifyError"sv, dir.string());
+			return;
+		}
+
+		watched_dirs_[wd] = dir;
+	}
+
+	void StaticCache::ReadEvents()
+	{
+		inotify_stream_->async_read_some(net::buffer(event_buffer_), [this](const boost::system::error_code& ec, std::size_t bytes_read)
+			{
+				if (ec)
+				{
+					if (ec != net::error::operation_aborted)
+					{
+						LogStaticError("inotifyError"sv, ec.message());
+					}
+
+					return;
+				}
+
+				HandleEvents(bytes_read);
+				ReadEvents();
+			});
+	}
+
+	void StaticCache::HandleEvents(std::size_t bytes_read)
+	{
+		for (std::size_t offset = 0; offset < bytes_read;)
+		{
+			const auto* event = reinterpret_cast<const inotify_event*>(event_buffer_.data() + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				//Some events were lost, the only safe thing is to start over
+				Forget(root_);
+				LoadDirectory(root_);
+				continue;
+			}
+
+			if (event->mask & IN_IGNORED)
+			{
+				watched_dirs_.erase(event->wd);
+				continue;
+			}
+
+			auto dir = watched_dirs_.find(event->wd);
+
+			if (dir == watched_dirs_.end() || event->len == 0)
+			{
+				continue;
+			}
+
+			fs::path path = dir->second / event->name;
+
+			if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+			{
+				Forget(path);
+			}
+			else if (event->mask & IN_ISDIR)
+			{
+				//New directory, its files might be already there by the time we get here
+				AddWatch(path);
+				LoadDirectory(path);
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				LoadFile(path);
+			}
+		}
+	}
+
+#else
+
+	void StaticCache::Watch(net::io_context&)
+	{
+		//Files are only loaded at startup on platforms without inotify
+	}
+
+	void StaticCache::AddWatch(const fs::path&) {}
+	void StaticCache::ReadEvents() {}
+	void StaticCache::HandleEvents(std::size_t) {}
+
+#endif
+}
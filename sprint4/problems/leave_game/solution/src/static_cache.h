@@ -0,0 +1,77 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "response_cache.h"
+
+namespace http_handler
+{
+	namespace fs = std::filesystem;
+	namespace net = boost::asio;
+
+	struct StaticAsset
+	{
+		CachedBody body;
+		std::string_view content_type;
+		std::string last_modified;
+	};
+
+	//Turns request target into a path relative to the static root: drops query and fragment,
+	//decodes %XX sequences and resolves dot segments. Directories are mapped to their index.html.
+	//Returns std::nullopt if the path is malformed or leaves the root
+	std::optional<std::string> NormalizeStaticPath(std::string_view target);
+
+	//Keeps the whole static tree in memory, so the common case doesn't touch the disk at all.
+	//On Linux the tree is watched with inotify and changed files are reloaded on the fly
+	class StaticCache
+	{
+	public:
+		constexpr static std::uintmax_t DEFAULT_MAX_FILE_SIZE = 16 * 1024 * 1024;
+
+		explicit StaticCache(const fs::path& root, std::uintmax_t max_file_size = DEFAULT_MAX_FILE_SIZE);
+
+		StaticCache(const StaticCache&) = delete;
+		StaticCache& operator=(const StaticCache&) = delete;
+
+		//Takes a key made by NormalizeStaticPath. Returns nullptr if the file isn't cached
+		std::shared_ptr<const StaticAsset> Find(const std::string& key) const;
+
+		//Starts listening for file changes. Events are handled on the given io_context
+		void Watch(net::io_context& ioc);
+
+	private:
+		void LoadDirectory(const fs::path& dir);
+		void LoadFile(const fs::path& file);
+
+		//Removes the file, or every file under the directory
+		void Forget(const fs::path& path);
+
+		std::string MakeKey(const fs::path& path) const;
+
+		void AddWatch(const fs::path& dir);
+		void ReadEvents();
+		void HandleEvents(std::size_t bytes_read);
+
+		fs::path root_;
+		std::uintmax_t max_file_size_;
+
+		mutable std::shared_mutex mutex_;
+		std::unordered_map<std::string, std::shared_ptr<const StaticAsset>> assets_;
+
+		int inotify_fd_ = -1;
+		std::unique_ptr<net::posix::stream_descriptor> inotify_stream_;
+		std::unordered_map<int, fs::path> watched_dirs_;
+		alignas(8) std::array<char, 16 * 1024> event_buffer_;
+	};
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include "slot_map.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+	//Deadlines keyed by tick, for timers that are mostly cancelled or pushed back before they fire.
+	//Levels of 64 buckets, a bucket of level l spans 64^l ticks. A timer sits on the coarsest level its
+	//distance allows and drops a level each time the wheel reaches its bucket, so scheduling and cancelling
+	//are O(1) and advancing costs the timers that fire plus a few steps per occupied bucket passed
+	template <typename T>
+	class TimingWheel
+	{
+	public:
+		using Tick = std::uint64_t;
+		using Timer = SlotKey;
+
+		explicit TimingWheel(Tick now = 0)
+			:now_(now) {}
+
+		//A deadline not after the current tick fires on the next Advance
+		Timer Schedule(Tick deadline, T value)
+		{
+			Timer timer = entries_.Emplace(Entry{ std::max(deadline, now_ + 1), std::move(value) });
+
+			Place(timer);
+
+			return timer;
+		}
+
+		//Returns false if the timer has fired or was cancelled already
+		bool Cancel(Timer timer)
+		{
+			Entry* entry = entries_.Find(timer);
+
+			if (entry == nullptr)
+			{
+				return false;
+			}
+
+			Unlink(*entry);
+			entries_.Erase(timer);
+
+			return true;
+		}
+
+		bool IsPending(Timer timer) const
+		{
+			return entries_.Contains(timer);
+		}
+
+		//Last tick the wheel was advanced to
+		Tick GetNow() const
+		{
+			return now_;
+		}
+
+		std::size_t Size() const
+		{
+			return entries_.Size();
+		}
+
+		//Moves the wheel up to the given tick and calls fn(value) for every timer due by then, earlier
+		//deadlines first. fn may schedule and cancel timers, but not advance the wheel
+		template <typename Fn>
+		void Advance(Tick to, Fn&& fn)
+		{
+			while (now_ < to)
+			{
+				if (entries_.Empty())
+				{
+					now_ = to;
+					return;
+				}
+
+				now_ = std::min(NextStop(), to);
+
+				for (std::size_t level = LEVELS - 1; level > 0; --level)
+				{
+					if (now_ % (Tick{ 1 } << (level * BITS)) == 0)
+					{
+						for (Timer timer : Drain(level))
+						{
+							if (entries_.Contains(timer))
+							{
+								Place(timer);
+							}
+						}
+					}
+				}
+
+				for (Timer timer : Drain(0))
+				{
+					Entry* entry = entries_.Find(timer);
+
+					if (entry == nullptr)
+					{
+						continue;
+					}
+
+					//Too far for the wheel when scheduled, it went round once more
+					if (entry->deadline > now_)
+					{
+						Place(timer);
+						continue;
+					}
+
+					T value = std::move(entry->value);
+					entries_.Erase(timer);
+
+					fn(std::move(value));
+				}
+			}
+		}
+
+	private:
+		static constexpr std::size_t BITS = 6;
+		static constexpr std::size_t SLOTS = std::size_t{ 1 } << BITS;
+		static constexpr std::size_t LEVELS = 6;
+
+		//About 800 days of milliseconds
+		static constexpr Tick HORIZON = Tick{ 1 } << (LEVELS * BITS);
+
+		static constexpr std::uint32_t NO_BUCKET = ~std::uint32_t{ 0 };
+
+		struct Entry
+		{
+			Tick deadline;
+			T value;
+
+			//Level * SLOTS + slot, and the position in that bucket
+			std::uint32_t bucket = NO_BUCKET;
+			std::uint32_t pos = 0;
+		};
+
+		void Place(Timer timer)
+		{
+			Entry& entry = *entries_.Find(timer);
+
+			const Tick delta = std::min(entry.deadline > now_ ? entry.deadline - now_ : 0, HORIZON - 1);
+			const std::size_t level = delta == 0 ? 0 : (std::bit_width(delta) - 1) / BITS;
+			const std::size_t slot = ((now_ + delta) >> (level * BITS)) & (SLOTS - 1);
+
+			std::vector<Timer>& bucket = buckets_[level * SLOTS + slot];
+
+			entry.bucket = static_cast<std::uint32_t>(level * SLOTS + slot);
+			entry.pos = static_cast<std::uint32_t>(bucket.size());
+
+			bucket.push_back(timer);
+			masks_[level] |= std::uint64_t{ 1 } << slot;
+		}
+
+		void Unlink(Entry& entry)
+		{
+			if (entry.bucket == NO_BUCKET)
+			{
+				return;
+			}
+
+			std::vector<Timer>& bucket = buckets_[entry.bucket];
+
+			bucket[entry.pos] = bucket.back();
+			entries_.Find(bucket[entry.pos])->pos = entry.pos;
+			bucket.pop_back();
+
+			if (bucket.empty())
+			{
+				masks_[entry.bucket / SLOTS] &= ~(std::uint64_t{ 1 } << (entry.bucket % SLOTS));
+			}
+
+			entry.bucket = NO_BUCKET;
+		}
+
+		//Empties the bucket the current tick points at on the level. Its timers are detached from
+		//any bucket until placed again, so cancelling them meanwhile is safe
+		const std::vector<Timer>& Drain(std::size_t level)
+		{
+			const std::size_t slot = (now_ >> (level * BITS)) & (SLOTS - 1);
+
+			drained_.clear();
+			drained_.swap(buckets_[level * SLOTS + slot]);
+			masks_[level] &= ~(std::uint64_t{ 1 } << slot);
+
+			for (Timer timer : drained_)
+			{
+				entries_.Find(timer)->bucket = NO_BUCKET;
+			}
+
+			return drained_;
+		}
+
+		//Earliest tick after now that has a bucket to fire or cascade. Up to the end of its current
+		//round a level only needs its occupied slots visited, past it the next level takes over
+		Tick NextStop() const
+		{
+			for (std::size_t level = 0; level < LEVELS; ++level)
+			{
+				const std::size_t shift = level * BITS;
+				const Tick slot = (now_ >> shift) & (SLOTS - 1);
+				const Tick round = (now_ >> shift) - slot;
+
+				if (masks_[level] == 0)
+				{
+					continue;
+				}
+
+				const std::uint64_t later = slot + 1 == SLOTS ? 0 : masks_[level] & (~std::uint64_t{ 0 } << (slot + 1));
+
+				if (later != 0)
+				{
+					return (round + std::countr_zero(later)) << shift;
+				}
+
+				//The rest waits for the next round, which starts with a cascade from the level above
+				return (round + SLOTS) << shift;
+			}
+
+			return now_ + 1;
+		}
+
+		SlotMap<Entry> entries_;
+
+		std::array<std::vector<Timer>, LEVELS * SLOTS> buckets_;
+
+		//Occupied buckets of every level, one bit per slot
+		std::array<std::uint64_t, LEVELS> masks_{};
+
+		Tick now_;
+
+		//Bucket being emptied, kept to avoid allocating on every tick
+		std::vector<Timer> drained_;
+	};
+}
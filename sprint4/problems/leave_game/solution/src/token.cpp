@@ -0,0 +1,198 @@
+#include "token.h"
+
+#include <array>
+#include <random>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/random.h>
+#include <cerrno>
+#endif
+
+namespace model
+{
+	namespace
+	{
+		constexpr std::array<std::int8_t, 256> MakeHexTable()
+		{
+			std::array<std::int8_t, 256> table{};
+
+			for (auto& value : table)
+			{
+				value = -1;
+			}
+
+			for (int i = 0; i < 10; ++i)
+			{
+				table['0' + i] = static_cast<std::int8_t>(i);
+			}
+
+			for (int i = 0; i < 6; ++i)
+			{
+				table['a' + i] = static_cast<std::int8_t>(10 + i);
+				table['A' + i] = static_cast<std::int8_t>(10 + i);
+			}
+
+			return table;
+		}
+
+		constexpr std::array<std::int8_t, 256> HEX_VALUES = MakeHexTable();
+
+		//Two hex digits for every byte value
+		constexpr std::array<std::array<char, 2>, 256> MakeByteTable()
+		{
+			constexpr char hex_chars[] = "0123456789abcdef";
+
+			std::array<std::array<char, 2>, 256> table{};
+
+			for (int i = 0; i < 256; ++i)
+			{
+				table[i] = { hex_chars[i >> 4], hex_chars[i & 0xF] };
+			}
+
+			return table;
+		}
+
+		constexpr std::array<std::array<char, 2>, 256> HEX_BYTES = MakeByteTable();
+
+		bool ParseHalf(std::string_view hex, std::uint64_t& result)
+		{
+			result = 0;
+			int invalid = 0;
+
+			for (unsigned char c : hex)
+			{
+				std::int8_t value = HEX_VALUES[c];
+				invalid |= value;
+				result = (result << 4) | static_cast<std::uint64_t>(value & 0xF);
+			}
+
+			//Negative values (-1) set the sign bit
+			return invalid >= 0;
+		}
+
+		void FormatHalf(std::uint64_t value, char* out)
+		{
+			for (int i = 14; i >= 0; i -= 2)
+			{
+				const std::array<char, 2>& digits = HEX_BYTES[value & 0xFF];
+				out[i] = digits[0];
+				out[i + 1] = digits[1];
+				value >>= 8;
+			}
+		}
+
+		//Tokens come from the kernel CSPRNG, so seeing some of them tells nothing about the others.
+		//The thread fetches them in blocks, and a token is a single 128-bit draw from the block
+		class TokenGenerator
+		{
+		public:
+			Token operator()()
+			{
+				if (next_ == words_.size())
+				{
+					Refill();
+					next_ = 0;
+				}
+
+				Token token{ words_[next_], words_[next_ + 1] };
+
+				//Handed out tokens don't stay behind in memory
+				words_[next_] = words_[next_ + 1] = 0;
+				next_ += 2;
+
+				return token;
+			}
+
+		private:
+			//256 bytes, getrandom never returns less than that without an error
+			static constexpr std::size_t BLOCK_TOKENS = 16;
+
+			void Refill()
+			{
+#ifdef __linux__
+				auto* data = reinterpret_cast<unsigned char*>(words_.data());
+				std::size_t filled = 0;
+
+				while (filled < sizeof(words_))
+				{
+					ssize_t got = ::getrandom(data + filled, sizeof(words_) - filled, 0);
+
+					if (got < 0)
+					{
+						if (errno == EINTR)
+						{
+							continue;
+						}
+
+						throw std::system_error(errno, std::system_category(), "getrandom");
+					}
+
+					filled += static_cast<std::size_t>(got);
+				}
+#else
+				//Backed by the OS generator wherever getrandom is missing
+				std::random_device device;
+
+				for (std::uint64_t& word : words_)
+				{
+					word = (static_cast<std::uint64_t>(device()) << 32) | device();
+				}
+#endif
+			}
+
+			std::array<std::uint64_t, BLOCK_TOKENS * 2> words_{};
+			std::size_t next_ = BLOCK_TOKENS * 2;
+		};
+	}
+
+	std::optional<Token> ParseToken(std::string_view hex)
+	{
+		Token token;
+
+		if (hex.size() != TOKEN_HEX_SIZE || !ParseHalf(hex.substr(0, 16), token.high) || !ParseHalf(hex.substr(16), token.low))
+		{
+			return std::nullopt;
+		}
+
+		return token;
+	}
+
+	std::optional<Token> ParseBearerToken(std::string_view authorization)
+	{
+		constexpr std::string_view scheme = "bearer ";
+
+		if (authorization.size() < scheme.size())
+		{
+			return std::nullopt;
+		}
+
+		//Auth scheme is case-insensitive
+		for (size_t i = 0; i < scheme.size(); ++i)
+		{
+			if ((authorization[i] | 0x20) != scheme[i])
+			{
+				return std::nullopt;
+			}
+		}
+
+		return ParseToken(authorization.substr(scheme.size()));
+	}
+
+	std::string FormatToken(Token token)
+	{
+		std::string result(TOKEN_HEX_SIZE, '0');
+
+		FormatHalf(token.high, result.data());
+		FormatHalf(token.low, result.data() + 16);
+
+		return result;
+	}
+
+	Token GenerateToken()
+	{
+		thread_local TokenGenerator generator;
+
+		return generator();
+	}
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace model
+{
+	//Player token: 32 hex digits packed into 128 bits
+	struct Token
+	{
+		std::uint64_t high = 0;
+		std::uint64_t low = 0;
+
+		auto operator<=>(const Token&) const = default;
+	};
+
+	constexpr std::size_t TOKEN_HEX_SIZE = 32;
+
+	//Accepts both cases. Returns std::nullopt unless hex is exactly 32 hex digits
+	std::optional<Token> ParseToken(std::string_view hex);
+
+	//Parses the value of the Authorization header, "Bearer <token>"
+	std::optional<Token> ParseBearerToken(std::string_view authorization);
+
+	//32 lowercase hex digits
+	std::string FormatToken(Token token);
+
+	//128 bits from the OS CSPRNG (getrandom on Linux), buffered per thread
+	Token GenerateToken();
+
+	//Flat open addressing table with linear probing. Erase shifts the following
+	//entries back instead of leaving tombstones, so lookups never slow down with churn
+	template <typename Value>
+	class TokenIndex
+	{
+	public:
+		const Value* Find(Token token) const
+		{
+			if (slots_.empty())
+			{
+				return nullptr;
+			}
+
+			for (std::size_t i = Home(token);; i = (i + 1) & Mask())
+			{
+				const Slot& slot = slots_[i];
+
+				if (!slot.used)
+				{
+					return nullptr;
+				}
+
+				if (slot.token == token)
+				{
+					return &slot.value;
+				}
+			}
+		}
+
+		//Returns false if the token is already there
+		bool Insert(Token token, Value value)
+		{
+			if ((size_ + 1) * 4 > slots_.size() * 3)
+			{
+				Rehash(slots_.empty() ? MIN_CAPACITY : slots_.size() * 2);
+			}
+
+			std::size_t i = Home(token);
+
+			for (; slots_[i].used; i = (i + 1) & Mask())
+			{
+				if (slots_[i].token == token)
+				{
+					return false;
+				}
+			}
+
+			slots_[i] = { token, std::move(value), true };
+			++size_;
+
+			return true;
+		}
+
+		bool Erase(Token token)
+		{
+			if (slots_.empty())
+			{
+				return false;
+			}
+
+			std::size_t hole = Home(token);
+
+			for (; slots_[hole].token != token; hole = (hole + 1) & Mask())
+			{
+				if (!slots_[hole].used)
+				{
+					return false;
+				}
+			}
+
+			if (!slots_[hole].used)
+			{
+				return false;
+			}
+
+			//Moving back everything that would not be found past the hole
+			for (std::size_t i = (hole + 1) & Mask(); slots_[i].used; i = (i + 1) & Mask())
+			{
+				std::size_t home = Home(slots_[i].token);
+
+				//Entry stays if its home is cyclically in (hole, i]
+				if (((i - home) & Mask()) < ((i - hole) & Mask()))
+				{
+					continue;
+				}
+
+				slots_[hole] = std::move(slots_[i]);
+				hole = i;
+			}
+
+			slots_[hole] = {};
+			--size_;
+
+			return true;
+		}
+
+		std::size_t Size() const
+		{
+			return size_;
+		}
+
+	private:
+		static constexpr std::size_t MIN_CAPACITY = 64;
+
+		struct Slot
+		{
+			Token token;
+			Value value{};
+			bool used = false;
+		};
+
+		std::size_t Mask() const
+		{
+			return slots_.size() - 1;
+		}
+
+		std::size_t Home(Token token) const
+		{
+			//Generated tokens are random already, the mix only guards against hand-made ones
+			std::uint64_t hash = (token.low ^ (token.high * 0x9E3779B97F4A7C15ull));
+			hash ^= hash >> 32;
+
+			return static_cast<std::size_t>(hash) & Mask();
+		}
+
+		void Rehash(std::size_t capacity)
+		{
+			std::vector<Slot> old = std::exchange(slots_, std::vector<Slot>(capacity));
+			size_ = 0;
+
+			for (Slot& slot : old)
+			{
+				if (slot.used)
+				{
+					Insert(slot.token, std::move(slot.value));
+				}
+			}
+		}
+
+		std::vector<Slot> slots_;
+		std::size_t size_ = 0;
+	};
+}
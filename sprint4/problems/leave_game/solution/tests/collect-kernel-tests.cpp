@@ -0,0 +1,155 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/collision_detector.h"
+
+#include <random>
+
+using namespace collision_detector;
+
+namespace
+{
+    struct Columns
+    {
+        std::vector<double> x, y, width;
+
+        ItemColumns View() const
+        {
+            return { x, y, width };
+        }
+    };
+
+    Columns GenerateColumns(size_t count, double size, std::mt19937& random)
+    {
+        std::uniform_real_distribution<double> coord{ 0, size };
+        std::uniform_int_distribution<int> width{ 0, 4 };
+
+        Columns columns;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            columns.x.push_back(coord(random));
+            columns.y.push_back(coord(random));
+            columns.width.push_back(width(random) * 0.1);
+        }
+
+        return columns;
+    }
+
+    //Kernels this CPU can run, narrowest first
+    std::vector<CollectKernel> RunnableKernels()
+    {
+        std::vector<CollectKernel> kernels{ CollectKernel::SCALAR };
+
+        if (BestCollectKernel() != CollectKernel::SCALAR)
+        {
+            kernels.push_back(CollectKernel::SSE2);
+        }
+
+        if (BestCollectKernel() == CollectKernel::AVX2)
+        {
+            kernels.push_back(CollectKernel::AVX2);
+        }
+
+        return kernels;
+    }
+
+    std::vector<CollectionHit> CollectOneByOne(const Gatherer& gatherer, const Columns& columns)
+    {
+        std::vector<CollectionHit> hits;
+
+        for (size_t i = 0; i < columns.x.size(); ++i)
+        {
+            CollectionResult result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, { columns.x[i], columns.y[i] });
+
+            if (result.IsCollected(gatherer.width + columns.width[i]))
+            {
+                hits.push_back({ i, result.sq_distance, result.proj_ratio });
+            }
+        }
+
+        return hits;
+    }
+}
+
+TEST_CASE("Batched narrowphase matches TryCollectPoint")
+{
+    std::mt19937 random{ 42 };
+    std::uniform_real_distribution<double> coord{ 0, 20 };
+
+    //Odd length, so every kernel has a scalar tail to finish
+    Columns columns = GenerateColumns(1'003, 20, random);
+
+    for (CollectKernel kernel : RunnableKernels())
+    {
+        for (int g = 0; g < 200; ++g)
+        {
+            Gatherer gatherer{ { coord(random), coord(random) }, { coord(random), coord(random) }, 0.3 };
+
+            std::vector<CollectionHit> expected = CollectOneByOne(gatherer, columns);
+            std::vector<CollectionHit> batched;
+
+            TryCollectPoints(kernel, gatherer, columns.View(), batched);
+
+            REQUIRE(batched.size() == expected.size());
+
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                CHECK(batched[i].item_id == expected[i].item_id);
+                CHECK(batched[i].sq_distance == expected[i].sq_distance);
+                CHECK(batched[i].proj_ratio == expected[i].proj_ratio);
+            }
+        }
+    }
+}
+
+TEST_CASE("Batched narrowphase handles the edges of the segment")
+{
+    Columns columns{ { 0, 10, 5, 5, 5, -0.1, 11 }, { 0, 0, 0.5, 0.51, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0 } };
+    Gatherer gatherer{ { 0, 0 }, { 10, 0 }, 0.5 };
+
+    for (CollectKernel kernel : RunnableKernels())
+    {
+        std::vector<CollectionHit> hits;
+
+        TryCollectPoints(kernel, gatherer, columns.View(), hits);
+
+        //Both ends and the exact radius are in, just past any of them is out
+        REQUIRE(hits.size() == 4);
+        CHECK(hits[0].item_id == 0);
+        CHECK(hits[0].proj_ratio == 0);
+        CHECK(hits[1].item_id == 1);
+        CHECK(hits[1].proj_ratio == 1);
+        CHECK(hits[2].item_id == 2);
+        CHECK(hits[3].item_id == 4);
+        CHECK(hits[3].sq_distance == 0);
+    }
+}
+
+TEST_CASE("Narrowphase over 10k items", "[!benchmark]")
+{
+    std::mt19937 random{ 7 };
+
+    Columns columns = GenerateColumns(10'000, 1'000, random);
+    Gatherer gatherer{ { 100, 100 }, { 900, 850 }, 0.3 };
+
+    BENCHMARK("TryCollectPoint one by one")
+    {
+        return CollectOneByOne(gatherer, columns).size();
+    };
+
+    std::vector<CollectionHit> hits;
+
+    for (CollectKernel kernel : RunnableKernels())
+    {
+        const char* name = kernel == CollectKernel::AVX2 ? "AVX2 kernel" : kernel == CollectKernel::SSE2 ? "SSE2 kernel" : "scalar kernel";
+
+        BENCHMARK(name)
+        {
+            hits.clear();
+            TryCollectPoints(kernel, gatherer, columns.View(), hits);
+
+            return hits.size();
+        };
+    }
+}
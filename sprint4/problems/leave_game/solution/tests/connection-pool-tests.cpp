@@ -0,0 +1,295 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/DB_manager.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace
+{
+    struct FakeConnection
+    {
+        bool is_open() const
+        {
+            return open;
+        }
+
+        void prepare(const std::string& name, const std::string& sql)
+        {
+            if (refuse_prepare)
+            {
+                open = false;
+                throw std::runtime_error("server closed the connection");
+            }
+
+            if (sql == "BAD")
+            {
+                throw std::runtime_error("syntax error");
+            }
+
+            prepared.push_back(name);
+        }
+
+        bool open = true;
+        bool refuse_prepare = false;
+        std::vector<std::string> prepared;
+    };
+
+    using Pool = db::BasicConnectionPool<FakeConnection>;
+}
+
+TEST_CASE("Connection pool grows under load and shrinks when idle")
+{
+    int opened = 0;
+    Pool pool{ 1, 3, [&opened]
+        {
+            ++opened;
+            return std::make_shared<FakeConnection>();
+        } };
+
+    CHECK(opened == 1);
+    CHECK(pool.GetStats().size == 1);
+
+    {
+        Pool::ConnectionWrapper first = pool.GetConnection();
+        Pool::ConnectionWrapper second = pool.GetConnection();
+        Pool::ConnectionWrapper third = pool.GetConnection();
+
+        CHECK(opened == 3);
+        CHECK(pool.GetStats().size == 3);
+        CHECK(pool.GetStats().idle == 0);
+        CHECK(first.GetId() != second.GetId());
+        CHECK(second.GetId() != third.GetId());
+    }
+
+    CHECK(pool.GetStats().idle == 3);
+
+    SECTION("the most recently used connection goes out first")
+    {
+        std::uint64_t id = 0;
+
+        {
+            Pool::ConnectionWrapper wrap = pool.GetConnection();
+            id = wrap.GetId();
+        }
+
+        Pool::ConnectionWrapper again = pool.GetConnection();
+
+        CHECK(again.GetId() == id);
+        CHECK(opened == 3);
+    }
+
+    SECTION("connections idle past the timeout are closed down to the minimum")
+    {
+        pool.SetIdleTimeout(0ms);
+        std::this_thread::sleep_for(1ms);
+
+        {
+            Pool::ConnectionWrapper wrap = pool.GetConnection();
+        }
+
+        CHECK(pool.GetStats().size == 1);
+        CHECK(pool.GetStats().trimmed == 2);
+    }
+}
+
+TEST_CASE("Connection pool prepares registered statements once per connection")
+{
+    int opened = 0;
+    Pool pool{ 1, 2, [&opened]
+        {
+            ++opened;
+            return std::make_shared<FakeConnection>();
+        } };
+
+    pool.Prepare("records_page", "SELECT 1");
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+        CHECK(wrap->prepared == std::vector<std::string>{ "records_page" });
+    }
+
+    pool.Prepare("best_record", "SELECT 2");
+
+    {
+        Pool::ConnectionWrapper old_one = pool.GetConnection();
+        Pool::ConnectionWrapper new_one = pool.GetConnection();
+
+        //Only what was registered since its last checkout
+        CHECK(old_one->prepared == std::vector<std::string>{ "records_page", "best_record" });
+        CHECK(new_one->prepared == std::vector<std::string>{ "records_page", "best_record" });
+    }
+
+    Pool::ConnectionWrapper wrap = pool.GetConnection();
+    CHECK(wrap->prepared.size() == 2);
+}
+
+TEST_CASE("Connection pool replaces broken connections")
+{
+    int opened = 0;
+    Pool pool{ 1, 1, [&opened]
+        {
+            ++opened;
+            return std::make_shared<FakeConnection>();
+        } };
+
+    pool.Prepare("records_page", "SELECT 1");
+
+    std::uint64_t broken_id = 0;
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+        broken_id = wrap.GetId();
+        wrap->open = false;
+    }
+
+    CHECK(pool.GetStats().dropped == 1);
+    CHECK(pool.GetStats().size == 0);
+
+    FakeConnection* idle = nullptr;
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+        CHECK(wrap.GetId() != broken_id);
+        CHECK(wrap->prepared == std::vector<std::string>{ "records_page" });
+
+        broken_id = wrap.GetId();
+        idle = &*wrap;
+    }
+
+    //Closed by the server while idle, noticed on the next checkout
+    idle->open = false;
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+        CHECK(wrap.GetId() != broken_id);
+        CHECK(wrap->prepared == std::vector<std::string>{ "records_page" });
+
+        wrap->refuse_prepare = true;
+    }
+
+    pool.Prepare("best_record", "SELECT 2");
+
+    //A connection that fails to prepare frees its place
+    CHECK_THROWS(pool.GetConnection());
+    CHECK(pool.GetStats().size == 0);
+
+    Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+    CHECK(wrap->prepared == std::vector<std::string>{ "records_page", "best_record" });
+    CHECK(opened == 4);
+}
+
+TEST_CASE("Connection pool drops statements the server refuses")
+{
+    Pool pool{ 1, 2, []
+        {
+            return std::make_shared<FakeConnection>();
+        } };
+
+    pool.Prepare("records_page", "SELECT 1");
+    pool.Prepare("broken", "BAD");
+    pool.Prepare("best_record", "SELECT 2");
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+        CHECK(wrap->prepared == std::vector<std::string>{ "records_page", "best_record" });
+    }
+
+    CHECK(pool.GetStats().rejected == 1);
+
+    pool.Prepare("records_above", "SELECT 3");
+
+    //Neither the old connection nor a new one tries it again
+    Pool::ConnectionWrapper old_one = pool.GetConnection();
+    Pool::ConnectionWrapper new_one = pool.GetConnection();
+
+    CHECK(old_one->prepared == std::vector<std::string>{ "records_page", "best_record", "records_above" });
+    CHECK(new_one->prepared == std::vector<std::string>{ "records_page", "best_record", "records_above" });
+    CHECK(pool.GetStats().rejected == 1);
+}
+
+TEST_CASE("Connection pool keeps the session timeout with the connection")
+{
+    Pool pool{ 1, 1, []
+        {
+            return std::make_shared<FakeConnection>();
+        } };
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+        CHECK(wrap.GetSessionTimeout() == 0ms);
+        wrap.SetSessionTimeout(250ms);
+    }
+
+    {
+        Pool::ConnectionWrapper wrap = pool.GetConnection();
+
+        CHECK(wrap.GetSessionTimeout() == 250ms);
+        wrap->open = false;
+    }
+
+    //Gone with the broken connection
+    Pool::ConnectionWrapper wrap = pool.GetConnection();
+    CHECK(wrap.GetSessionTimeout() == 0ms);
+}
+
+TEST_CASE("Prepared against unprepared round trips", "[!benchmark]")
+{
+    //Needs a local Postgres with the game's table, like the server itself
+    const char* db_url = std::getenv("GAME_DB_URL");
+
+    if (db_url == nullptr)
+    {
+        WARN("GAME_DB_URL is not set, nothing to measure");
+        return;
+    }
+
+    db::ConnectionPool pool{ 1, [db_url]
+        {
+            return std::make_shared<pqxx::connection>(db_url);
+        } };
+
+    constexpr auto RECORDS_PAGE = "SELECT name, score, play_time_ms FROM retired_players ORDER BY score DESC, play_time_ms, name LIMIT $1 OFFSET $2;"_zv;
+
+    {
+        db::ConnectionPool::ConnectionWrapper wrap = pool.GetConnection();
+        pqxx::nontransaction check{ *wrap };
+
+        if (!check.query_value<bool>("SELECT to_regclass('retired_players') IS NOT NULL;"_zv))
+        {
+            WARN("retired_players doesn't exist, start the server once first");
+            return;
+        }
+    }
+
+    pool.Prepare("bench_records_page", std::string{ RECORDS_PAGE });
+
+    db::ConnectionPool::ConnectionWrapper wrap = pool.GetConnection();
+
+    BENCHMARK("unprepared page")
+    {
+        pqxx::nontransaction work{ *wrap };
+        return work.exec_params(RECORDS_PAGE, 100, 0).size();
+    };
+
+    BENCHMARK("prepared page")
+    {
+        pqxx::nontransaction work{ *wrap };
+        return work.exec_prepared("bench_records_page"_zv, 100, 0).size();
+    };
+}
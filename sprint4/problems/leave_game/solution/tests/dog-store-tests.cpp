@@ -0,0 +1,264 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "test-helpers.h"
+
+#include <vector>
+
+using namespace model;
+
+using test::Steer;
+
+namespace
+{
+    //A thousand 10 m roads end to end, so a long step crosses a thousand junctions.
+    //Roads aren't calculated yet, more of them can be added
+    Map MakeChainMap(db::ConnectionPool& pool)
+    {
+        Map map{ Map::Id{ "chain" }, "Chain", pool };
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            map.AddRoad({ Road::HORIZONTAL, { i * 10, 0 }, i * 10 + 10 });
+        }
+
+        return map;
+    }
+}
+
+TEST_CASE("Dog store")
+{
+    DogStore store;
+
+    //Horizontal road from 0 to 10 and a vertical one from 0 to 10
+    const RoadBounds horizontal{ -0.4, 10.4, -0.4, 0.4 };
+    const RoadBounds vertical{ -0.4, 0.4, -0.4, 10.4 };
+
+    DogStore::Slot east = store.Add(1, 0, 1, 'R', 0, horizontal);
+    DogStore::Slot south = store.Add(0, 9, 1, 'D', 1, vertical);
+    DogStore::Slot idle = store.Add(5, 0, 1, 'U', 0, horizontal);
+
+    store.SetVel(east, 2, 0);
+    store.SetVel(south, 0, 2);
+
+    SECTION("dogs inside their roads move in one pass")
+    {
+        CHECK(store.AdvanceStraight(0.5).empty());
+
+        CHECK(store.GetX(east) == 2);
+        CHECK(store.GetY(east) == 0);
+        CHECK(store.GetY(south) == 10);
+        CHECK(store.GetX(idle) == 5);
+    }
+
+    SECTION("dogs leaving their roads are returned untouched")
+    {
+        const std::vector<DogStore::Slot>& leaving = store.AdvanceStraight(1);
+
+        REQUIRE(leaving.size() == 1);
+        CHECK(leaving.front() == south);
+        CHECK(store.GetY(south) == 9);
+        CHECK(store.GetX(east) == 3);
+    }
+}
+
+TEST_CASE_METHOD(test::RingFixture, "Batched movement matches moving dogs one by one")
+{
+    //The same players on a copy of the map, moved with the scalar path only
+    Map reference_map = test::MakeRingMap(pool);
+
+    Players reference_players{ false };
+
+    std::vector<PlayerRef> batched_refs;
+    std::vector<PlayerRef> scalar_refs;
+
+    for (int i = 0; i < 40; ++i)
+    {
+        batched_refs.push_back(players.MakePlayer("dog", &GetMap())->GetRef());
+        scalar_refs.push_back(reference_players.MakePlayer("dog", &reference_map)->GetRef());
+    }
+
+    //Nobody joins from here on, so the pointers hold
+    std::vector<Player*> batched;
+    std::vector<Player*> scalar;
+
+    for (size_t i = 0; i < batched_refs.size(); ++i)
+    {
+        batched.push_back(players.FindPlayer(batched_refs[i]));
+        scalar.push_back(reference_players.FindPlayer(scalar_refs[i]));
+    }
+
+    for (int tick = 0; tick < 60; ++tick)
+    {
+        for (size_t i = 0; i < batched.size(); ++i)
+        {
+            if ((i + tick) % 7 == 0)
+            {
+                Steer(*batched[i], static_cast<int>(i) + tick);
+                Steer(*scalar[i], static_cast<int>(i) + tick);
+            }
+        }
+
+        players.MoveAllByMap(75, GetMap());
+
+        for (Player* player : scalar)
+        {
+            player->Move(75);
+        }
+
+        for (size_t i = 0; i < batched.size(); ++i)
+        {
+            REQUIRE(batched[i]->GetPos().x == scalar[i]->GetPos().x);
+            REQUIRE(batched[i]->GetPos().y == scalar[i]->GetPos().y);
+            REQUIRE(batched[i]->GetVel().x == scalar[i]->GetVel().x);
+            REQUIRE(batched[i]->GetVel().y == scalar[i]->GetVel().y);
+        }
+    }
+}
+
+TEST_CASE_METHOD(test::RingFixture, "Dog movement throughput", "[!benchmark]")
+{
+    constexpr int DOGS = 100'000;
+
+    for (int i = 0; i < DOGS; ++i)
+    {
+        Steer(*players.MakePlayer("dog", &GetMap()), i % 4);
+    }
+
+    DogStore& dogs = GetMap().GetDogs();
+
+    BENCHMARK("straight roads only")
+    {
+        return dogs.AdvanceStraight(0.05).size();
+    };
+
+    BENCHMARK("tick of a 50 ms period")
+    {
+        players.MoveAllByMap(50, GetMap());
+    };
+}
+
+TEST_CASE("Long steps")
+{
+    test::OfflinePool pool;
+    Map map = MakeChainMap(pool);
+
+    //A gap after the chain and a road overlapping its first one
+    map.AddRoad({ Road::HORIZONTAL, { 10'001, 0 }, 10'100 });
+    map.AddRoad({ Road::HORIZONTAL, { 5, 0 }, 30 });
+    map.AddRoad({ Road::VERTICAL, { 5'000, 0 }, 50 });
+    map.CalcRoads();
+
+    Dog dog{ { 0, 0 }, &map };
+    dog.SetVel(1, 0);
+
+    SECTION("one step crosses every junction and stops at the dead end")
+    {
+        dog.Move(1e8);
+
+        CHECK(dog.GetPos().x == 10'000.4);
+        CHECK(dog.GetPos().y == 0);
+        CHECK(dog.GetVel().x == 0);
+        CHECK(dog.GetCurrentRoad()->GetEnd() == Point{ 10'000, 0 });
+    }
+
+    SECTION("one long step ends where many short ones do")
+    {
+        Dog walker{ { 0, 0 }, &map };
+        walker.SetVel(1, 0);
+
+        for (int i = 0; i < 4'000; ++i)
+        {
+            walker.Move(250);
+        }
+
+        dog.Move(1e6);
+
+        CHECK(dog.GetPos().x == 1'000);
+        CHECK(dog.GetPos().x == walker.GetPos().x);
+        CHECK(dog.GetVel().x == 1);
+    }
+
+    SECTION("overlapping roads are followed and walking back stops at the start")
+    {
+        dog.Move(27'000);
+
+        CHECK(dog.GetPos().x == 27);
+
+        dog.SetVel(-1, 0);
+        dog.Move(1e6);
+
+        CHECK(dog.GetPos().x == -0.4);
+        CHECK(dog.GetVel().x == 0);
+    }
+
+    SECTION("turning onto a crossing road")
+    {
+        dog.Move(5'000'000);
+        dog.SetVel(0, 1);
+        dog.Move(1e6);
+
+        CHECK(dog.GetPos().x == 5'000);
+        CHECK(dog.GetPos().y == 50.4);
+    }
+}
+
+TEST_CASE("Long step throughput", "[!benchmark]")
+{
+    test::OfflinePool pool;
+    Map map = MakeChainMap(pool);
+    map.CalcRoads();
+
+    //A catch-up tick after a long stall: the dog crosses a thousand junctions in one move
+    BENCHMARK_ADVANCED("crossing 1000 junctions")(Catch::Benchmark::Chronometer meter)
+    {
+        meter.measure([&map] {
+            Dog dog{ { 0, 0 }, &map };
+            dog.SetVel(1, 0);
+            dog.Move(1e8);
+            return dog.GetPos().x;
+        });
+    };
+}
+
+TEST_CASE_METHOD(test::RingFixture, "Released players free their slots")
+{
+    std::vector<PlayerRef> refs;
+    std::vector<Token> tokens;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        Player* player = players.MakePlayer("dog", &GetMap());
+
+        refs.push_back(player->GetRef());
+        tokens.push_back(player->GetToken());
+    }
+
+    //Retiring without the database: the token goes at once, the player once the tick is over
+    for (int i = 0; i < 10; i += 2)
+    {
+        players.RemovePlayer(*players.FindPlayer(refs[i]));
+    }
+
+    CHECK(players.GetPlayerCount("ring") == 10);
+    CHECK_FALSE(players.FindPlayerByToken(tokens[0]));
+
+    players.ReleaseRetired(GetMap());
+
+    CHECK(players.GetPlayerCount("ring") == 5);
+    CHECK(GetMap().GetDogs().GetFreeCount() == 5);
+
+    for (size_t i = 0; i < refs.size(); ++i)
+    {
+        CHECK((players.FindPlayer(refs[i]) == nullptr) == (i % 2 == 0));
+    }
+
+    SECTION("new players take the freed slots and get ids of their own")
+    {
+        Player* newcomer = players.MakePlayer("dog", &GetMap());
+
+        CHECK(GetMap().GetDogs().Size() == 10);
+        CHECK(newcomer->GetId() == 10);
+        CHECK(players.FindPlayer(refs[0]) == nullptr);
+    }
+}
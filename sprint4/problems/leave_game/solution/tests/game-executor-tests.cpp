@@ -0,0 +1,146 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/game_executor.h"
+#include "test-helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace model;
+
+namespace
+{
+    //Three one-road maps, ticked and joined from several threads
+    struct ExecutorFixture : test::GameFixture
+    {
+        ExecutorFixture()
+        {
+            for (const char* id : { "map1", "map2", "map3" })
+            {
+                game.AddMap(test::MakeLineMap(pool, id, 10));
+            }
+        }
+
+        void Run(unsigned threads)
+        {
+            std::vector<std::jthread> workers;
+
+            for (unsigned i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([this] { ioc.run(); });
+            }
+        }
+
+        net::io_context ioc;
+    };
+}
+
+TEST_CASE_METHOD(ExecutorFixture, "Game executor")
+{
+    GameExecutor executor{ ioc, game };
+
+    SECTION("every map is visited once and done comes last")
+    {
+        std::vector<std::atomic<int>> visits(game.GetMaps().size());
+        std::atomic<int> done_calls = 0;
+        bool all_visited_before_done = false;
+
+        executor.ForEachMap([&visits](size_t index, Map&)
+            {
+                ++visits[index];
+            },
+            [&]
+            {
+                all_visited_before_done = std::all_of(visits.begin(), visits.end(), [](const auto& count) { return count == 1; });
+                ++done_calls;
+            });
+
+        Run(4);
+
+        CHECK(all_visited_before_done);
+        CHECK(done_calls == 1);
+    }
+
+    SECTION("joins and ticks on different maps don't interfere")
+    {
+        std::atomic<int> joined = 0;
+
+        for (int i = 0; i < 300; ++i)
+        {
+            const Map& map = game.GetMaps()[i % game.GetMaps().size()];
+
+            executor.Run(map, [this, &map, &joined]
+                {
+                    game.SpawnPlayer("dog", &map);
+                    ++joined;
+                });
+
+            if (i % 50 == 0)
+            {
+                executor.Tick(10);
+            }
+        }
+
+        Run(4);
+
+        CHECK(joined == 300);
+
+        for (const Map& map : game.GetMaps())
+        {
+            CHECK(game.GetPlayerCount(*map.GetId()) == 100);
+        }
+    }
+
+    SECTION("joins never leave readers without a snapshot")
+    {
+        const Map& map = game.GetMaps()[0];
+        StateSnapshots::Snapshot first;
+        bool replaced_early = false;
+
+        executor.Run(map, [&]
+            {
+                game.SpawnPlayer("dog", &map);
+                executor.RefreshMapState(map);
+                first = game.FindMapState(map);
+
+                //The rebuild waits until the strand is done with this burst
+                for (int i = 0; i < 10; ++i)
+                {
+                    game.SpawnPlayer("pup", &map);
+                    executor.RefreshMapState(map);
+                    replaced_early = replaced_early || game.FindMapState(map) != first;
+                }
+            });
+
+        Run(1);
+
+        REQUIRE(first != nullptr);
+        CHECK_FALSE(replaced_early);
+        CHECK(game.FindMapState(map) != nullptr);
+        CHECK(game.FindMapState(map) != first);
+    }
+
+    SECTION("every map's tick is timed before the barrier opens")
+    {
+        bool all_timed_before_done = false;
+
+        executor.Tick(10);
+        executor.Tick(10, [&]
+            {
+                all_timed_before_done = true;
+
+                for (size_t i = 0; i < game.GetMaps().size(); ++i)
+                {
+                    const GameExecutor::TickTiming& timing = executor.GetTickTiming(i);
+
+                    all_timed_before_done = all_timed_before_done && timing.ticks == 2 && timing.max_us >= timing.last_us && timing.total_us >= timing.max_us;
+                }
+            });
+
+        Run(4);
+
+        CHECK(all_timed_before_done);
+    }
+}
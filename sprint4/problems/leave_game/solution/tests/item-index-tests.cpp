@@ -0,0 +1,188 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/collision_detector.h"
+
+#include <random>
+
+using namespace collision_detector;
+
+namespace
+{
+    //Items on a size x size square, some of them wider than the gatherers
+    std::vector<Item> GenerateItems(size_t count, double size, std::mt19937& random)
+    {
+        std::uniform_real_distribution<double> coord{ 0, size };
+        std::uniform_int_distribution<int> width{ 0, 4 };
+
+        std::vector<Item> items;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            items.push_back({ { coord(random), coord(random) }, width(random) * 0.1 });
+        }
+
+        return items;
+    }
+
+    //Mostly short steps along one axis like the dogs make, a few long and diagonal ones and some standing still
+    std::vector<Gatherer> GenerateGatherers(size_t count, double size, std::mt19937& random)
+    {
+        std::uniform_real_distribution<double> coord{ 0, size };
+        std::uniform_real_distribution<double> step{ -2, 2 };
+        std::uniform_int_distribution<int> kind{ 0, 9 };
+
+        std::vector<Gatherer> gatherers;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            geom::Point2D start{ coord(random), coord(random) };
+            geom::Point2D end = start;
+
+            switch (kind(random))
+            {
+            case 0: break;
+            case 1: end = { coord(random), coord(random) }; break;
+            case 2: end = { start.x + step(random), start.y + step(random) }; break;
+            case 3: case 4: case 5: end.x += step(random); break;
+            default: end.y += step(random); break;
+            }
+
+            gatherers.push_back({ start, end, 0.3 });
+        }
+
+        return gatherers;
+    }
+
+    ItemIndex MakeIndex(const std::vector<Item>& items)
+    {
+        ItemIndex index;
+
+        for (const Item& item : items)
+        {
+            index.Add(item);
+        }
+
+        return index;
+    }
+
+    void CheckSameEvents(const std::vector<Item>& items, const ItemIndex& index, const std::vector<Gatherer>& gatherers)
+    {
+        std::vector<GatheringEvent> expected = FindGatherEvents(VectorItemGathererProvider{ items, gatherers });
+        std::vector<GatheringEvent> indexed = FindGatherEvents(index, gatherers);
+
+        REQUIRE(indexed.size() == expected.size());
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            CHECK(indexed[i].item_id == expected[i].item_id);
+            CHECK(indexed[i].gatherer_id == expected[i].gatherer_id);
+            CHECK(indexed[i].sq_distance == expected[i].sq_distance);
+            CHECK(indexed[i].time == expected[i].time);
+        }
+    }
+}
+
+TEST_CASE("Item index finds the same events as the full scan")
+{
+    std::mt19937 random{ 42 };
+
+    std::vector<Item> items = GenerateItems(2'000, 50, random);
+    std::vector<Gatherer> gatherers = GenerateGatherers(1'000, 50, random);
+
+    ItemIndex index = MakeIndex(items);
+
+    SECTION("on a fresh index")
+    {
+        CheckSameEvents(items, index, gatherers);
+    }
+
+    SECTION("after items are picked up and spawned")
+    {
+        std::uniform_int_distribution<size_t> pick{ 0, 1'000'000 };
+
+        for (int round = 0; round < 5; ++round)
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                size_t id = pick(random) % items.size();
+
+                items[id] = items.back();
+                items.pop_back();
+                index.Remove(id);
+            }
+
+            for (const Item& item : GenerateItems(50, 50, random))
+            {
+                items.push_back(item);
+                index.Add(item);
+            }
+
+            REQUIRE(index.Size() == items.size());
+
+            CheckSameEvents(items, index, gatherers);
+        }
+    }
+
+    SECTION("with every item in one cell")
+    {
+        std::vector<Item> crowded = GenerateItems(300, 3, random);
+        std::vector<Gatherer> walkers = GenerateGatherers(300, 3, random);
+
+        CheckSameEvents(crowded, MakeIndex(crowded), walkers);
+    }
+}
+
+TEST_CASE("Offices are swept in the same pass as the items")
+{
+    ItemIndex items = MakeIndex({ { { 2, 0 }, 0 }, { { 8, 0 }, 0 } });
+    ItemIndex offices = MakeIndex({ { { 5, 0 }, .25 } });
+
+    SECTION("a dog running through an office in one step deposits in between its pickups")
+    {
+        auto events = FindGatherEvents(items, offices, { { { 0, 0 }, { 10, 0 }, .3 } });
+
+        REQUIRE(events.size() == 3);
+
+        CHECK((!events[0].is_office && events[0].item_id == 0));
+        CHECK((events[1].is_office && events[1].item_id == 0));
+        CHECK((!events[2].is_office && events[2].item_id == 1));
+    }
+
+    SECTION("an office is reached within the dog's and the office's widths")
+    {
+        CHECK(FindGatherEvents(items, offices, { { { 4, .5 }, { 6, .5 }, .3 } }).size() == 1);
+        CHECK(FindGatherEvents(items, offices, { { { 4, .6 }, { 6, .6 }, .3 } }).empty());
+    }
+
+    SECTION("an item and an office at the same spot are picked up first")
+    {
+        ItemIndex shared = MakeIndex({ { { 5, 0 }, 0 } });
+        auto events = FindGatherEvents(shared, offices, { { { 0, 0 }, { 10, 0 }, .3 } });
+
+        REQUIRE(events.size() == 2);
+
+        CHECK(!events[0].is_office);
+        CHECK(events[1].is_office);
+    }
+}
+
+TEST_CASE("Loot collection on a large map", "[!benchmark]")
+{
+    std::mt19937 random{ 7 };
+
+    std::vector<Item> items = GenerateItems(10'000, 1'000, random);
+    std::vector<Gatherer> gatherers = GenerateGatherers(5'000, 1'000, random);
+
+    ItemIndex index = MakeIndex(items);
+
+    BENCHMARK("full scan, 10k items x 5k gatherers")
+    {
+        return FindGatherEvents(VectorItemGathererProvider{ items, gatherers }).size();
+    };
+
+    BENCHMARK("item index, 10k items x 5k gatherers")
+    {
+        return FindGatherEvents(index, gatherers).size();
+    };
+}
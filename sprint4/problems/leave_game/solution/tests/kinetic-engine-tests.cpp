@@ -0,0 +1,187 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "test-helpers.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using namespace model;
+using test::Steer;
+
+namespace
+{
+    bool Near(double lhs, double rhs)
+    {
+        return std::abs(lhs - rhs) < 1e-9;
+    }
+}
+
+TEST_CASE("Kinetic engine walks dogs where ticks take them")
+{
+    test::OfflinePool pool;
+
+    Map ticked_map = test::MakeRingMap(pool, "ticked");
+    Map kinetic_map = test::MakeRingMap(pool, "kinetic");
+
+    Players ticked_players{ false };
+    Players kinetic_players{ false };
+
+    //Player pointers only last until the next join
+    std::vector<PlayerRef> ticked_refs;
+    std::vector<PlayerRef> kinetic_refs;
+
+    for (int i = 0; i < 40; ++i)
+    {
+        ticked_refs.push_back(ticked_players.MakePlayer("dog", &ticked_map)->GetRef());
+        kinetic_refs.push_back(kinetic_players.MakePlayer("dog", &kinetic_map)->GetRef());
+    }
+
+    std::vector<Player*> ticked;
+    std::vector<Player*> kinetic;
+
+    for (size_t i = 0; i < ticked_refs.size(); ++i)
+    {
+        ticked.push_back(ticked_players.FindPlayer(ticked_refs[i]));
+        kinetic.push_back(kinetic_players.FindPlayer(kinetic_refs[i]));
+    }
+
+    kinetic_map.GetDogs().TrackVelocityChanges(true);
+
+    KineticEngine engine;
+
+    for (int tick = 0; tick < 80; ++tick)
+    {
+        for (size_t i = 0; i < ticked.size(); ++i)
+        {
+            if ((i + tick) % 7 == 0)
+            {
+                Steer(*ticked[i], static_cast<int>(i) + tick);
+                Steer(*kinetic[i], static_cast<int>(i) + tick);
+            }
+        }
+
+        ticked_players.MoveAllByMap(75, ticked_map);
+        engine.Advance(kinetic_map, kinetic_players.GetPlayerList("kinetic"), kinetic_players.TakeJoined("kinetic"), 75);
+
+        for (size_t i = 0; i < ticked.size(); ++i)
+        {
+            REQUIRE(Near(kinetic[i]->GetPos().x, ticked[i]->GetPos().x));
+            REQUIRE(Near(kinetic[i]->GetPos().y, ticked[i]->GetPos().y));
+
+            //A dog landing right at the end of its road stops there at once, a ticked one only on its next step
+            if (kinetic[i]->GetVel().x != 0 || kinetic[i]->GetVel().y != 0)
+            {
+                REQUIRE(kinetic[i]->GetVel().x == ticked[i]->GetVel().x);
+                REQUIRE(kinetic[i]->GetVel().y == ticked[i]->GetVel().y);
+            }
+        }
+    }
+}
+
+TEST_CASE("Kinetic engine collects items and visits offices on the way")
+{
+    test::OfflinePool pool;
+    Map map = test::MakeRingMap(pool, "ring");
+
+    map.AddOffice({ Office::Id{ "o0" }, { 15, 0 }, { 0, 0 } });
+    map.SetItems({
+        Item{ { 5, 0 }, 0, 0, 10 },
+        Item{ { 10, 0.2 }, 1, 1, 20 },
+        Item{ { 12, 1 }, 2, 0, 40 },
+        Item{ { 17, 0 }, 3, 0, 80 } });
+
+    Players players{ false };
+    Player* player = players.MakePlayer("dog", &map);
+    player->SetVel(1, 0);
+
+    KineticEngine engine;
+
+    //The first two items are 1.4 s and 2.9 s away, nothing happens before
+    engine.Advance(map, players.GetPlayerList("ring"), players.TakeJoined("ring"), 1'000);
+
+    CHECK(Near(player->GetPos().x, 3.5));
+    CHECK(player->GetItemCount() == 0);
+    CHECK(map.GetItemCount() == 4);
+
+    engine.Advance(map, players.GetPlayerList("ring"), players.TakeJoined("ring"), 2'000);
+
+    CHECK(player->GetItemCount() == 2);
+    CHECK(map.GetItemCount() == 2);
+
+    //Past the office at 15 and the last item at 17, then stopped by the corner of the ring
+    engine.Advance(map, players.GetPlayerList("ring"), players.TakeJoined("ring"), 3'000);
+
+    CHECK(player->GetScore() == 30);
+    CHECK(player->GetItemCount() == 1);
+    CHECK(map.GetItemCount() == 1);
+    CHECK(player->GetPos().x == 20.4);
+    CHECK(player->GetVel().x == 0);
+}
+
+TEST_CASE("Kinetic engine leaves standing dogs alone")
+{
+    test::OfflinePool pool;
+    Map map = test::MakeRingMap(pool, "ring");
+
+    Players players{ false };
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        players.MakePlayer("dog", &map);
+    }
+
+    KineticEngine engine;
+    engine.Advance(map, players.GetPlayerList("ring"), players.TakeJoined("ring"), 50);
+
+    //One AFK event per dog, far away
+    size_t events = engine.GetEventCount();
+
+    for (int tick = 0; tick < 100; ++tick)
+    {
+        engine.Advance(map, players.GetPlayerList("ring"), players.TakeJoined("ring"), 50);
+    }
+
+    CHECK(engine.GetEventCount() == events);
+    CHECK(players.GetPlayerList("ring")[0].GetPos().x == 0);
+}
+
+TEST_CASE("Kinetic tick on a crowded map", "[!benchmark]")
+{
+    constexpr int DOGS = 100'000;
+
+    test::OfflinePool pool;
+
+    Map ticked_map = test::MakeRingMap(pool, "ticked");
+    Map kinetic_map = test::MakeRingMap(pool, "kinetic");
+
+    Players players{ false };
+
+    //One dog in a hundred walking the ring, the rest standing around
+    for (int i = 0; i < DOGS; ++i)
+    {
+        Player* ticked = players.MakePlayer("dog", &ticked_map);
+        Player* kinetic = players.MakePlayer("dog", &kinetic_map);
+
+        if (i % 100 == 0)
+        {
+            Steer(*ticked, 1);
+            Steer(*kinetic, 1);
+        }
+    }
+
+    std::vector<util::SlotKey> joined = players.TakeJoined("kinetic");
+
+    KineticEngine engine;
+
+    BENCHMARK("ticked, 50 ms")
+    {
+        players.MoveAllByMap(50, ticked_map);
+    };
+
+    BENCHMARK("kinetic, 50 ms")
+    {
+        engine.Advance(kinetic_map, players.GetPlayerList("kinetic"), std::exchange(joined, {}), 50);
+    };
+}
@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/leaderboard.h"
+#include "../src/random.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using db::Leaderboard;
+using db::Record;
+
+namespace
+{
+    //Order of the records endpoint, equal records keep the order they came in
+    void SortLikeRecords(std::vector<Record>& records)
+    {
+        std::stable_sort(records.begin(), records.end(), [](const Record& lhs, const Record& rhs)
+            {
+                if (lhs.score != rhs.score)
+                {
+                    return lhs.score > rhs.score;
+                }
+
+                if (lhs.play_time_ms != rhs.play_time_ms)
+                {
+                    return lhs.play_time_ms < rhs.play_time_ms;
+                }
+
+                return lhs.name < rhs.name;
+            });
+    }
+
+    bool Same(const Record& lhs, const Record& rhs)
+    {
+        return lhs.name == rhs.name && lhs.score == rhs.score && lhs.play_time_ms == rhs.play_time_ms;
+    }
+
+    //Few names and scores, so ties on every field turn up
+    std::vector<Record> MakeRecords(size_t count)
+    {
+        util::Xoshiro256 random{ 11 };
+        std::vector<Record> records;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            records.push_back({ "dog" + std::to_string(random.Below(50)),
+                static_cast<int64_t>(random.Below(20)), static_cast<int64_t>(random.Below(5)) * 1000 });
+        }
+
+        return records;
+    }
+}
+
+TEST_CASE("Leaderboard pages match the sorted records")
+{
+    std::vector<Record> records = MakeRecords(2'000);
+
+    Leaderboard leaderboard;
+
+    for (const Record& record : records)
+    {
+        leaderboard.Add(record);
+    }
+
+    SortLikeRecords(records);
+
+    REQUIRE(leaderboard.Size() == records.size());
+    REQUIRE(leaderboard.IsComplete());
+
+    for (size_t start : { 0, 1, 99, 1'000, 1'950, 1'999, 2'000, 5'000 })
+    {
+        std::optional<std::vector<Record>> page = leaderboard.GetRange(start, 100);
+
+        REQUIRE(page);
+        REQUIRE(page->size() == std::min<size_t>(100, records.size() - std::min(start, records.size())));
+
+        for (size_t i = 0; i < page->size(); ++i)
+        {
+            REQUIRE(Same((*page)[i], records[start + i]));
+        }
+    }
+
+    SECTION("rank is the place of the player's best record")
+    {
+        for (const std::string name : { "dog0", "dog17", "dog49" })
+        {
+            auto best = std::find_if(records.begin(), records.end(), [&name](const Record& record)
+                {
+                    return record.name == name;
+                });
+
+            REQUIRE(best != records.end());
+
+            std::optional<db::RankedRecord> ranked = leaderboard.FindRank(name);
+
+            REQUIRE(ranked);
+            CHECK(ranked->rank == static_cast<size_t>(best - records.begin()) + 1);
+            CHECK(Same(ranked->record, *best));
+        }
+
+        CHECK_FALSE(leaderboard.FindRank("cat"));
+    }
+}
+
+TEST_CASE("Leaderboard past capacity keeps the top")
+{
+    std::vector<Record> records = MakeRecords(2'000);
+
+    Leaderboard leaderboard{ 300 };
+
+    for (const Record& record : records)
+    {
+        leaderboard.Add(record);
+    }
+
+    SortLikeRecords(records);
+
+    CHECK(leaderboard.Size() == 300);
+    CHECK(leaderboard.GetTotal() == 2'000);
+    CHECK_FALSE(leaderboard.IsComplete());
+
+    std::optional<std::vector<Record>> top = leaderboard.GetRange(200, 100);
+
+    REQUIRE(top);
+    REQUIRE(top->size() == 100);
+
+    for (size_t i = 0; i < top->size(); ++i)
+    {
+        REQUIRE(Same((*top)[i], records[200 + i]));
+    }
+
+    //The database has the rest
+    CHECK_FALSE(leaderboard.GetRange(250, 100));
+    CHECK_FALSE(leaderboard.GetRange(300, 1));
+
+    SECTION("a player whose every record fell out is left to the database")
+    {
+        for (size_t i = 0; i < records.size(); ++i)
+        {
+            std::optional<db::RankedRecord> ranked = leaderboard.FindRank(records[i].name);
+
+            auto best = std::find_if(records.begin(), records.end(), [&records, i](const Record& record)
+                {
+                    return record.name == records[i].name;
+                });
+
+            if (best - records.begin() < 300)
+            {
+                REQUIRE(ranked);
+                REQUIRE(ranked->rank == static_cast<size_t>(best - records.begin()) + 1);
+            }
+            else
+            {
+                REQUIRE_FALSE(ranked);
+            }
+        }
+    }
+}
+
+TEST_CASE("Leaderboard pages", "[!benchmark]")
+{
+    util::Xoshiro256 random{ 3 };
+    Leaderboard leaderboard;
+
+    for (int i = 0; i < 100'000; ++i)
+    {
+        leaderboard.Add({ "dog" + std::to_string(i), static_cast<int64_t>(random.Below(100'000)), static_cast<int64_t>(random.Below(600'000)) });
+    }
+
+    BENCHMARK("page of 100 deep in the table")
+    {
+        return leaderboard.GetRange(50'000, 100)->size();
+    };
+
+    BENCHMARK("rank by name")
+    {
+        return leaderboard.FindRank("dog4242")->rank;
+    };
+
+    BENCHMARK("retirement")
+    {
+        leaderboard.Add({ "dog", static_cast<int64_t>(random.Below(100'000)), 0 });
+    };
+}
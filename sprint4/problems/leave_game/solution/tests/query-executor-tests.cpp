@@ -0,0 +1,294 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/query_executor.h"
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/use_future.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+namespace net = boost::asio;
+
+namespace
+{
+    struct FakeConnection
+    {
+        std::chrono::milliseconds timeout{ 0 };
+        int timeouts_applied = 0;
+
+        //Kept by the pool, like Slot::session_timeout
+        std::chrono::milliseconds session_timeout{ 0 };
+    };
+
+    //Found by the executor through the connection type
+    void ApplyStatementTimeout(FakeConnection& connection, std::chrono::milliseconds timeout)
+    {
+        connection.timeout = timeout;
+        ++connection.timeouts_applied;
+    }
+
+    //Same waiting as db::ConnectionPool, without a database behind it
+    class FakePool
+    {
+    public:
+        class Lease
+        {
+        public:
+            Lease(FakeConnection* connection, FakePool& pool)
+                : connection_(connection)
+                , pool_(&pool) {}
+
+            Lease(Lease&& other) noexcept
+                : connection_(std::exchange(other.connection_, nullptr))
+                , pool_(other.pool_) {}
+
+            ~Lease()
+            {
+                if (connection_ != nullptr)
+                {
+                    pool_->Return(connection_);
+                }
+            }
+
+            FakeConnection& operator*() const
+            {
+                return *connection_;
+            }
+
+            std::chrono::milliseconds GetSessionTimeout() const
+            {
+                return connection_->session_timeout;
+            }
+
+            void SetSessionTimeout(std::chrono::milliseconds timeout)
+            {
+                connection_->session_timeout = timeout;
+            }
+
+        private:
+            FakeConnection* connection_;
+            FakePool* pool_;
+        };
+
+        explicit FakePool(size_t size)
+            : connections_(size)
+        {
+            for (FakeConnection& connection : connections_)
+            {
+                free_.push_back(&connection);
+            }
+        }
+
+        Lease GetConnection()
+        {
+            std::unique_lock lock{ mutex_ };
+
+            returned_.wait(lock, [this]
+                {
+                    return !free_.empty();
+                });
+
+            FakeConnection* connection = free_.back();
+            free_.pop_back();
+
+            return { connection, *this };
+        }
+
+        std::vector<FakeConnection> connections_;
+
+    private:
+        void Return(FakeConnection* connection)
+        {
+            {
+                std::lock_guard lock{ mutex_ };
+                free_.push_back(connection);
+            }
+
+            returned_.notify_one();
+        }
+
+        std::mutex mutex_;
+        std::condition_variable returned_;
+        std::vector<FakeConnection*> free_;
+    };
+
+    using Executor = db::BasicQueryExecutor<FakePool>;
+}
+
+TEST_CASE("Query results come back on the caller's executor")
+{
+    net::io_context ioc;
+    auto strand = net::make_strand(ioc);
+
+    FakePool pool{ 2 };
+    Executor executor{ pool, 2, ioc.get_executor() };
+
+    std::vector<int> results;
+    std::vector<std::string> errors;
+    bool on_strand = true;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        executor.AsyncExecute([i](FakeConnection&)
+            {
+                if (i == 3)
+                {
+                    throw std::runtime_error("syntax error");
+                }
+
+                return i * i;
+            },
+            net::bind_executor(strand, [&, strand](std::exception_ptr error, int result)
+                {
+                    on_strand = on_strand && strand.running_in_this_thread();
+
+                    if (error)
+                    {
+                        try
+                        {
+                            std::rethrow_exception(error);
+                        }
+                        catch (const std::exception& ex)
+                        {
+                            errors.push_back(ex.what());
+                        }
+
+                        return;
+                    }
+
+                    results.push_back(result);
+                }));
+    }
+
+    //Pending queries keep the context busy, so this returns once every completion has run
+    ioc.run();
+
+    CHECK(on_strand);
+    CHECK(results.size() == 9);
+    CHECK(errors == std::vector<std::string>{ "syntax error" });
+
+    db::QueryMetrics metrics = executor.GetMetrics();
+
+    CHECK(metrics.submitted == 10);
+    CHECK(metrics.completed == 9);
+    CHECK(metrics.failed == 1);
+    CHECK(metrics.queue_depth == 0);
+    CHECK(metrics.max_queue_depth >= 1);
+
+    //Both connections got the default timeout once at most, it didn't change between queries
+    for (const FakeConnection& connection : pool.connections_)
+    {
+        CHECK(connection.timeouts_applied <= 1);
+    }
+
+    SECTION("completion tokens other than callbacks work too")
+    {
+        ioc.restart();
+
+        std::future<int> answer = executor.AsyncExecute(250ms, [](FakeConnection& connection)
+            {
+                return static_cast<int>(connection.timeout.count());
+            },
+            net::use_future);
+
+        ioc.run();
+
+        CHECK(answer.get() == 250);
+    }
+}
+
+TEST_CASE("Queries that wait too long for a connection time out")
+{
+    net::io_context ioc;
+
+    FakePool pool{ 1 };
+    Executor executor{ pool, 2, ioc.get_executor() };
+
+    bool slow_done = false;
+    bool fast_ran = false;
+    bool fast_timed_out = false;
+
+    executor.AsyncExecute([](FakeConnection&)
+        {
+            std::this_thread::sleep_for(100ms);
+        },
+        [&slow_done](std::exception_ptr error)
+        {
+            slow_done = !error;
+        });
+
+    executor.AsyncExecute(10ms, [&fast_ran](FakeConnection&)
+        {
+            fast_ran = true;
+        },
+        [&fast_timed_out](std::exception_ptr error)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const db::QueryTimeout&)
+            {
+                fast_timed_out = true;
+            }
+        });
+
+    ioc.run();
+
+    CHECK(slow_done);
+    CHECK_FALSE(fast_ran);
+    CHECK(fast_timed_out);
+
+    db::QueryMetrics metrics = executor.GetMetrics();
+
+    CHECK(metrics.timed_out == 1);
+    CHECK(metrics.max_wait >= 10ms);
+}
+
+TEST_CASE("Stopped query executor runs what was queued and refuses the rest")
+{
+    net::io_context ioc;
+
+    FakePool pool{ 1 };
+    Executor executor{ pool, 1, ioc.get_executor() };
+
+    int done = 0;
+    bool refused = false;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        executor.AsyncExecute([](FakeConnection&)
+            {
+                std::this_thread::sleep_for(1ms);
+            },
+            [&done](std::exception_ptr error)
+            {
+                done += !error;
+            });
+    }
+
+    executor.Stop();
+
+    executor.AsyncExecute([](FakeConnection&) {}, [&refused](std::exception_ptr error)
+        {
+            refused = error != nullptr;
+        });
+
+    ioc.run();
+
+    CHECK(done == 20);
+    CHECK(refused);
+    CHECK(executor.GetMetrics().failed == 1);
+}
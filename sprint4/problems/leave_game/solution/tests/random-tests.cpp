@@ -0,0 +1,180 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/random.h"
+#include "test-helpers.h"
+
+#include <cmath>
+#include <vector>
+
+using util::AliasTable;
+using util::Xoshiro256;
+
+namespace
+{
+    Data::LootTable MakeLootTable(std::vector<int64_t> values, std::vector<double> weights)
+    {
+        return { std::move(values), AliasTable{ weights } };
+    }
+
+    //Long road, short road and a point, the point never gets loot
+    model::Map MakeMap(db::ConnectionPool& pool)
+    {
+        model::Map map{ model::Map::Id{ "roads" }, "Roads", pool };
+
+        map.AddRoad({ model::Road::HORIZONTAL, { 0, 0 }, 30 });
+        map.AddRoad({ model::Road::VERTICAL, { 50, 10 }, 0 });
+        map.AddRoad({ model::Road::VERTICAL, { 70, 70 }, 70 });
+        map.CalcRoads();
+
+        return map;
+    }
+}
+
+TEST_CASE("Xoshiro256 is reproducible from its seed")
+{
+    Xoshiro256 first{ 42 };
+    Xoshiro256 second{ 42 };
+    Xoshiro256 other{ 43 };
+
+    int same_as_other = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        uint64_t value = first();
+
+        REQUIRE(value == second());
+        same_as_other += value == other();
+    }
+
+    CHECK(same_as_other == 0);
+
+    for (uint64_t bound : { 1ull, 3ull, 10ull, 1ull << 40 })
+    {
+        for (int i = 0; i < 1000; ++i)
+        {
+            REQUIRE(first.Below(bound) < bound);
+
+            double real = first.Real();
+            REQUIRE(real >= 0);
+            REQUIRE(real < 1);
+        }
+    }
+}
+
+TEST_CASE("Alias table draws indices by their weights")
+{
+    Xoshiro256 random{ 7 };
+
+    const std::vector<double> weights{ 1, 0, 3, 6, -2 };
+    AliasTable table{ weights };
+
+    REQUIRE(table.Size() == weights.size());
+
+    constexpr int DRAWS = 200'000;
+    std::vector<int> counts(weights.size());
+
+    for (int i = 0; i < DRAWS; ++i)
+    {
+        ++counts[table.Sample(random)];
+    }
+
+    CHECK(counts[1] == 0);
+    CHECK(counts[4] == 0);
+    CHECK(std::abs(counts[0] / double(DRAWS) - 0.1) < 0.01);
+    CHECK(std::abs(counts[2] / double(DRAWS) - 0.3) < 0.01);
+    CHECK(std::abs(counts[3] / double(DRAWS) - 0.6) < 0.01);
+
+    SECTION("all weights zero means all indices alike")
+    {
+        AliasTable flat{ std::vector<double>{ 0, 0, 0, 0 } };
+        std::vector<int> flat_counts(4);
+
+        for (int i = 0; i < DRAWS; ++i)
+        {
+            ++flat_counts[flat.Sample(random)];
+        }
+
+        for (int count : flat_counts)
+        {
+            CHECK(std::abs(count / double(DRAWS) - 0.25) < 0.01);
+        }
+    }
+}
+
+TEST_CASE("Loot spawns by road length and replays from the seed")
+{
+    test::OfflinePool pool;
+
+    model::Map map = MakeMap(pool);
+    model::Map twin = MakeMap(pool);
+
+    SECTION("a map without loot types spawns nothing")
+    {
+        map.GenerateItems(10);
+
+        CHECK(map.GetItemCount() == 0);
+    }
+
+    map.SetLootTable(MakeLootTable({ 10, 30 }, { 1, 1 }));
+    twin.SetLootTable(MakeLootTable({ 10, 30 }, { 1, 1 }));
+
+    map.SeedRandom(5);
+    twin.SeedRandom(5);
+
+    map.GenerateItems(4'000);
+    twin.GenerateItems(4'000);
+
+    REQUIRE(map.GetItemCount() == 4'000);
+
+    int on_long_road = 0;
+
+    for (size_t i = 0; i < map.GetItemList().Size(); ++i)
+    {
+        const model::Item& item = map.GetItemList()[i];
+        const model::Item& twin_item = twin.GetItemList()[i];
+
+        REQUIRE(item.pos.x == twin_item.pos.x);
+        REQUIRE(item.pos.y == twin_item.pos.y);
+        REQUIRE(item.type == twin_item.type);
+        REQUIRE(item.value == (item.type == 0 ? 10 : 30));
+
+        if (item.pos.y == 0 && item.pos.x < 30)
+        {
+            ++on_long_road;
+        }
+        else
+        {
+            //Whole points of the short road, its far end excluded like the long one's
+            REQUIRE(item.pos.x == 50);
+            REQUIRE(item.pos.y >= 0);
+            REQUIRE(item.pos.y < 10);
+            REQUIRE(item.pos.y == std::floor(item.pos.y));
+        }
+    }
+
+    //30 cells against 10
+    CHECK(std::abs(on_long_road / 4'000.0 - 0.75) < 0.03);
+}
+
+TEST_CASE("Spawning loot", "[!benchmark]")
+{
+    test::OfflinePool pool;
+
+    model::Map map = MakeMap(pool);
+    map.SetLootTable(MakeLootTable({ 10, 20, 30, 40, 50, 60 }, { 1, 2, 3, 4, 5, 6 }));
+    map.SeedRandom(1);
+
+    Xoshiro256 random{ 1 };
+    AliasTable table{ std::vector<double>{ 1, 2, 3, 4, 5, 6 } };
+
+    BENCHMARK("alias draw")
+    {
+        return table.Sample(random);
+    };
+
+    BENCHMARK("spot on a road")
+    {
+        return map.GetRandomSpot();
+    };
+}
@@ -0,0 +1,207 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/bounded_queue.h"
+#include "../src/retirement_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using db::RetiredPlayer;
+using db::RetiredRow;
+using db::RetirementWriter;
+
+TEST_CASE("Bounded queue hands every value to exactly one consumer")
+{
+    util::BoundedQueue<int> queue{ 100 };
+
+    CHECK(queue.Capacity() == 128);
+
+    constexpr int PRODUCERS = 4;
+    constexpr int PER_PRODUCER = 50'000;
+
+    std::atomic<int> done_producers = 0;
+    std::vector<int> seen(PRODUCERS * PER_PRODUCER);
+
+    {
+        std::vector<std::jthread> threads;
+
+        for (int p = 0; p < PRODUCERS; ++p)
+        {
+            threads.emplace_back([&queue, &done_producers, p]
+                {
+                    for (int i = 0; i < PER_PRODUCER; ++i)
+                    {
+                        int value = p * PER_PRODUCER + i;
+
+                        while (!queue.TryPush(value))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+
+                    ++done_producers;
+                });
+        }
+
+        for (int c = 0; c < 2; ++c)
+        {
+            threads.emplace_back([&]
+                {
+                    while (true)
+                    {
+                        if (std::optional<int> value = queue.TryPop())
+                        {
+                            ++seen[*value];
+                        }
+                        else if (done_producers == PRODUCERS && queue.SizeApprox() == 0)
+                        {
+                            break;
+                        }
+                    }
+                });
+        }
+    }
+
+    CHECK(std::count(seen.begin(), seen.end(), 1) == PRODUCERS * PER_PRODUCER);
+    CHECK_FALSE(queue.TryPop());
+}
+
+TEST_CASE("Retirement writer batches, retries and flushes on stop")
+{
+    std::mutex mutex;
+    std::vector<RetiredRow> rows;
+    std::vector<size_t> batch_sizes;
+    std::vector<std::string> failed_ids;
+    std::atomic<int> failures_left = 0;
+
+    RetirementWriter writer{ [&](std::span<const RetiredRow> batch)
+        {
+            std::lock_guard lock{ mutex };
+
+            if (failures_left > 0)
+            {
+                --failures_left;
+
+                for (const RetiredRow& row : batch)
+                {
+                    failed_ids.push_back(row.id);
+                }
+
+                throw std::runtime_error("database is down");
+            }
+
+            rows.insert(rows.end(), batch.begin(), batch.end());
+            batch_sizes.push_back(batch.size());
+        } };
+
+    SECTION("a mass timeout before the writer runs spills past the queue and still gets written")
+    {
+        constexpr int COUNT = static_cast<int>(RetirementWriter::QUEUE_CAPACITY) + 1000;
+
+        for (int i = 0; i < COUNT; ++i)
+        {
+            writer.Push({ "dog" + std::to_string(i), i, i * 10 });
+        }
+
+        CHECK(writer.GetMetrics().overflowed == 1000);
+        CHECK(writer.GetMetrics().backlog == COUNT);
+
+        writer.Stop();
+
+        REQUIRE(rows.size() == COUNT);
+        CHECK(writer.GetMetrics().backlog == 0);
+        CHECK(writer.GetMetrics().batches == batch_sizes.size());
+
+        for (size_t size : batch_sizes)
+        {
+            CHECK(size <= RetirementWriter::MAX_BATCH);
+        }
+
+        std::set<std::string> ids;
+
+        for (const RetiredRow& row : rows)
+        {
+            ids.insert(row.id);
+        }
+
+        CHECK(ids.size() == rows.size());
+    }
+
+    SECTION("failed batches are retried with the same ids")
+    {
+        failures_left = 2;
+        writer.Start();
+
+        std::vector<std::jthread> producers;
+
+        for (int p = 0; p < 4; ++p)
+        {
+            producers.emplace_back([&writer, p]
+                {
+                    for (int i = 0; i < 250; ++i)
+                    {
+                        writer.Push({ "dog", p, i });
+                    }
+                });
+        }
+
+        producers.clear();
+        writer.Stop();
+
+        CHECK(rows.size() == 1000);
+        CHECK(writer.GetMetrics().retries >= 2);
+        CHECK(writer.GetMetrics().lost == 0);
+
+        std::set<std::string> ids;
+
+        for (const RetiredRow& row : rows)
+        {
+            ids.insert(row.id);
+        }
+
+        CHECK(ids.size() == rows.size());
+
+        for (const std::string& id : failed_ids)
+        {
+            CHECK(ids.contains(id));
+        }
+    }
+
+    SECTION("a database back within the final pauses loses nothing")
+    {
+        failures_left = 1'000'000;
+
+        writer.Push({ "dog", 1, 2 });
+
+        //Back well before the first pause is over
+        std::jthread recovery{ [&failures_left]
+            {
+                std::this_thread::sleep_for(RetirementWriter::MIN_RETRY_PAUSE / 2);
+                failures_left = 0;
+            } };
+
+        writer.Stop();
+
+        CHECK(rows.size() == 1);
+        CHECK(writer.GetMetrics().retries >= 1);
+        CHECK(writer.GetMetrics().lost == 0);
+    }
+
+    SECTION("a database that stays down loses only what is left at stop")
+    {
+        failures_left = 1'000'000;
+
+        writer.Push({ "dog", 1, 2 });
+        writer.Stop();
+
+        CHECK(rows.empty());
+        CHECK(writer.GetMetrics().lost == 1);
+        CHECK(writer.GetMetrics().backlog == 0);
+    }
+}
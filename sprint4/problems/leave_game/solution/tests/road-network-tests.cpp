@@ -0,0 +1,185 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "test-helpers.h"
+
+#include <random>
+#include <unordered_map>
+
+using namespace model;
+
+namespace
+{
+    using RoadIndex = RoadNetwork::RoadIndex;
+
+    //Roads on a size x size square, half of them horizontal. Many of them cross, touch or overlap
+    std::vector<Road> GenerateRoads(size_t count, int size, int max_length)
+    {
+        std::mt19937 random{ 42 };
+        std::uniform_int_distribution<int> coord{ 0, size };
+        std::uniform_int_distribution<int> length{ 0, max_length };
+
+        std::vector<Road> roads;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            Point start{ coord(random), coord(random) };
+            int end = std::min(size, start.x + length(random));
+
+            if (i % 2 == 0)
+            {
+                roads.push_back({ Road::HORIZONTAL, start, end });
+            }
+            else
+            {
+                roads.push_back({ Road::VERTICAL, { start.y, start.x }, end });
+            }
+        }
+
+        return roads;
+    }
+
+    bool Covers(const Road& road, Point p)
+    {
+        Point start = road.GetStart();
+        Point end = road.GetEnd();
+
+        return p.x >= std::min(start.x, end.x) && p.x <= std::max(start.x, end.x)
+            && p.y >= std::min(start.y, end.y) && p.y <= std::max(start.y, end.y);
+    }
+
+    //Grid the network replaces: a copy of the road for every point of it
+    struct LegacyPointHasher
+    {
+        size_t operator()(const Point& p) const
+        {
+            return p.x + p.y * p.y;
+        }
+    };
+
+    using LegacyGrid = std::unordered_map<Point, std::deque<std::shared_ptr<Road>>, LegacyPointHasher>;
+
+    LegacyGrid BuildLegacyGrid(const std::vector<Road>& roads)
+    {
+        LegacyGrid grid;
+
+        for (const Road& road : roads)
+        {
+            Point start = road.GetStart();
+            Point end = road.GetEnd();
+
+            for (int x = std::min(start.x, end.x); x <= std::max(start.x, end.x); ++x)
+            {
+                for (int y = std::min(start.y, end.y); y <= std::max(start.y, end.y); ++y)
+                {
+                    grid[{ x, y }].push_back(std::make_shared<Road>(road));
+                }
+            }
+        }
+
+        return grid;
+    }
+}
+
+TEST_CASE("Road network")
+{
+    std::vector<Road> roads = GenerateRoads(400, 60, 25);
+    RoadNetwork network{ roads };
+
+    SECTION("finds the same roads as a full scan")
+    {
+        for (int x = -1; x <= 61; ++x)
+        {
+            for (int y = -1; y <= 61; ++y)
+            {
+                std::optional<RoadIndex> expected;
+                std::optional<RoadIndex> expected_vertical;
+
+                for (RoadIndex i = 0; i < roads.size(); ++i)
+                {
+                    if (Covers(roads[i], { x, y }))
+                    {
+                        expected = expected.value_or(i);
+
+                        if (roads[i].IsVertical() && !expected_vertical)
+                        {
+                            expected_vertical = i;
+                        }
+                    }
+                }
+
+                CHECK(network.FindRoadAt({ x, y }, [](RoadIndex) { return true; }) == expected);
+                CHECK(network.FindRoadAt({ x, y }, [&roads](RoadIndex i) { return roads[i].IsVertical(); }) == expected_vertical);
+            }
+        }
+    }
+
+    SECTION("junctions list every road through a road end")
+    {
+        for (const Road& road : roads)
+        {
+            for (Point end : { road.GetStart(), road.GetEnd() })
+            {
+                std::vector<RoadIndex> expected;
+
+                for (RoadIndex i = 0; i < roads.size(); ++i)
+                {
+                    if (Covers(roads[i], end))
+                    {
+                        expected.push_back(i);
+                    }
+                }
+
+                std::span<const RoadIndex> junction = network.GetJunction(end);
+
+                CHECK(std::vector<RoadIndex>(junction.begin(), junction.end()) == expected);
+            }
+        }
+
+        CHECK(network.GetJunction({ -5, -5 }).empty());
+    }
+}
+
+TEST_CASE("Map roads")
+{
+    test::OfflinePool pool;
+    Map map{ Map::Id{ "map" }, "Map", pool };
+
+    map.AddRoad({ Road::HORIZONTAL, { 0, 0 }, 10 });
+    map.AddRoad({ Road::VERTICAL, { 10, 0 }, 10 });
+    map.CalcRoads();
+
+    CHECK(&map.FindRoad({ 10, 0 }, { 10, 10 }) == &map.GetRoads()[1]);
+    CHECK(map.GetRoadIndex(map.GetRoads()[1]) == 1);
+    CHECK_THROWS_AS(map.FindRoad({ 10, 10 }, { 10, 0 }), std::invalid_argument);
+}
+
+TEST_CASE("Road network on a large map", "[!benchmark]")
+{
+    //10k roads up to a kilometre long on a 10 x 10 km square
+    std::vector<Road> roads = GenerateRoads(10'000, 10'000, 1'000);
+
+    WARN("Network memory: " << RoadNetwork{ roads }.GetMemoryUsage() << " bytes");
+
+    BENCHMARK("build")
+    {
+        return RoadNetwork{ roads };
+    };
+
+    RoadNetwork network{ roads };
+    std::mt19937 random{ 7 };
+    std::uniform_int_distribution<int> coord{ 0, 10'000 };
+
+    BENCHMARK("lookup")
+    {
+        return network.FindRoadAt({ coord(random), coord(random) }, [](RoadIndex) { return true; });
+    };
+
+    //The old grid gets a copy of the road for every metre of it, so it only gets a tenth of the map
+    std::vector<Road> legacy_roads = GenerateRoads(1'000, 10'000, 1'000);
+
+    BENCHMARK("legacy grid build, 1k roads")
+    {
+        return BuildLegacyGrid(legacy_roads).size();
+    };
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/api_router.h"
+
+#include <string>
+#include <string_view>
+
+using namespace std::literals;
+using namespace http_handler;
+
+//The table is checked while compiling, a broken route doesn't even build
+static_assert(API_ROUTER.Match("/api/v1/maps/map1"sv, http::verb::get).route->endpoint == Endpoint::MAP);
+static_assert(API_ROUTER.Match("/api/v1/game/state/"sv, http::verb::get).route->endpoint == Endpoint::STATE);
+
+TEST_CASE("Router finds endpoints")
+{
+    SECTION("exact paths and a trailing slash")
+    {
+        CHECK(API_ROUTER.Match("/api/v1/maps"sv, http::verb::get).route->endpoint == Endpoint::MAPS);
+        CHECK(API_ROUTER.Match("/api/v1/maps/"sv, http::verb::get).route->endpoint == Endpoint::MAPS);
+        CHECK(API_ROUTER.Match("/api/v1/game/join"sv, http::verb::post).route->endpoint == Endpoint::JOIN);
+        CHECK(API_ROUTER.Match("/api/v1/game/player/action/"sv, http::verb::post).route->endpoint == Endpoint::ACTION);
+    }
+
+    SECTION("map id is captured")
+    {
+        RouteMatch match = API_ROUTER.Match("/api/v1/maps/town/"sv, http::verb::get);
+
+        REQUIRE(match.route != nullptr);
+        CHECK(match.route->endpoint == Endpoint::MAP);
+        CHECK(match.param == "town"sv);
+    }
+
+    SECTION("query string is split off")
+    {
+        RouteMatch match = API_ROUTER.Match("/api/v1/game/records?start=10&maxItems=5"sv, http::verb::get);
+
+        REQUIRE(match.route != nullptr);
+        CHECK(match.route->endpoint == Endpoint::RECORDS);
+        CHECK(match.query == "start=10&maxItems=5"sv);
+    }
+
+    SECTION("records has a rank lookup below it")
+    {
+        RouteMatch match = API_ROUTER.Match("/api/v1/game/records/rank?name=Rex"sv, http::verb::get);
+
+        REQUIRE(match.route != nullptr);
+        CHECK(match.route->endpoint == Endpoint::RECORD_RANK);
+        CHECK(match.query == "name=Rex"sv);
+    }
+
+    SECTION("unknown paths")
+    {
+        CHECK(API_ROUTER.Match("/api"sv, http::verb::get).route == nullptr);
+        CHECK(API_ROUTER.Match("/api/v1/game"sv, http::verb::get).route == nullptr);
+        CHECK(API_ROUTER.Match("/api/v1/maps/town/roads"sv, http::verb::get).route == nullptr);
+        CHECK(API_ROUTER.Match("/api/v1//maps"sv, http::verb::get).route == nullptr);
+        CHECK(API_ROUTER.Match("/api/v2/maps"sv, http::verb::get).route == nullptr);
+    }
+}
+
+TEST_CASE("Router checks methods")
+{
+    RouteMatch join = API_ROUTER.Match("/api/v1/game/join"sv, http::verb::get);
+
+    REQUIRE(join.route != nullptr);
+    CHECK_FALSE(join.method_allowed);
+    CHECK(AllowedMethods(join.route->methods) == "POST"sv);
+
+    RouteMatch state = API_ROUTER.Match("/api/v1/game/state"sv, http::verb::delete_);
+
+    REQUIRE(state.route != nullptr);
+    CHECK_FALSE(state.method_allowed);
+    CHECK(AllowedMethods(state.route->methods) == "GET, HEAD"sv);
+
+    CHECK(API_ROUTER.Match("/api/v1/game/state"sv, http::verb::head).method_allowed);
+}
+
+TEST_CASE("Wrong method gets a JSON error")
+{
+    //Even /maps, which used to answer with plain "Invalid method"
+    RouteMatch maps = API_ROUTER.Match("/api/v1/maps"sv, http::verb::post);
+
+    REQUIRE(maps.route != nullptr);
+    CHECK_FALSE(maps.method_allowed);
+    CHECK(MethodNotAllowedBody(maps.route->methods) == R"({"code":"invalidMethod","message":"Invalid method"})"sv);
+
+    RouteMatch tick = API_ROUTER.Match("/api/v1/game/tick"sv, http::verb::get);
+
+    REQUIRE(tick.route != nullptr);
+    CHECK(MethodNotAllowedBody(tick.route->methods) == R"({"code":"invalidMethod","message":"Only POST method is expected"})"sv);
+}
+
+TEST_CASE("Query parameters")
+{
+    CHECK(FindQueryParam("start=10&maxItems=5"sv, "maxItems"sv) == "5"sv);
+    CHECK(FindQueryParam("start=10&maxItems=5"sv, "max"sv) == std::nullopt);
+    CHECK(FindQueryParam("flag&start=1"sv, "flag"sv) == ""sv);
+
+    int value = 7;
+
+    CHECK(ReadQueryParam("other=1"sv, "start"sv, value));
+    CHECK(value == 7);
+
+    CHECK(ReadQueryParam("start=42"sv, "start"sv, value));
+    CHECK(value == 42);
+
+    CHECK_FALSE(ReadQueryParam("start=4x"sv, "start"sv, value));
+    CHECK_FALSE(ReadQueryParam("start="sv, "start"sv, value));
+
+    std::string name = "none";
+
+    CHECK(ReadQueryParam("start=1"sv, "name"sv, name));
+    CHECK(name == "none");
+
+    CHECK(ReadQueryParam("name=Big+Dog%21%2fRex%C3%A9"sv, "name"sv, name));
+    CHECK(name == "Big Dog!/Rex\xC3\xA9");
+
+    CHECK_FALSE(ReadQueryParam("name=Rex%2"sv, "name"sv, name));
+    CHECK_FALSE(ReadQueryParam("name=Rex%zz"sv, "name"sv, name));
+}
+
+TEST_CASE("Router dispatch cost", "[!benchmark]")
+{
+    BENCHMARK("static route")
+    {
+        return API_ROUTER.Match("/api/v1/game/state"sv, http::verb::get).route;
+    };
+
+    BENCHMARK("route with a parameter")
+    {
+        return API_ROUTER.Match("/api/v1/maps/town"sv, http::verb::get).param.size();
+    };
+
+    BENCHMARK("route with a query")
+    {
+        return API_ROUTER.Match("/api/v1/game/records?start=0&maxItems=100"sv, http::verb::get).query.size();
+    };
+
+    BENCHMARK("unknown route")
+    {
+        return API_ROUTER.Match("/api/v1/game/unknown/path"sv, http::verb::get).route;
+    };
+}
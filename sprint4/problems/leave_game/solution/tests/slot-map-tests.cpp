@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/slot_map.h"
+
+#include <map>
+#include <random>
+#include <string>
+
+using util::SlotKey;
+using util::SlotMap;
+
+TEST_CASE("Slot map keys")
+{
+    SlotMap<std::string> strings;
+
+    SlotKey a = strings.Insert("a");
+    SlotKey b = strings.Insert("b");
+    SlotKey c = strings.Insert("c");
+
+    CHECK(strings.Size() == 3);
+    CHECK(*strings.Find(b) == "b");
+    CHECK(strings.Find(SlotKey{}) == nullptr);
+
+    SECTION("erasing moves the last element into the hole")
+    {
+        REQUIRE(strings.Erase(a));
+
+        CHECK(strings.Size() == 2);
+        CHECK(strings[0] == "c");
+        CHECK(strings.PositionOf(c) == 0);
+        CHECK(strings.KeyAt(0) == c);
+        CHECK(*strings.Find(c) == "c");
+        CHECK(*strings.Find(b) == "b");
+    }
+
+    SECTION("keys of erased elements find nothing, even once their slot is reused")
+    {
+        REQUIRE(strings.Erase(b));
+        CHECK_FALSE(strings.Erase(b));
+
+        SlotKey d = strings.Insert("d");
+
+        CHECK(d.index == b.index);
+        CHECK_FALSE(d == b);
+        CHECK(strings.Find(b) == nullptr);
+        CHECK(*strings.Find(d) == "d");
+    }
+
+    SECTION("clearing drops every key")
+    {
+        strings.Clear();
+
+        CHECK(strings.Empty());
+        CHECK(strings.Find(a) == nullptr);
+        CHECK(strings.Find(c) == nullptr);
+    }
+}
+
+TEST_CASE("Slot map churn matches an ordinary map")
+{
+    std::mt19937 random{ 42 };
+
+    SlotMap<int> values;
+    std::map<int, SlotKey> expected;
+    std::vector<SlotKey> erased;
+
+    for (int i = 0; i < 20'000; ++i)
+    {
+        if (expected.empty() || random() % 3 != 0)
+        {
+            expected.emplace(i, values.Insert(i));
+            continue;
+        }
+
+        auto victim = std::next(expected.begin(), random() % expected.size());
+
+        REQUIRE(values.Erase(victim->second));
+
+        erased.push_back(victim->second);
+        expected.erase(victim);
+    }
+
+    REQUIRE(values.Size() == expected.size());
+
+    for (const auto& [value, key] : expected)
+    {
+        REQUIRE(values.Find(key) != nullptr);
+        REQUIRE(*values.Find(key) == value);
+        REQUIRE(values.KeyAt(values.PositionOf(key)) == key);
+    }
+
+    for (SlotKey key : erased)
+    {
+        REQUIRE(values.Find(key) == nullptr);
+    }
+
+}
+
+TEST_CASE("Slot map reuses freed slots")
+{
+    //The slot table only grows with the number of elements alive at once
+    SlotMap<int> bounded;
+    std::vector<SlotKey> live;
+
+    for (int round = 0; round < 100; ++round)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            live.push_back(bounded.Insert(i));
+        }
+
+        for (SlotKey key : live)
+        {
+            bounded.Erase(key);
+        }
+
+        live.clear();
+    }
+
+    SlotKey last = bounded.Insert(0);
+
+    CHECK(last.index < 100);
+}
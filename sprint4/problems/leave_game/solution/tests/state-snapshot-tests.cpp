@@ -0,0 +1,94 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/state_snapshot.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using model::MapSnapshot;
+using model::StateSnapshots;
+
+namespace
+{
+    StateSnapshots::Snapshot MakeSnapshot(int tick)
+    {
+        return std::make_shared<const MapSnapshot>(MapSnapshot{
+            std::make_shared<const std::string>("state " + std::to_string(tick)),
+            std::make_shared<const std::string>("players " + std::to_string(tick)) });
+    }
+}
+
+TEST_CASE("State snapshots")
+{
+    StateSnapshots snapshots;
+    snapshots.AddMap();
+    snapshots.AddMap();
+
+    SECTION("publish and invalidate")
+    {
+        CHECK(snapshots.Get(0) == nullptr);
+
+        snapshots.Publish(1, MakeSnapshot(1));
+
+        CHECK(snapshots.Get(0) == nullptr);
+        REQUIRE(snapshots.Get(1) != nullptr);
+        CHECK(*snapshots.Get(1)->state == "state 1");
+
+        //Readers keep what they took even after the slot moves on
+        StateSnapshots::Snapshot held = snapshots.Get(1);
+        snapshots.Invalidate(1);
+
+        CHECK(snapshots.Get(1) == nullptr);
+        CHECK(*held->players == "players 1");
+    }
+
+    SECTION("changes keep the snapshot until the next publish")
+    {
+        snapshots.Publish(0, MakeSnapshot(1));
+
+        CHECK(snapshots.MarkChanged(0));
+        CHECK_FALSE(snapshots.MarkChanged(0));
+        CHECK(*snapshots.Get(0)->state == "state 1");
+
+        snapshots.Publish(0, MakeSnapshot(2));
+
+        CHECK(snapshots.MarkChanged(0));
+    }
+
+    SECTION("readers never see a torn snapshot")
+    {
+        std::atomic<bool> stop = false;
+        std::atomic<int> torn = 0;
+        std::vector<std::jthread> readers;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            readers.emplace_back([&snapshots, &stop, &torn]
+                {
+                    while (!stop)
+                    {
+                        if (StateSnapshots::Snapshot snapshot = snapshots.Get(0))
+                        {
+                            //Both bodies come from the same tick
+                            if (snapshot->state->substr(6) != snapshot->players->substr(8))
+                            {
+                                ++torn;
+                            }
+                        }
+                    }
+                });
+        }
+
+        for (int tick = 0; tick < 20000; ++tick)
+        {
+            snapshots.Publish(0, MakeSnapshot(tick));
+        }
+
+        stop = true;
+        readers.clear();
+
+        CHECK(torn == 0);
+    }
+}
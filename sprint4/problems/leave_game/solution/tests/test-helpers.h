@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../src/model.h"
+
+#include <memory>
+#include <string>
+
+//Maps and fixtures more than one test file starts from
+namespace test
+{
+    //Never connects. Everything works without it but retirement, which writes to the database
+    struct OfflinePool : db::ConnectionPool
+    {
+        OfflinePool()
+            : db::ConnectionPool(0, [] { return std::make_shared<pqxx::connection>(); }) {}
+    };
+
+    //One horizontal road from 0 to length
+    inline model::Map MakeLineMap(db::ConnectionPool& pool, std::string id, int length)
+    {
+        model::Map map{ model::Map::Id{ id }, id, pool };
+
+        map.AddRoad({ model::Road::HORIZONTAL, { 0, 0 }, length });
+        map.CalcRoads();
+
+        //Nobody should retire here, that would need a database
+        map.SetAFK(1e12);
+
+        return map;
+    }
+
+    //Square ring of roads with a spur, so dogs meet corners, junctions and dead ends
+    inline model::Map MakeRingMap(db::ConnectionPool& pool, std::string id = "ring")
+    {
+        model::Map map{ model::Map::Id{ id }, "Ring", pool };
+
+        map.AddRoad({ model::Road::HORIZONTAL, { 0, 0 }, 20 });
+        map.AddRoad({ model::Road::VERTICAL, { 20, 0 }, 20 });
+        map.AddRoad({ model::Road::HORIZONTAL, { 20, 20 }, 0 });
+        map.AddRoad({ model::Road::VERTICAL, { 0, 20 }, 0 });
+        map.AddRoad({ model::Road::VERTICAL, { 10, 0 }, -15 });
+        map.CalcRoads();
+
+        map.SetDogSpeed(3.5);
+        map.SetBagCapacity(3);
+
+        //Nobody should retire here, that would need a database
+        map.SetAFK(1e12);
+
+        return map;
+    }
+
+    //Turns 0 to 3 send the dog north, east, south and west, 4 stops it
+    inline void Steer(model::Player& player, int turn)
+    {
+        switch (turn % 5)
+        {
+        case 0: player.SetVel(0, -1); player.SetDir(model::Direction::NORTH); break;
+        case 1: player.SetVel(1, 0); player.SetDir(model::Direction::EAST); break;
+        case 2: player.SetVel(0, 1); player.SetDir(model::Direction::SOUTH); break;
+        case 3: player.SetVel(-1, 0); player.SetDir(model::Direction::WEST); break;
+        default: player.SetVel(0, 0); break;
+        }
+    }
+
+    //A game without maps. Fixtures built on it add the maps they need
+    struct GameFixture
+    {
+        GameFixture()
+        {
+            //Nobody should retire here, that would need a database
+            game.SetAFK(1e9);
+        }
+
+        OfflinePool pool;
+        model::Players players{ false };
+        model::Game game{ players, pool };
+    };
+
+    //The ring as the only map of the game
+    struct RingFixture : GameFixture
+    {
+        RingFixture()
+        {
+            game.AddMap(MakeRingMap(pool), 3.5);
+        }
+
+        const model::Map& GetMap() const
+        {
+            return game.GetMaps().front();
+        }
+    };
+}
@@ -0,0 +1,189 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/timing_wheel.h"
+#include "test-helpers.h"
+
+#include <map>
+#include <random>
+#include <vector>
+
+using util::TimingWheel;
+
+TEST_CASE("Timing wheel fires timers at their deadlines")
+{
+    TimingWheel<int> wheel;
+    std::vector<int> fired;
+
+    auto record = [&fired](int value) { fired.push_back(value); };
+
+    wheel.Schedule(70, 2);
+    wheel.Schedule(5, 1);
+    auto cancelled = wheel.Schedule(40, 3);
+    wheel.Schedule(300'000, 4);
+
+    CHECK(wheel.Size() == 4);
+    CHECK(wheel.Cancel(cancelled));
+    CHECK_FALSE(wheel.Cancel(cancelled));
+
+    wheel.Advance(4, record);
+    CHECK(fired.empty());
+
+    wheel.Advance(69, record);
+    CHECK(fired == std::vector<int>{ 1 });
+
+    wheel.Advance(70, record);
+    CHECK(fired == std::vector<int>{ 1, 2 });
+
+    //One long jump over a lot of empty ticks
+    wheel.Advance(1'000'000, record);
+    CHECK(fired == std::vector<int>{ 1, 2, 4 });
+    CHECK(wheel.GetNow() == 1'000'000);
+    CHECK(wheel.Size() == 0);
+
+    SECTION("a deadline already passed fires on the next advance")
+    {
+        wheel.Schedule(10, 5);
+        wheel.Advance(1'000'001, record);
+
+        CHECK(fired.back() == 5);
+    }
+
+    SECTION("deadlines past the horizon of the wheel wait for their time")
+    {
+        wheel.Schedule(5'000'000'000'000, 6);
+        wheel.Advance(4'999'999'999'999, record);
+
+        CHECK(fired.size() == 3);
+
+        wheel.Advance(5'000'000'000'000, record);
+
+        CHECK(fired.back() == 6);
+    }
+}
+
+TEST_CASE("Timing wheel churn matches a sorted map of deadlines")
+{
+    using Tick = TimingWheel<int>::Tick;
+
+    std::mt19937 random{ 20 };
+
+    TimingWheel<int> wheel;
+    std::map<int, std::pair<Tick, TimingWheel<int>::Timer>> pending;
+
+    int next_value = 0;
+
+    for (int round = 0; round < 3000; ++round)
+    {
+        //Mostly short timers, now and then one for hours or days ahead
+        for (int i = random() % 20; i > 0; --i)
+        {
+            Tick span = random() % 10 == 0 ? random() % 400'000'000 : random() % 5'000;
+            Tick deadline = wheel.GetNow() + span;
+
+            pending[next_value] = { deadline, wheel.Schedule(deadline, next_value) };
+            ++next_value;
+        }
+
+        for (int i = random() % 15; i > 0 && !pending.empty(); --i)
+        {
+            auto iter = pending.lower_bound(static_cast<int>(random() % next_value));
+
+            if (iter != pending.end())
+            {
+                REQUIRE(wheel.Cancel(iter->second.second));
+                pending.erase(iter);
+            }
+        }
+
+        Tick from = wheel.GetNow();
+        Tick to = from + (random() % 50 == 0 ? random() % 100'000'000 : random() % 200);
+        Tick last = 0;
+
+        wheel.Advance(to, [&](int value)
+            {
+                auto iter = pending.find(value);
+
+                REQUIRE(iter != pending.end());
+
+                Tick deadline = std::max(iter->second.first, from + 1);
+
+                REQUIRE(deadline <= to);
+                REQUIRE(deadline >= last);
+
+                last = deadline;
+                pending.erase(iter);
+            });
+
+        for (const auto& [value, timer] : pending)
+        {
+            REQUIRE(timer.first > to);
+        }
+
+        REQUIRE(wheel.Size() == pending.size());
+    }
+}
+
+TEST_CASE("AFK watch only keeps deadlines of standing dogs")
+{
+    test::OfflinePool pool;
+
+    model::Map map = test::MakeLineMap(pool, "line", 40);
+    map.GetDogs().TrackVelocityChanges(true);
+
+    model::Players players{ false };
+
+    for (int i = 0; i < 10; ++i)
+    {
+        players.MakePlayer("dog", &map);
+    }
+
+    model::PlayerList& list = players.GetPlayerList("line");
+    model::AfkWatch watch;
+
+    watch.Advance(map, list, players.TakeJoined("line"), 50);
+    CHECK(watch.GetPendingCount() == 10);
+
+    list[0].SetVel(1, 0);
+    list[1].SetVel(1, 0);
+    list[2].SetVel(0, 0);
+
+    watch.Advance(map, list, players.TakeJoined("line"), 50);
+    CHECK(watch.GetPendingCount() == 8);
+
+    //Both walk into the end of the road and stop there
+    players.MoveAllByMap(100'000, map);
+    watch.Advance(map, list, players.TakeJoined("line"), 50);
+
+    CHECK(watch.GetPendingCount() == 10);
+    CHECK(list[1].GetIdleTime() == 0);
+}
+
+TEST_CASE("Idle deadlines on a crowded map", "[!benchmark]")
+{
+    constexpr int TIMERS = 100'000;
+
+    TimingWheel<int> wheel;
+    std::vector<TimingWheel<int>::Timer> timers(TIMERS);
+
+    for (int i = 0; i < TIMERS; ++i)
+    {
+        timers[i] = wheel.Schedule(60'000 + i, i);
+    }
+
+    size_t turn = 0;
+
+    //A hundred players steered per 50 ms tick, each pushing their deadline back
+    BENCHMARK("tick, 100 reschedules")
+    {
+        for (int i = 0; i < 100; ++i, ++turn)
+        {
+            int player = static_cast<int>(turn * 7919 % TIMERS);
+
+            wheel.Cancel(timers[player]);
+            timers[player] = wheel.Schedule(wheel.GetNow() + 60'000, player);
+        }
+
+        wheel.Advance(wheel.GetNow() + 50, [](int) {});
+    };
+}
@@ -0,0 +1,207 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/token.h"
+#include "test-helpers.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+
+using namespace std::literals;
+using model::Token;
+
+TEST_CASE("Token parsing")
+{
+    SECTION("round trip")
+    {
+        auto token = model::ParseToken("0123456789abcdef0F1E2D3C4B5A6978"sv);
+
+        REQUIRE(token.has_value());
+        CHECK(token->high == 0x0123456789abcdefull);
+        CHECK(token->low == 0x0f1e2d3c4b5a6978ull);
+        CHECK(model::FormatToken(*token) == "0123456789abcdef0f1e2d3c4b5a6978"s);
+    }
+
+    SECTION("malformed tokens")
+    {
+        CHECK_FALSE(model::ParseToken(""sv));
+        CHECK_FALSE(model::ParseToken("0123456789abcdef0123456789abcde"sv));
+        CHECK_FALSE(model::ParseToken("0123456789abcdef0123456789abcdef0"sv));
+        CHECK_FALSE(model::ParseToken("0123456789abcdef0123456789abcdeg"sv));
+        CHECK_FALSE(model::ParseToken("InvalidToken"sv));
+    }
+
+    SECTION("authorization header")
+    {
+        auto token = model::ParseBearerToken("Bearer 6fa9f4c5e9c5e1b1a2b3c4d5e6f70819"sv);
+
+        REQUIRE(token.has_value());
+        CHECK(model::FormatToken(*token) == "6fa9f4c5e9c5e1b1a2b3c4d5e6f70819"s);
+
+        CHECK(model::ParseBearerToken("bearer 6fa9f4c5e9c5e1b1a2b3c4d5e6f70819"sv).has_value());
+        CHECK_FALSE(model::ParseBearerToken("Basic 6fa9f4c5e9c5e1b1a2b3c4d5e6f70819"sv));
+        CHECK_FALSE(model::ParseBearerToken("Bearer6fa9f4c5e9c5e1b1a2b3c4d5e6f70819"sv));
+        CHECK_FALSE(model::ParseBearerToken("Bearer 6fa9f4c5e9c5e1b1a2b3c4d5e6f7081"sv));
+        CHECK_FALSE(model::ParseBearerToken("Bearer"sv));
+    }
+}
+
+TEST_CASE("Token index")
+{
+    model::TokenIndex<int> index;
+
+    SECTION("insert, find and erase")
+    {
+        Token first{ 1, 2 };
+        Token second{ 3, 4 };
+
+        CHECK(index.Find(first) == nullptr);
+        CHECK_FALSE(index.Erase(first));
+
+        CHECK(index.Insert(first, 10));
+        CHECK(index.Insert(second, 20));
+        CHECK_FALSE(index.Insert(first, 30));
+
+        REQUIRE(index.Find(first) != nullptr);
+        CHECK(*index.Find(first) == 10);
+        CHECK(index.Size() == 2);
+
+        CHECK(index.Erase(first));
+        CHECK(index.Find(first) == nullptr);
+        CHECK(*index.Find(second) == 20);
+        CHECK(index.Size() == 1);
+    }
+
+    SECTION("matches std::map under random churn")
+    {
+        std::mt19937_64 rng{ 42 };
+        std::map<Token, int> reference;
+        std::vector<Token> inserted;
+
+        for (int i = 0; i < 20000; ++i)
+        {
+            if (inserted.empty() || rng() % 3 != 0)
+            {
+                //Small key space, so collisions and clusters actually happen
+                Token token{ rng() % 64, rng() % 4096 };
+
+                CHECK(index.Insert(token, i) == reference.emplace(token, i).second);
+                inserted.push_back(token);
+            }
+            else
+            {
+                Token token = inserted[rng() % inserted.size()];
+
+                CHECK(index.Erase(token) == (reference.erase(token) == 1));
+            }
+        }
+
+        CHECK(index.Size() == reference.size());
+
+        for (const Token& token : inserted)
+        {
+            auto iter = reference.find(token);
+            const int* value = index.Find(token);
+
+            if (iter == reference.end())
+            {
+                CHECK(value == nullptr);
+            }
+            else
+            {
+                REQUIRE(value != nullptr);
+                CHECK(*value == iter->second);
+            }
+        }
+    }
+}
+
+TEST_CASE("Token generation")
+{
+    SECTION("tokens are distinct and survive formatting")
+    {
+        std::set<Token> seen;
+
+        for (int i = 0; i < 10000; ++i)
+        {
+            Token token = model::GenerateToken();
+
+            CHECK(seen.insert(token).second);
+            CHECK(model::ParseToken(model::FormatToken(token)) == token);
+        }
+    }
+
+    SECTION("threads get their own generators")
+    {
+        std::vector<Token> first(1000);
+        std::vector<Token> second(1000);
+
+        std::thread worker{ [&first] {
+            for (Token& token : first)
+            {
+                token = model::GenerateToken();
+            }
+        } };
+
+        for (Token& token : second)
+        {
+            token = model::GenerateToken();
+        }
+
+        worker.join();
+
+        std::set<Token> seen(first.begin(), first.end());
+        seen.insert(second.begin(), second.end());
+
+        CHECK(seen.size() == first.size() + second.size());
+    }
+}
+
+namespace
+{
+    //What /api/v1/game/join used before: 32 draws, each reseeding std::srand from the clock
+    std::string LegacyToken()
+    {
+        constexpr char hex_chars[] = "0123456789abcdef";
+
+        std::string token;
+
+        for (int i = 0; i < 32; ++i)
+        {
+            std::srand(static_cast<unsigned int>(std::chrono::system_clock::now().time_since_epoch().count()));
+            token += hex_chars[std::rand() % 16];
+        }
+
+        return token;
+    }
+}
+
+TEST_CASE("Join throughput", "[!benchmark]")
+{
+    test::OfflinePool pool;
+    model::Map map = test::MakeLineMap(pool, "map1", 40);
+
+    BENCHMARK("legacy token")
+    {
+        return LegacyToken();
+    };
+
+    BENCHMARK("token")
+    {
+        return model::FormatToken(model::GenerateToken());
+    };
+
+    //Everything a join does apart from the HTTP layer: a new player, its token and the hex form for the reply
+    BENCHMARK_ADVANCED("join")(Catch::Benchmark::Chronometer meter)
+    {
+        model::Players players{ false };
+
+        meter.measure([&players, &map] {
+            return model::FormatToken(players.MakePlayer("dog", &map)->GetToken());
+        });
+    };
+}